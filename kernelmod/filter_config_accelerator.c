@@ -21,22 +21,32 @@ does_rule_apply_for_family(const struct mrm_filter_rule * const rule, const int
 }
 
 
+/* the rulesets of an accelerator or a classifier, in the order their references are laid out */
+#define MRM_RULESET_COUNT 6
+#define MRM_RULESETS(A) { \
+  &(A)->ip4_targeted_rules.udp_targeted_rules, \
+  &(A)->ip4_targeted_rules.tcp_targeted_rules, \
+  &(A)->ip4_targeted_rules.other_targeted_rules, \
+  &(A)->ip6_targeted_rules.udp_targeted_rules, \
+  &(A)->ip6_targeted_rules.tcp_targeted_rules, \
+  &(A)->ip6_targeted_rules.other_targeted_rules, \
+}
+
 static inline void
 push_rule(
   struct mrm_filter_rulerefset * const ruleset,
   const struct mrm_filter_rule * const rule
   ) {
-  if (ruleset->rules_active >= MRM_FILTER_MAX_RULES) {
-    printk(KERN_WARNING "MRM Ruleset Full. Dropping rule!");
-    return; /* full. */
-  }
-  ruleset->rules[ruleset->rules_active++] = rule;
+  /* without any storage (the first pass) the rules are only counted */
+  if (ruleset->rules != NULL) ruleset->rules[ruleset->rules_active] = rule;
+  ++ruleset->rules_active;
 }
 
-void
-mrm_generate_acceleration_tables(
+static void
+sort_rules(
   struct mrm_filter_config_accelerator * const output,
-  const struct mrm_filter_config * const input
+  const struct mrm_filter_rule * const rules,
+  const unsigned rule_count
   ) {
   unsigned i;
   const struct mrm_filter_rule * rule;
@@ -48,10 +58,8 @@ mrm_generate_acceleration_tables(
   struct mrm_filter_rulerefset * const r_ip6tcp = &output->ip6_targeted_rules.tcp_targeted_rules;
   struct mrm_filter_rulerefset * const r_ip6oth = &output->ip6_targeted_rules.other_targeted_rules;
 
-  memset(output, 0, sizeof(*output));
-
-  for (i = 0; i < input->rules_active; i++) {
-    rule = &input->rules[i];
+  for (i = 0; i < rule_count; i++) {
+    rule = &rules[i];
 
     /* ipv4 ? */
     if (does_rule_apply_for_family(rule, AF_INET)) {
@@ -106,3 +114,111 @@ mrm_generate_acceleration_tables(
     }
   }
 }
+
+unsigned
+mrm_acceleration_tables_size(
+  const struct mrm_filter_rule * const rules,
+  const unsigned rule_count
+  ) {
+  struct mrm_filter_config_accelerator counts;
+  struct mrm_filter_rulerefset * const sets[MRM_RULESET_COUNT] = MRM_RULESETS(&counts);
+  unsigned i, total;
+
+  memset(&counts, 0, sizeof(counts));
+  sort_rules(&counts, rules, rule_count);
+
+  total = 0;
+  for (i = 0; i < MRM_RULESET_COUNT; i++) {
+    total += sets[i]->rules_active;
+  }
+  return total;
+}
+
+void
+mrm_generate_acceleration_tables(
+  struct mrm_filter_config_accelerator * const output,
+  const struct mrm_filter_rule * const rules,
+  const unsigned rule_count,
+  const struct mrm_filter_rule ** refs
+  ) {
+  struct mrm_filter_rulerefset * const sets[MRM_RULESET_COUNT] = MRM_RULESETS(output);
+  unsigned i;
+
+  /* count how many references each ruleset gets, hand each one its share of refs, then fill them in...
+     refs has room for mrm_acceleration_tables_size() of them */
+  memset(output, 0, sizeof(*output));
+  sort_rules(output, rules, rule_count);
+  for (i = 0; i < MRM_RULESET_COUNT; i++) {
+    sets[i]->rules = refs;
+    refs += sets[i]->rules_active;
+    sets[i]->rules_active = 0;
+  }
+  sort_rules(output, rules, rule_count);
+}
+
+static void
+merge_ruleset(
+  struct mrm_classifier_rulerefset * const output,
+  const struct mrm_filter_rulerefset * const ruleset,
+  const unsigned class_idx
+  ) {
+  unsigned i;
+
+  /* cant overflow... the storage got sized to fit every class */
+  for (i = 0; i < ruleset->rules_active; i++) {
+    output->rules[output->rules_active].rule      = ruleset->rules[i];
+    output->rules[output->rules_active].class_idx = class_idx;
+    ++output->rules_active;
+  }
+}
+
+unsigned
+mrm_classifier_size(
+  const struct mrm_filter_config_accelerator * const * const class_accelerators,
+  const unsigned class_count
+  ) {
+  unsigned i, total;
+
+  total = 0;
+  for (i = 0; (i < class_count) && (i < MRM_MAX_CLASSES); i++) {
+    const struct mrm_filter_rulerefset * const sets[MRM_RULESET_COUNT] = MRM_RULESETS(class_accelerators[i]);
+    unsigned j;
+
+    for (j = 0; j < MRM_RULESET_COUNT; j++) {
+      total += sets[j]->rules_active;
+    }
+  }
+  return total;
+}
+
+void
+mrm_generate_classifier(
+  struct mrm_classifier * const output,
+  const struct mrm_filter_config_accelerator * const * const class_accelerators,
+  const unsigned class_count,
+  struct mrm_classifier_ruleref * refs
+  ) {
+  struct mrm_classifier_rulerefset * const sets[MRM_RULESET_COUNT] = MRM_RULESETS(output);
+  unsigned i, j;
+  const struct mrm_filter_config_accelerator * acc;
+
+  /* hand each merged ruleset room for the rules of all the classes... refs has room for mrm_classifier_size() of them */
+  memset(output, 0, sizeof(*output));
+  for (j = 0; j < MRM_RULESET_COUNT; j++) {
+    sets[j]->rules = refs;
+    for (i = 0; (i < class_count) && (i < MRM_MAX_CLASSES); i++) {
+      const struct mrm_filter_rulerefset * const class_sets[MRM_RULESET_COUNT] = MRM_RULESETS(class_accelerators[i]);
+      refs += class_sets[j]->rules_active;
+    }
+  }
+
+  for (i = 0; (i < class_count) && (i < MRM_MAX_CLASSES); i++) {
+    acc = class_accelerators[i];
+    merge_ruleset(&output->ip4_targeted_rules.udp_targeted_rules,   &acc->ip4_targeted_rules.udp_targeted_rules,   i);
+    merge_ruleset(&output->ip4_targeted_rules.tcp_targeted_rules,   &acc->ip4_targeted_rules.tcp_targeted_rules,   i);
+    merge_ruleset(&output->ip4_targeted_rules.other_targeted_rules, &acc->ip4_targeted_rules.other_targeted_rules, i);
+    merge_ruleset(&output->ip6_targeted_rules.udp_targeted_rules,   &acc->ip6_targeted_rules.udp_targeted_rules,   i);
+    merge_ruleset(&output->ip6_targeted_rules.tcp_targeted_rules,   &acc->ip6_targeted_rules.tcp_targeted_rules,   i);
+    merge_ruleset(&output->ip6_targeted_rules.other_targeted_rules, &acc->ip6_targeted_rules.other_targeted_rules, i);
+  }
+}
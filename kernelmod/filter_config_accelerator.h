@@ -18,9 +18,10 @@
 
 
 
+/* the reference arrays are sized to fit and live in storage handed in by the caller (see below) */
 struct mrm_filter_rulerefset {
   unsigned                      rules_active;
-  const struct mrm_filter_rule *rules[MRM_FILTER_MAX_RULES];
+  const struct mrm_filter_rule **rules;
 };
 
 
@@ -57,8 +58,45 @@ struct mrm_filter_config_accelerator {
 
 
 
-/* functions used to work with these data structures */
-void mrm_generate_acceleration_tables(struct mrm_filter_config_accelerator * const /* output */, const struct mrm_filter_config * const /* input */);
+/*
+  the merged classifier...
+  built from the accelerators of all the filters of a multi-class
+  remap, so the traffic only has to be run past one ruleset no matter
+  how many classes there are
+
+  the rule references keep the class order (and the rule order within
+  each class), so the first rule that matches names the class of the
+  traffic... exactly as if the classes' filters were tried one by one
+*/
+struct mrm_classifier_ruleref {
+  const struct mrm_filter_rule *rule;
+  unsigned                      class_idx;
+};
+
+struct mrm_classifier_rulerefset {
+  unsigned                      rules_active;
+  struct mrm_classifier_ruleref *rules;
+};
+
+struct mrm_classifier_single_family_protocol_ruleset {
+  struct mrm_classifier_rulerefset other_targeted_rules;
+  struct mrm_classifier_rulerefset tcp_targeted_rules;
+  struct mrm_classifier_rulerefset udp_targeted_rules;
+};
+
+struct mrm_classifier {
+  struct mrm_classifier_single_family_protocol_ruleset ip4_targeted_rules;
+  struct mrm_classifier_single_family_protocol_ruleset ip6_targeted_rules;
+};
+
+
+
+/* functions used to work with these data structures...
+   the _size() functions tell how many references the generate functions need room for */
+unsigned mrm_acceleration_tables_size(const struct mrm_filter_rule * const /* rules */, const unsigned /* rule_count */);
+void mrm_generate_acceleration_tables(struct mrm_filter_config_accelerator * const /* output */, const struct mrm_filter_rule * const /* rules */, const unsigned /* rule_count */, const struct mrm_filter_rule ** /* refs */);
+unsigned mrm_classifier_size(const struct mrm_filter_config_accelerator * const * const /* class_accelerators */, const unsigned /* class_count */);
+void mrm_generate_classifier(struct mrm_classifier * const /* output */, const struct mrm_filter_config_accelerator * const * const /* class_accelerators */, const unsigned /* class_count */, struct mrm_classifier_ruleref * /* refs */);
 
 
 
@@ -0,0 +1,60 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+* Copyright (c) 2018 Cable Television Laboratories, Inc. ("CableLabs")
+*                    and others.  All rights reserved.
+*
+* Created by Jon Dennis (j.dennis@cablelabs.com)
+*/
+
+#ifndef MACREMAPPER_CHECKPOINT_H_INCLUDED
+#define MACREMAPPER_CHECKPOINT_H_INCLUDED
+
+/*
+
+  This file defines the binary checkpoint of the running
+  configuration... exported and restored as a whole, either
+  through the MRM_GETCHECKPOINT/MRM_RESTORECHECKPOINT ioctl()s
+  or (restore only) when the module gets loaded
+
+  the records are the same structures the ioctl()s use, in the
+  native byte order and layout... a checkpoint is only good for
+  the module (ABI) version that made it, hence the version
+
+*/
+
+#include "./macremapper_filter_config.h"
+
+#define MRM_CHECKPOINT_MAGIC    0x434d524dU /* "MRMC" in memory on little endian */
+#define MRM_CHECKPOINT_VERSION  2           /* bumped whenever any of the record structures change */
+
+/* the records follow the header, each starting on a MRM_CHECKPOINT_ALIGN boundary... */
+#define MRM_CHECKPOINT_ALIGN    8
+#define MRM_CHECKPOINT_ALIGNED(SIZE) (((SIZE) + (MRM_CHECKPOINT_ALIGN - 1)) & ~(size_t)(MRM_CHECKPOINT_ALIGN - 1))
+
+/* a checkpoint is never bigger than this... */
+#define MRM_CHECKPOINT_SIZE_LIMIT (64 * 1024 * 1024)
+
+struct mrm_checkpoint_header {
+  uint32_t  magic;         /* MRM_CHECKPOINT_MAGIC */
+  uint32_t  version;       /* MRM_CHECKPOINT_VERSION */
+  uint32_t  size;          /* of the whole checkpoint, this header included */
+  uint32_t  record_count;
+};
+
+/* the record types... whatever order they appear in, all the groups get restored first,
+   then the filters, the remaps (refering to them) and the multicast conversions */
+enum {
+  MRM_CHECKPOINT_GROUP    = 1, /* struct mrm_replace_group with its replacements */
+  MRM_CHECKPOINT_FILTER,       /* struct mrm_filter_config_v2 with its rules */
+  MRM_CHECKPOINT_REMAP,        /* struct mrm_remap_entry cut short after the last class (MRM_CHECKPOINT_REMAP_SIZE) */
+  MRM_CHECKPOINT_MCAST,        /* struct mrm_mcast_group */
+};
+
+struct mrm_checkpoint_record {
+  uint32_t  type;          /* MRM_CHECKPOINT_* */
+  uint32_t  size;          /* of the data following this header... not counting the padding up to the next record */
+};
+
+#define MRM_CHECKPOINT_REMAP_SIZE(CLASS_COUNT) (sizeof(struct mrm_remap_entry) - ((MRM_MAX_CLASSES - (CLASS_COUNT)) * sizeof(struct mrm_remap_class)))
+
+#endif /* #ifndef MACREMAPPER_CHECKPOINT_H_INCLUDED */
@@ -27,9 +27,16 @@
 
 */
 
-#define MRM_FILTER_MAX_RULES 10
+#define MRM_FILTER_MAX_RULES 10  /* the fixed size (version 1) struct mrm_filter_config only... see struct mrm_filter_config_v2 */
+#define MRM_FILTER_RULES_LIMIT 512
 #define MRM_FILTER_NAME_MAX  24
-#define MRM_MAX_REPLACE      10
+#define MRM_MAX_REPLACE      10  /* the replacements a class carries itself... see struct mrm_replace_group */
+#define MRM_REPLACE_GROUP_LIMIT 256
+#define MRM_MAX_REPLACE_WEIGHT 65535
+#define MRM_MAX_CLASSES      4
+#define MRM_MAX_MCAST_MEMBERS 16
+#define MRM_MAX_IDLE_TIMEOUT (7 * 24 * 60 * 60) /* seconds */
+#define MRM_IPSET_NAME_MAX   30  /* including the terminating nul... fits over the addresses of struct mrm_ipaddr_filter */
 
 
 /* filter data types */
@@ -39,21 +46,33 @@ struct mrm_ipaddr_filter {
     MRMIPFILT_MATCHSINGLE,
     MRMIPFILT_MATCHSUBNET,
     MRMIPFILT_MATCHRANGE,
+    MRMIPFILT_MATCHIPSET,  /* the source address is in an existing kernel ipset (hash:ip, hash:net, ...) */
   } match_type;
 
-  /* XXX should use system address types for this! */
   union {
-    struct in_addr ipaddr4;
-    struct in_addr ipaddr4_start;
-    struct in6_addr ipaddr6;
-    struct in6_addr ipaddr6_start;
-  };
-
-  union {
-    struct in_addr ipaddr4_mask;
-    struct in_addr ipaddr4_end;
-    struct in6_addr ipaddr6_mask;
-    struct in6_addr ipaddr6_end;
+    struct {
+      /* XXX should use system address types for this! */
+      union {
+        struct in_addr ipaddr4;
+        struct in_addr ipaddr4_start;
+        struct in6_addr ipaddr6;
+        struct in6_addr ipaddr6_start;
+      };
+
+      union {
+        struct in_addr ipaddr4_mask;
+        struct in_addr ipaddr4_end;
+        struct in6_addr ipaddr6_mask;
+        struct in6_addr ipaddr6_end;
+      };
+    };
+
+    /* MRMIPFILT_MATCHIPSET... the set must exist when the filter gets set, and it cant be
+       destroyed while the filter is around (its members may change at any time though) */
+    struct {
+      char     ipset_name[MRM_IPSET_NAME_MAX];
+      uint16_t ipset_index; /* set by the kernel */
+    };
   };
 };
 
@@ -89,6 +108,7 @@ struct mrm_filter_rule {
     the family field...
     Acceptable values: AF_INET, AF_INET6
     This field is what dictates what type of address is in the "src_ipaddr" field
+    (for "MRMIPFILT_MATCHIPSET", the type of address the set holds)
     This field also dictates the family if "proto.match_type" has "MRMIPPFILT_MATCHFAMILY"
     This field is ignored if both conditions are met:
       . "proto.match_type" does NOT have "MRMIPPFILT_MATCHFAMILY"
@@ -109,9 +129,90 @@ struct mrm_filter_config {
   struct mrm_filter_rule  rules[MRM_FILTER_MAX_RULES];
 };
 
+/* version 2 of the filter configuration... the rules follow the header, as many as rule_count says,
+   so it is only ever as big as the filter it describes (allocate MRM_FILTER_CONFIG_V2_SIZE(rule_count)) */
+#define MRM_FILTER_CONFIG_V2 2
+struct mrm_filter_config_v2 {
+  unsigned                version;      /* MRM_FILTER_CONFIG_V2 */
+  char                    name[MRM_FILTER_NAME_MAX];
+  unsigned                rule_count;   /* cant be > MRM_FILTER_RULES_LIMIT */
+  struct mrm_filter_rule  rules[];
+};
+#define MRM_FILTER_CONFIG_V2_SIZE(RULE_COUNT) (sizeof(struct mrm_filter_config_v2) + ((RULE_COUNT) * sizeof(struct mrm_filter_rule)))
+
 
 /* remap data types */
+
+/* where a frame gets moved to... */
+struct mrm_replacement {
+  unsigned char   macaddr[6];
+  char            ifname[IFNAMSIZ];
+  unsigned        weight; /* relative share of the traffic... 0 is treated as 1, must be <= MRM_MAX_REPLACE_WEIGHT */
+  unsigned        rate;   /* cap in bytes per second, for all the cpus together... 0 = unlimited */
+  unsigned        burst;  /* bytes allowed through above the rate... 0 = a tenth of a second worth
+                             (a frame larger than the burst still gets through, once there is any room) */
+};
+
+/* a named set of replacements any number of remap classes can refer to (by group_name)...
+   setting it again changes where all of them send their frames at once.
+   the replacements follow the header, as many as replace_count says (allocate MRM_REPLACE_GROUP_SIZE(replace_count)) */
+struct mrm_replace_group {
+  char                    name[MRM_FILTER_NAME_MAX];
+  unsigned                replace_count; /* must be >=1 and <= MRM_REPLACE_GROUP_LIMIT */
+  struct mrm_replacement  replace[];
+};
+#define MRM_REPLACE_GROUP_SIZE(REPLACE_COUNT) (sizeof(struct mrm_replace_group) + ((REPLACE_COUNT) * sizeof(struct mrm_replacement)))
+
+/* a single traffic class of a remap... frames matching the filter go to the replacements */
+struct mrm_remap_class {
+  char            filter_name[MRM_FILTER_NAME_MAX];
+
+  /* how a replacement gets picked for each matching frame... */
+  enum {
+    MRMREPLPOL_ROUNDROBIN   = 0, /* weighted round-robin, frame by frame */
+    MRMREPLPOL_FLOWHASH,         /* weighted, all frames of a flow go to the same replacement */
+    MRMREPLPOL_LEASTLOAD,        /* the replacement with the lowest recent (weight adjusted) load */
+    MRMREPLPOL_REPLICATE,        /* a copy to every replacement (weights are ignored)... the receiver de-duplicates */
+  } policy;
+
+  /* what happens to frames a rate limited replacement has no room for... */
+  enum {
+    MRMSPILL_NEXT           = 0, /* try the following replacements, leave the frame unmodified if they are all full */
+    MRMSPILL_UNMODIFIED,         /* leave the frame unmodified */
+  } spill;
+
+  /* elephant flow mode... when elephant_bytes is non-zero a flow only gets remapped once
+     its filter matching frames add up to elephant_bytes within elephant_window milliseconds,
+     and from then on all of its frames get remapped */
+  unsigned        elephant_bytes;
+  unsigned        elephant_window; /* milliseconds... 0 = 1000 */
+
+  /* where the frames go... either a named replacement group (shared by any number of remaps,
+     see struct mrm_replace_group) or replacements of the class's own, not both */
+  char                    group_name[MRM_FILTER_NAME_MAX]; /* "" = the class's own replacements */
+  unsigned                replace_count; /* must be >=1 and <= MRM_MAX_REPLACE... 0 with a group_name */
+  struct mrm_replacement  replace[MRM_MAX_REPLACE];
+};
+
 struct mrm_remap_entry {
+  unsigned char           match_macaddr[6];
+
+  /* shadow mode... the frames get classified and a replacement picked for them as usual, but
+     they are left unmodified, only counted towards what each replacement would have been sent */
+  unsigned char           shadow;
+
+  /* seconds without a single frame to the match MAC address before the remap deletes itself...
+     0 = never, at most MRM_MAX_IDLE_TIMEOUT (it may take a few seconds longer than that) */
+  unsigned                idle_timeout;
+
+  /* the classes are evaluated in order... a frame belongs to the first class whose filter it matches */
+  unsigned                class_count; /* must be >=1 and <= MRM_MAX_CLASSES */
+  struct mrm_remap_class  classes[MRM_MAX_CLASSES];
+};
+
+/* the original (version 1) remap entry... a single class with replacements of its own,
+   picked round-robin (what MRM_GETREMAP, MRM_SETREMAP and MRM_DELETEREMAP still take) */
+struct mrm_remap_entry_v1 {
   unsigned char   match_macaddr[6];
   char            filter_name[MRM_FILTER_NAME_MAX];
   unsigned        replace_count; /* must be >=1 and <= MRM_MAX_REPLACE */
@@ -121,4 +222,24 @@ struct mrm_remap_entry {
   } replace[MRM_MAX_REPLACE];
 };
 
+
+/* multicast to unicast conversion data types */
+struct mrm_mcast_group {
+  unsigned char   group_macaddr[6];
+
+  /* what happens to the multicast frame itself on a port it was converted for... */
+  enum {
+    MRMMCAST_DROP_ORIGINAL  = 0, /* only the unicast copies go out */
+    MRMMCAST_KEEP_ORIGINAL,      /* the unicast copies go out along with it */
+  } original;
+
+  /* the subscribed stations... each gets a unicast copy addressed to it,
+     which is then remapped like any other frame sent to the station */
+  unsigned        member_count; /* must be >=1 and <= MRM_MAX_MCAST_MEMBERS */
+  struct {
+    unsigned char   macaddr[6];
+    char            ifname[IFNAMSIZ]; /* the bridge port the station sits behind (required) */
+  } members[MRM_MAX_MCAST_MEMBERS];
+};
+
 #endif /* #ifndef MACREMAPPER_FILTER_CONFIG_H_INCLUDED */
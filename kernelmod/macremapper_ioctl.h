@@ -19,6 +19,7 @@
 #include <asm/ioctl.h>
 
 #include "./macremapper_filter_config.h"
+#include "./macremapper_checkpoint.h"
 
 #define MRM_IOCTL_TYPE 77
 
@@ -28,11 +29,152 @@
 #define MRM_SETFILTER      _IOW  (MRM_IOCTL_TYPE, 2, struct mrm_filter_config)
 #define MRM_DELETEFILTER   _IOW  (MRM_IOCTL_TYPE, 3, struct mrm_filter_config)
 
-/* ioctl()s for working with MAC address remappings... */
+/* the same for filters of any size (struct mrm_filter_config_v2)... the rules follow the header in user space too
+   MRM_GETFILTER2: rule_count says how many rules there is room for, and gets set to how many the filter has...
+                   if that is more than there is room for, only the header is copied back and it fails with ENOSPC */
+#define MRM_GETFILTER2     _IOWR (MRM_IOCTL_TYPE, 4, struct mrm_filter_config_v2)
+#define MRM_SETFILTER2     _IOW  (MRM_IOCTL_TYPE, 5, struct mrm_filter_config_v2)
+
+/* ioctl()s for working with MAC address remappings (struct mrm_remap_entry_v1)...
+   MRM_GETREMAP fails with E2BIG for a remap version 1 cannot describe (more than one class, or a replacement group) */
 #define MRM_GETREMAPCOUNT  _IOR  (MRM_IOCTL_TYPE, 14, unsigned)
-#define MRM_GETREMAP       _IOWR (MRM_IOCTL_TYPE, 15, struct mrm_remap_entry)
-#define MRM_SETREMAP       _IOW  (MRM_IOCTL_TYPE, 16, struct mrm_remap_entry)
-#define MRM_DELETEREMAP    _IOW  (MRM_IOCTL_TYPE, 17, struct mrm_remap_entry)
+#define MRM_GETREMAP       _IOWR (MRM_IOCTL_TYPE, 15, struct mrm_remap_entry_v1)
+#define MRM_SETREMAP       _IOW  (MRM_IOCTL_TYPE, 16, struct mrm_remap_entry_v1)
+#define MRM_DELETEREMAP    _IOW  (MRM_IOCTL_TYPE, 17, struct mrm_remap_entry_v1)
+
+/* the same for remaps with classes (struct mrm_remap_entry)... MRM_DELETEREMAP only needs the match MAC address */
+#define MRM_GETREMAP2      _IOWR (MRM_IOCTL_TYPE, 18, struct mrm_remap_entry)
+#define MRM_SETREMAP2      _IOW  (MRM_IOCTL_TYPE, 19, struct mrm_remap_entry)
+
+/* ioctl()s for working with multicast to unicast conversions... */
+#define MRM_GETMCASTCOUNT  _IOR  (MRM_IOCTL_TYPE, 20, unsigned)
+#define MRM_GETMCAST       _IOWR (MRM_IOCTL_TYPE, 21, struct mrm_mcast_group)
+#define MRM_SETMCAST       _IOW  (MRM_IOCTL_TYPE, 22, struct mrm_mcast_group)
+#define MRM_DELETEMCAST    _IOW  (MRM_IOCTL_TYPE, 23, struct mrm_mcast_group)
+
+/* ioctl()s for working with replacement groups (struct mrm_replace_group)... the replacements follow the header in user space too
+   MRM_GETGROUP: works the same as MRM_GETFILTER2, replace_count says how many replacements there is room for
+   MRM_DELETEGROUP: only the name is needed... fails with EADDRINUSE while any remap still refers to the group */
+#define MRM_GETGROUPCOUNT  _IOR  (MRM_IOCTL_TYPE, 24, unsigned)
+#define MRM_GETGROUP       _IOWR (MRM_IOCTL_TYPE, 25, struct mrm_replace_group)
+#define MRM_SETGROUP       _IOW  (MRM_IOCTL_TYPE, 26, struct mrm_replace_group)
+#define MRM_DELETEGROUP    _IOW  (MRM_IOCTL_TYPE, 27, struct mrm_replace_group)
+
+/* ioctl()s for building up a complete set of filters and remaps off to the side
+   and then swapping it in for the running ones all at once...
+   MRM_STAGEFILTERS and MRM_STAGEREMAPS may be called any number of times in between */
+struct mrm_stage_vector {
+  unsigned  count;    /* how many elements "entries" points at */
+  unsigned  staged;   /* set by the kernel... how many of them got staged (all of them on success) */
+  uint64_t  entries;  /* user space pointer to struct mrm_filter_config[count] or struct mrm_remap_entry[count] */
+};
+#define MRM_STAGEBEGIN     _IO   (MRM_IOCTL_TYPE, 30)
+#define MRM_STAGEFILTERS   _IOWR (MRM_IOCTL_TYPE, 31, struct mrm_stage_vector)
+#define MRM_STAGEREMAPS    _IOWR (MRM_IOCTL_TYPE, 32, struct mrm_stage_vector)
+#define MRM_STAGECOMMIT    _IO   (MRM_IOCTL_TYPE, 33)
+#define MRM_STAGEABORT     _IO   (MRM_IOCTL_TYPE, 34)
+#define MRM_STAGEFILTER2   _IOW  (MRM_IOCTL_TYPE, 35, struct mrm_filter_config_v2) /* a single filter of any size */
+
+/* ioctl()s for exporting and restoring the whole running configuration at once (see macremapper_checkpoint.h)...
+   MRM_GETCHECKPOINT: size says how much room data points at, and gets set to how big the checkpoint is...
+                      if that is more than there is room for, nothing is copied and it fails with ENOSPC
+   MRM_RESTORECHECKPOINT: the replacement groups and multicast conversions in the checkpoint get set, and its
+                          filters and remaps swapped in for the running ones all at once (staging, fails with EBUSY
+                          while anyone else is)... nothing changes if the checkpoint is malformed */
+struct mrm_checkpoint_buffer {
+  unsigned  size;
+  uint64_t  data;     /* user space pointer to the checkpoint (struct mrm_checkpoint_header) */
+};
+#define MRM_GETCHECKPOINT     _IOWR (MRM_IOCTL_TYPE, 40, struct mrm_checkpoint_buffer)
+#define MRM_RESTORECHECKPOINT _IOW  (MRM_IOCTL_TYPE, 41, struct mrm_checkpoint_buffer)
+
+/* ioctl()s for the data plane counters... they count from when the module got loaded, or from the last MRM_RESETSTATS
+   MRM_GETREMAPSTATS: works the same as MRM_GETFILTER2, counter_count says how many counters there is room for
+   MRM_GETMCASTSTATS: by group_macaddr */
+struct mrm_counter {
+  uint64_t  frames;
+  uint64_t  bytes;
+};
+
+struct mrm_stats {
+  struct mrm_counter  hook;          /* every frame going out of a bridge port */
+  struct mrm_counter  remap_hit;     /* unicast frames to a remapped MAC address */
+  struct mrm_counter  remap_miss;    /* unicast frames to any other MAC address */
+  struct mrm_counter  unclassified;  /* remap hits matching none of the classes' filters (left unmodified) */
+};
+
+struct mrm_remap_stats {
+  unsigned char       match_macaddr[6];
+  unsigned char       shadow;        /* set by the kernel... the replacement counters are what they would have been sent */
+  unsigned            class_count;
+  struct {
+    unsigned          rule_count;    /* of the class's filter */
+    unsigned          replace_count; /* of the class's replacements... a replacement group's counters are shared by every remap using it */
+  } classes[MRM_MAX_CLASSES];
+  unsigned            counter_count; /* the rule and replace counts of all the classes added up, plus twice the replace counts */
+
+  /* class by class: the matches of each filter rule, then what went to each replacement...
+     then after all the classes, class by class again: for each replacement what went over its rate limit
+     (spilled), followed by the extra copies it got (MRMREPLPOL_REPLICATE, also counted in what went to it) */
+  struct mrm_counter  counters[];
+};
+#define MRM_REMAP_STATS_SIZE(COUNTER_COUNT) (sizeof(struct mrm_remap_stats) + ((COUNTER_COUNT) * sizeof(struct mrm_counter)))
+#define MRM_REMAP_STATS_LIMIT (MRM_MAX_CLASSES * (MRM_FILTER_RULES_LIMIT + (3 * MRM_REPLACE_GROUP_LIMIT)))
+
+struct mrm_mcast_stats {
+  unsigned char       group_macaddr[6];
+  struct mrm_counter  converted;     /* multicast frames converted to unicast */
+  struct mrm_counter  copies;        /* the unicast copies sent for them */
+};
+
+#define MRM_GETSTATS          _IOR  (MRM_IOCTL_TYPE, 50, struct mrm_stats)
+#define MRM_GETREMAPSTATS     _IOWR (MRM_IOCTL_TYPE, 51, struct mrm_remap_stats)
+#define MRM_RESETSTATS        _IO   (MRM_IOCTL_TYPE, 52)
+#define MRM_GETMCASTSTATS     _IOWR (MRM_IOCTL_TYPE, 53, struct mrm_mcast_stats)
+
+/* ioctl()s for the sampled remap decisions... every Nth frame moved to a replacement (on each cpu) gets a
+   record in the ring of the cpu, and the rings of all the cpus can be mmap()ed from the control file
+   MRM_SETDECISIONSAMPLE: 0 stops the sampling... the rings get allocated the first time it is started and
+                          stay (and keep their records) until the module is unloaded
+   MRM_GETDECISIONRING: ring_count is 0 until then... mmap() ring_count * ring_size bytes at offset 0, cpu N's
+                        ring (struct mrm_decision_ring) being the one at N * ring_size */
+struct mrm_decision_ring_info {
+  unsigned  sample_every;  /* 0 = off */
+  unsigned  ring_count;
+  unsigned  ring_size;     /* bytes... a multiple of the page size */
+};
+
+/* one per cpu... the kernel only ever writes head and lost, the reader only ever tail:
+   records [tail, head) are there to read (record i being at record_offset + (i % record_count) * record_size),
+   and once done with them the reader moves tail up to head... head and tail wrap around (use head - tail),
+   and the kernel drops (and counts) new records while the ring is full */
+struct mrm_decision_ring {
+  uint32_t  record_count;  /* a power of 2 */
+  uint32_t  record_size;   /* sizeof(struct mrm_decision) */
+  uint32_t  record_offset; /* from the start of the ring */
+  uint32_t  head;          /* records written so far */
+  uint64_t  lost;          /* records dropped for a full ring so far */
+  uint8_t   pad0[40];
+  uint32_t  tail;          /* records read so far (a cache line of its own) */
+  uint8_t   pad1[60];
+};
+
+struct mrm_decision {
+  uint64_t      timestamp;          /* nanoseconds since the epoch */
+  uint8_t       saddr[16];          /* ipv4 addresses are v4-mapped, all zeros when there is no flow (ipv6 frames for now) */
+  uint8_t       daddr[16];
+  uint16_t      sport;              /* 0 for non tcp/udp */
+  uint16_t      dport;
+  uint32_t      len;                /* the frame length */
+  unsigned char match_macaddr[6];
+  unsigned char replace_macaddr[6];
+  uint16_t      replace_idx;        /* of the replacement set (the remap class's own or its replacement group) */
+  uint8_t       family;             /* AF_INET, AF_INET6 or 0 */
+  uint8_t       proto;
+};
+
+#define MRM_SETDECISIONSAMPLE _IOW  (MRM_IOCTL_TYPE, 60, unsigned)
+#define MRM_GETDECISIONRING   _IOR  (MRM_IOCTL_TYPE, 61, struct mrm_decision_ring_info)
 
 /* ioctl() for completely blowing away the running configuration */
 #define MRM_WIPERUNCONF    _IO   (MRM_IOCTL_TYPE, 100)
@@ -0,0 +1,112 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+* Copyright (c) 2018 Cable Television Laboratories, Inc. ("CableLabs")
+*                    and others.  All rights reserved.
+*
+* Created by Jon Dennis (j.dennis@cablelabs.com)
+*/
+
+#ifndef MACREMAPPER_NETLINK_H_INCLUDED
+#define MACREMAPPER_NETLINK_H_INCLUDED
+
+/*
+
+  This file defines the generic netlink family used for the
+  user to kernel calls... an alternative to the ioctl()s that
+  can walk (dump) the whole configuration in a few large
+  messages, and that tells listeners about every change...
+  all of it (but the generation) takes CAP_NET_ADMIN, the
+  same as the ioctl()s take opening the control file
+
+*/
+
+#include "./macremapper_filter_config.h"
+
+#define MRM_GENL_NAME     "MACREMAPPER"
+#define MRM_GENL_VERSION  1
+#define MRM_GENL_MCGRP    "config" /* multicast group the change notifications go out on */
+
+/* commands... the GET ones also support NLM_F_DUMP to walk all the filters/remaps/groups/multicast groups,
+   and the SET/DEL ones also go out as notifications (carrying the new generation)...
+   a filter (or group) always goes in a single message, up to about 36k for MRM_FILTER_RULES_LIMIT rules,
+   so receive with a buffer at least that large */
+enum {
+  MRM_GENL_CMD_UNSPEC = 0,
+  MRM_GENL_CMD_GETFILTER,     /* by MRM_GENLA_FILTER_NAME */
+  MRM_GENL_CMD_SETFILTER,     /* MRM_GENLA_FILTER_NAME + MRM_GENLA_FILTER_RULES */
+  MRM_GENL_CMD_DELFILTER,     /* by MRM_GENLA_FILTER_NAME */
+  MRM_GENL_CMD_GETREMAP,      /* by MRM_GENLA_REMAP_MACADDR */
+  MRM_GENL_CMD_SETREMAP,      /* MRM_GENLA_REMAP_MACADDR + MRM_GENLA_REMAP_CLASSES */
+  MRM_GENL_CMD_DELREMAP,      /* by MRM_GENLA_REMAP_MACADDR */
+  MRM_GENL_CMD_GETGENERATION, /* just the MRM_GENLA_GENERATION */
+  MRM_GENL_CMD_RESYNC,        /* notification only... everything changed at once (wipe, staged commit), dump again */
+  MRM_GENL_CMD_GETGROUP,      /* by MRM_GENLA_GROUP_NAME */
+  MRM_GENL_CMD_SETGROUP,      /* MRM_GENLA_GROUP_NAME + MRM_GENLA_GROUP_REPLACEMENTS */
+  MRM_GENL_CMD_DELGROUP,      /* by MRM_GENLA_GROUP_NAME... fails with EADDRINUSE while any remap still uses the group */
+  MRM_GENL_CMD_GETMCAST,      /* by MRM_GENLA_MCAST_MACADDR */
+  MRM_GENL_CMD_SETMCAST,      /* MRM_GENLA_MCAST_MACADDR + MRM_GENLA_MCAST_MEMBERS (+ MRM_GENLA_MCAST_KEEP_ORIGINAL) */
+  MRM_GENL_CMD_DELMCAST,      /* by MRM_GENLA_MCAST_MACADDR */
+  __MRM_GENL_CMD_MAX,
+};
+#define MRM_GENL_CMD_MAX (__MRM_GENL_CMD_MAX - 1)
+
+/* top level attributes... */
+enum {
+  MRM_GENLA_UNSPEC = 0,
+  MRM_GENLA_GENERATION,       /* u32: bumped by every filter/remap/group/multicast group change, in every reply and notification */
+  MRM_GENLA_FILTER_NAME,      /* string, up to MRM_FILTER_NAME_MAX */
+  MRM_GENLA_FILTER_RULES,     /* nested: MRM_GENLA_FILTER_RULE... */
+  MRM_GENLA_FILTER_RULE,      /* binary: struct mrm_filter_rule */
+  MRM_GENLA_REMAP_MACADDR,    /* binary: 6 bytes */
+  MRM_GENLA_REMAP_CLASSES,    /* nested: MRM_GENLA_REMAP_CLASS... in evaluation order */
+  MRM_GENLA_REMAP_CLASS,      /* nested: MRM_GENLA_CLASS_* */
+  MRM_GENLA_REMAP_SHADOW,     /* flag: the remap is in shadow mode (see struct mrm_remap_entry) */
+  MRM_GENLA_REMAP_IDLE_TIMEOUT, /* u32: seconds (see struct mrm_remap_entry), optional */
+  MRM_GENLA_GROUP_NAME,       /* string, up to MRM_FILTER_NAME_MAX */
+  MRM_GENLA_GROUP_REPLACEMENTS, /* nested: MRM_GENLA_GROUP_REPLACEMENT... */
+  MRM_GENLA_GROUP_REPLACEMENT,  /* nested: MRM_GENLA_REPL_* */
+  MRM_GENLA_MCAST_MACADDR,    /* binary: 6 bytes, the multicast group MAC address */
+  MRM_GENLA_MCAST_KEEP_ORIGINAL, /* flag: MRMMCAST_KEEP_ORIGINAL (see struct mrm_mcast_group) */
+  MRM_GENLA_MCAST_MEMBERS,    /* nested: MRM_GENLA_MCAST_MEMBER... */
+  MRM_GENLA_MCAST_MEMBER,     /* nested: MRM_GENLA_MEMBER_* */
+  __MRM_GENLA_MAX,
+};
+#define MRM_GENLA_MAX (__MRM_GENLA_MAX - 1)
+
+/* attributes of a remap class (see struct mrm_remap_class)... */
+enum {
+  MRM_GENLA_CLASS_UNSPEC = 0,
+  MRM_GENLA_CLASS_FILTER_NAME,     /* string, up to MRM_FILTER_NAME_MAX */
+  MRM_GENLA_CLASS_POLICY,          /* u32: MRMREPLPOL_* (default round-robin) */
+  MRM_GENLA_CLASS_SPILL,           /* u32: MRMSPILL_* (default next) */
+  MRM_GENLA_CLASS_ELEPHANT_BYTES,  /* u32 */
+  MRM_GENLA_CLASS_ELEPHANT_WINDOW, /* u32: milliseconds */
+  MRM_GENLA_CLASS_REPLACEMENTS,    /* nested: MRM_GENLA_CLASS_REPLACEMENT... (may be left out with a group name) */
+  MRM_GENLA_CLASS_REPLACEMENT,     /* nested: MRM_GENLA_REPL_* */
+  MRM_GENLA_CLASS_GROUP_NAME,      /* string, up to MRM_FILTER_NAME_MAX: the replacement group used instead */
+  __MRM_GENLA_CLASS_MAX,
+};
+#define MRM_GENLA_CLASS_MAX (__MRM_GENLA_CLASS_MAX - 1)
+
+/* attributes of a replacement (of a class or of a group)... */
+enum {
+  MRM_GENLA_REPL_UNSPEC = 0,
+  MRM_GENLA_REPL_MACADDR,     /* binary: 6 bytes */
+  MRM_GENLA_REPL_IFNAME,      /* string: optional */
+  MRM_GENLA_REPL_WEIGHT,      /* u32: optional */
+  MRM_GENLA_REPL_RATE,        /* u32: optional, bytes per second */
+  MRM_GENLA_REPL_BURST,       /* u32: optional, bytes */
+  __MRM_GENLA_REPL_MAX,
+};
+#define MRM_GENLA_REPL_MAX (__MRM_GENLA_REPL_MAX - 1)
+
+/* attributes of a multicast group member... */
+enum {
+  MRM_GENLA_MEMBER_UNSPEC = 0,
+  MRM_GENLA_MEMBER_MACADDR,   /* binary: 6 bytes */
+  MRM_GENLA_MEMBER_IFNAME,    /* string: the bridge port the station sits behind (required) */
+  __MRM_GENLA_MEMBER_MAX,
+};
+#define MRM_GENLA_MEMBER_MAX (__MRM_GENLA_MEMBER_MAX - 1)
+
+#endif /* #ifndef MACREMAPPER_NETLINK_H_INCLUDED */
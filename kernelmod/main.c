@@ -10,12 +10,26 @@
 #include <linux/kernel.h>
 #include <linux/version.h>
 #include <linux/netfilter.h>
+#include <linux/etherdevice.h>
 
 #include <linux/netfilter_bridge.h>
 
 #include "./mrm_runconf.h"
 #include "./mrm_rcdb.h"
 #include "./mrm_ctlfile.h"
+#include "./mrm_flowtable.h"
+#include "./mrm_loadbal.h"
+#include "./mrm_elephant.h"
+#include "./mrm_devwatch.h"
+#include "./mrm_genl.h"
+#include "./mrm_checkpoint.h"
+#include "./mrm_stats.h"
+#include "./mrm_latency.h"
+#include "./mrm_decision.h"
+#include "./mrm_aging.h"
+
+#define CREATE_TRACE_POINTS
+#include "./mrm_trace.h"
 
 #if LINUX_VERSION_CODE < KERNEL_VERSION(3,7,0)
 #error Linux Kernel Version 3.7+ is required!
@@ -43,16 +57,20 @@ mrm_bridge_outbound_hook(
 
 #endif
 
+  struct sk_buff_head copies;
+  struct sk_buff *nskb;
+  unsigned int verdict;
   unsigned char *dstmac;
+  u64 t;
 
   if (skb == NULL) {
-    printk(KERN_WARNING "MRM NULL SKB\n");
+    printk_ratelimited(KERN_WARNING "MRM NULL SKB\n");
     return NF_ACCEPT;
   }
 
   dstmac = skb_mac_header(skb);
   if (dstmac == NULL) {
-    printk(KERN_WARNING "MRM NULL SKB MAC Header\n");
+    printk_ratelimited(KERN_WARNING "MRM NULL SKB MAC Header\n");
     return NF_ACCEPT;
   }
 
@@ -68,12 +86,41 @@ mrm_bridge_outbound_hook(
   */
 
 
+  mrm_stats_count(MRM_STAT_HOOK, skb->len);
+  t = mrm_latency_hook_begin();
+
+  /* otherwise NF_ACCEPT as we dont intend to filter out any traffic */
+  verdict = NF_ACCEPT;
+  __skb_queue_head_init(&copies);
+
   rcu_read_lock();
-  mrm_perform_ethernet_remap(dstmac, skb); /* XXX return value ? */
+  if (is_multicast_ether_addr(dstmac)) {
+    /* multicast groups we convert to unicast may have the multicast frame itself suppressed */
+    if (mrm_perform_multicast_to_unicast(dstmac, skb, &copies)) {
+      verdict = NF_DROP; /* the unicast copies are on their way instead */
+    }
+  }
+  else {
+    mrm_perform_ethernet_remap(dstmac, skb, &copies); /* XXX return value ? */
+  }
   rcu_read_unlock();
+  mrm_latency_hook_end(t);
+
+  /* the copies go out the same way the frame itself does once we accept it... the bridge's
+     own transmit (br_dev_queue_push_xmit()), which pushes the ethernet header back on, drops
+     what is too big for the port and sets up the checksum offload of vlan tagged frames.
+     the bridge applied the egress port's vlan policy before calling the hook, which the copies
+     inherit from the frame (a copy moved to a replacement's interface keeps it too, same as
+     the frames moved there) */
+  while ((nskb = __skb_dequeue(&copies)) != NULL) {
+#if LINUX_VERSION_CODE < KERNEL_VERSION(4,0,0)
+    okfn(nskb);
+#else
+    state->okfn(state->net, state->sk, nskb);
+#endif
+  }
 
-  /* always return NF_ACCEPT as we dont intend to filter out any traffic */
-  return NF_ACCEPT;
+  return verdict;
 }
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4,13,0)
@@ -96,8 +143,39 @@ static int __init
 modinit( void ) {
   int rv;
 
+  rv = mrm_stats_init();
+  if (rv != 0) goto fail_stats;
+
+  rv = mrm_latency_init();
+  if (rv != 0) goto fail_latency;
+
+  rv = mrm_decision_init();
+  if (rv != 0) goto fail_decision;
+
   rv = mrm_rcdb_init();
-  if (rv != 0) return rv;
+  if (rv != 0) goto fail_rcdb;
+
+  rv = mrm_flowtable_init();
+  if (rv != 0) goto fail_flowtable;
+
+  rv = mrm_loadbal_init();
+  if (rv != 0) goto fail_loadbal;
+
+  rv = mrm_elephant_init();
+  if (rv != 0) goto fail_elephant;
+
+  rv = mrm_devwatch_init();
+  if (rv != 0) goto fail_devwatch;
+
+  rv = mrm_genl_init();
+  if (rv != 0) goto fail_genl;
+
+  rv = mrm_aging_init();
+  if (rv != 0) goto fail_aging;
+
+  /* the configuration is back in place before the first frame goes by... a checkpoint
+     that cant be restored doesnt keep the module out, it just starts out empty */
+  mrm_checkpoint_init();
 
   nf_register_hook(&_hops);
   mrm_init_ctlfile(); /* XXX not checking for failure! */
@@ -105,13 +183,44 @@ modinit( void ) {
   printk(KERN_INFO "MRM The MAC Address Re-Mapper is now in the kernel\n");
 
   return 0; /* all is good */
+
+  /* unwind whatever got initialized, in reverse order... */
+fail_aging:
+  mrm_genl_destroy();
+fail_genl:
+  mrm_devwatch_destroy();
+fail_devwatch:
+  mrm_elephant_destroy();
+fail_elephant:
+  mrm_loadbal_destroy();
+fail_loadbal:
+  mrm_flowtable_destroy();
+fail_flowtable:
+  mrm_rcdb_destroy();
+fail_rcdb:
+  mrm_decision_destroy();
+fail_decision:
+  mrm_latency_destroy();
+fail_latency:
+  mrm_stats_destroy();
+fail_stats:
+  return rv;
 }
 
 static void __exit
 modexit( void ) {
   mrm_destroy_ctlfile();
   nf_unregister_hook(&_hops);
-  mrm_rcdb_destroy(); /* imperative that this happens last */
+  mrm_aging_destroy(); /* it sends netlink notifications */
+  mrm_genl_destroy();
+  mrm_devwatch_destroy();
+  mrm_elephant_destroy();
+  mrm_loadbal_destroy();
+  mrm_flowtable_destroy();
+  mrm_rcdb_destroy(); /* imperative that this happens last... */
+  mrm_decision_destroy(); /* ...but for what the hook was keeping track of */
+  mrm_latency_destroy();
+  mrm_stats_destroy();
   printk(KERN_INFO "MRM The MAC Address Re-Mapper gone bye-bye\n");
 }
 
@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+* Copyright (c) 2018 Cable Television Laboratories, Inc. ("CableLabs")
+*                    and others.  All rights reserved.
+*
+* Created by Jon Dennis (j.dennis@cablelabs.com)
+*/
+
+
+
+#include "./mrm_aging.h"
+#include "./mrm_runconf.h"
+
+#include <linux/module.h>
+#include <linux/workqueue.h>
+#include <linux/jiffies.h>
+
+
+/* idle timeouts are in seconds... no point looking any more often */
+#define REMAP_AGING_INTERVAL HZ
+
+static struct delayed_work _aging_work;
+
+
+static void
+mrm_aging_run(struct work_struct *work) {
+  /* nothing left that can go idle? go idle until mrm_aging_kick() */
+  if (mrm_age_remaps() > 0) mrm_aging_kick();
+}
+
+int
+mrm_aging_init( void ) {
+  /* deferrable... an idle system need not wake up just to find nothing to age out */
+  INIT_DEFERRABLE_WORK(&_aging_work, &mrm_aging_run);
+  return 0; /* success */
+}
+
+void
+mrm_aging_destroy( void ) {
+  cancel_delayed_work_sync(&_aging_work);
+}
+
+void
+mrm_aging_kick( void ) {
+  schedule_delayed_work(&_aging_work, REMAP_AGING_INTERVAL); /* no-op if already queued */
+}
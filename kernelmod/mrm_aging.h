@@ -0,0 +1,24 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+* Copyright (c) 2018 Cable Television Laboratories, Inc. ("CableLabs")
+*                    and others.  All rights reserved.
+*
+* Created by Jon Dennis (j.dennis@cablelabs.com)
+*/
+
+#ifndef MRM_AGING_H_INCLUDED
+#define MRM_AGING_H_INCLUDED
+
+/*
+  the remap aging worker...
+
+  periodically (off the "critical path") deletes the remaps that
+  have an idle timeout and have not been hit for that long... goes
+  idle while there are none of those
+*/
+
+int mrm_aging_init( void );
+void mrm_aging_destroy( void );
+void mrm_aging_kick( void );
+
+#endif /* #ifndef MRM_AGING_H_INCLUDED */
@@ -0,0 +1,330 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+* Copyright (c) 2018 Cable Television Laboratories, Inc. ("CableLabs")
+*                    and others.  All rights reserved.
+*
+* Created by Jon Dennis (j.dennis@cablelabs.com)
+*/
+
+#include "./mrm_checkpoint.h"
+#include "./mrm_runconf.h"
+#include "./mrm_private.h"
+
+#include <linux/module.h>
+#include <linux/version.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/string.h>
+#include <linux/firmware.h>
+
+
+/* tunables... */
+static char *checkpoint;
+module_param(checkpoint, charp, 0444);
+MODULE_PARM_DESC(checkpoint, "Firmware file (e.g. under /lib/firmware) with a checkpoint to restore the configuration from when loaded");
+
+
+
+/* the same walk fills in the checkpoint and (with no buffer) adds up how big it is... */
+struct mrm_checkpoint_writer {
+  char     *buf;   /* NULL when just adding up the size */
+  size_t    room;
+  size_t    used;
+  unsigned  record_count;
+};
+
+/* a record is its header followed by the data, which may come in two parts (a header and an array) */
+static int
+mrm_checkpoint_put(
+  struct mrm_checkpoint_writer * const w,
+  const uint32_t type,
+  const void * const part1,
+  const size_t size1,
+  const void * const part2,
+  const size_t size2
+  ) {
+  const size_t total = MRM_CHECKPOINT_ALIGNED(sizeof(struct mrm_checkpoint_record) + size1 + size2);
+  struct mrm_checkpoint_record *rec;
+  char *data;
+
+  if (w->used + total > MRM_CHECKPOINT_SIZE_LIMIT) return -E2BIG;
+
+  if (w->buf != NULL) {
+    if (w->used + total > w->room) return -EAGAIN; /* cant happen... it doesnt change under the runconf lock */
+    rec = (struct mrm_checkpoint_record *)(w->buf + w->used);
+    rec->type = type;
+    rec->size = size1 + size2;
+    data = (char *)(rec + 1);
+    memcpy(data, part1, size1);
+    memcpy(data + size1, part2, size2);
+    memset(data + size1 + size2, 0, total - sizeof(*rec) - size1 - size2); /* the padding */
+  }
+
+  w->used += total;
+  ++w->record_count;
+  return 0; /* success */
+}
+
+static int
+mrm_checkpoint_put_group(const struct mrm_replace_group * const g, void * const p) {
+  return mrm_checkpoint_put(p, MRM_CHECKPOINT_GROUP, g, MRM_REPLACE_GROUP_SIZE(g->replace_count), NULL, 0);
+}
+
+static int
+mrm_checkpoint_put_filter(const char * const name, const struct mrm_filter_rule * const rules, const unsigned rule_count, void * const p) {
+  struct mrm_filter_config_v2 hdr;
+
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.version    = MRM_FILTER_CONFIG_V2;
+  hdr.rule_count = rule_count;
+  strncpy(hdr.name, name, sizeof(hdr.name));
+  return mrm_checkpoint_put(p, MRM_CHECKPOINT_FILTER, &hdr, sizeof(hdr), rules, rule_count * sizeof(rules[0]));
+}
+
+static int
+mrm_checkpoint_put_remap(const struct mrm_remap_entry * const e, void * const p) {
+  /* only the classes in use... that is most of the remap entry when it has only a few */
+  return mrm_checkpoint_put(p, MRM_CHECKPOINT_REMAP, e, MRM_CHECKPOINT_REMAP_SIZE(e->class_count), NULL, 0);
+}
+
+static int
+mrm_checkpoint_put_mcast(const struct mrm_mcast_group * const g, void * const p) {
+  return mrm_checkpoint_put(p, MRM_CHECKPOINT_MCAST, g, sizeof(*g), NULL, 0);
+}
+
+static int
+mrm_checkpoint_write(struct mrm_checkpoint_writer * const w) {
+  struct mrm_checkpoint_header *hdr;
+  struct mrm_rcdb_cursor cursor;
+  int rv;
+
+  w->used         = sizeof(*hdr);
+  w->record_count = 0;
+
+  memset(&cursor, 0, sizeof(cursor));
+  rv = mrm_walk_groups(&cursor, &mrm_checkpoint_put_group, w);
+  if (rv != 0) return rv;
+
+  memset(&cursor, 0, sizeof(cursor));
+  rv = mrm_walk_filters(&cursor, &mrm_checkpoint_put_filter, w);
+  if (rv != 0) return rv;
+
+  memset(&cursor, 0, sizeof(cursor));
+  rv = mrm_walk_remaps(&cursor, &mrm_checkpoint_put_remap, w);
+  if (rv != 0) return rv;
+
+  memset(&cursor, 0, sizeof(cursor));
+  rv = mrm_walk_mcast_groups(&cursor, &mrm_checkpoint_put_mcast, w);
+  if (rv != 0) return rv;
+
+  if (w->buf != NULL) {
+    hdr = (struct mrm_checkpoint_header *)w->buf;
+    hdr->magic        = MRM_CHECKPOINT_MAGIC;
+    hdr->version      = MRM_CHECKPOINT_VERSION;
+    hdr->size         = w->used;
+    hdr->record_count = w->record_count;
+  }
+  return 0; /* success */
+}
+
+int
+mrm_checkpoint_export( void ** const output, size_t * const size ) {
+  struct mrm_checkpoint_writer w;
+  int rv;
+
+  /* first how big it is, then the real thing... */
+  memset(&w, 0, sizeof(w));
+  rv = mrm_checkpoint_write(&w);
+  if (rv != 0) return rv;
+
+  w.room = w.used;
+  w.buf  = vmalloc(w.room);
+  if (w.buf == NULL) {
+    return -ENOMEM;
+  }
+
+  rv = mrm_checkpoint_write(&w);
+  if (rv != 0) {
+    vfree(w.buf);
+    return rv;
+  }
+
+  *output = w.buf;
+  *size   = w.used;
+  return 0; /* success */
+}
+
+
+
+static inline const struct mrm_checkpoint_record *
+mrm_checkpoint_next(const struct mrm_checkpoint_record * const rec) {
+  return (const struct mrm_checkpoint_record *)((const char *)rec + MRM_CHECKPOINT_ALIGNED(sizeof(*rec) + rec->size));
+}
+
+/* makes sure the checkpoint is well formed before anything gets touched...
+   the contents get validated the same as always when they are restored */
+static int
+mrm_checkpoint_check(const void * const buf, const size_t size) {
+  const struct mrm_checkpoint_header * const hdr = buf;
+  const struct mrm_checkpoint_record *rec;
+  const struct mrm_filter_config_v2 *filt;
+  const struct mrm_replace_group *group;
+  const struct mrm_remap_entry *remap;
+  size_t left;
+  unsigned i;
+
+  if ((size < sizeof(*hdr)) || (hdr->magic != MRM_CHECKPOINT_MAGIC)) {
+    printk(KERN_WARNING "MRM Not a checkpoint!\n");
+    return -EINVAL;
+  }
+  if (hdr->version != MRM_CHECKPOINT_VERSION) {
+    printk(KERN_WARNING "MRM Unsupported checkpoint version %u!\n", hdr->version);
+    return -EINVAL;
+  }
+  if ((hdr->size < sizeof(*hdr)) || (hdr->size > size)) {
+    printk(KERN_WARNING "MRM Truncated checkpoint!\n");
+    return -EINVAL;
+  }
+
+  left = hdr->size - sizeof(*hdr);
+  rec  = (const struct mrm_checkpoint_record *)(hdr + 1);
+  for (i = 0; i < hdr->record_count; ++i, rec = mrm_checkpoint_next(rec)) {
+    if ((left < sizeof(*rec)) || (rec->size > left - sizeof(*rec))) goto bad_record;
+
+    switch (rec->type) {
+    case MRM_CHECKPOINT_GROUP:
+      group = (const void *)(rec + 1);
+      if (rec->size < sizeof(*group)) goto bad_record;
+      if ((group->replace_count > MRM_REPLACE_GROUP_LIMIT) || (rec->size != MRM_REPLACE_GROUP_SIZE(group->replace_count))) goto bad_record;
+      break;
+    case MRM_CHECKPOINT_FILTER:
+      filt = (const void *)(rec + 1);
+      if ((rec->size < sizeof(*filt)) || (filt->version != MRM_FILTER_CONFIG_V2)) goto bad_record;
+      if ((filt->rule_count > MRM_FILTER_RULES_LIMIT) || (rec->size != MRM_FILTER_CONFIG_V2_SIZE(filt->rule_count))) goto bad_record;
+      break;
+    case MRM_CHECKPOINT_REMAP:
+      remap = (const void *)(rec + 1);
+      if (rec->size < MRM_CHECKPOINT_REMAP_SIZE(0)) goto bad_record;
+      if ((remap->class_count > MRM_MAX_CLASSES) || (rec->size != MRM_CHECKPOINT_REMAP_SIZE(remap->class_count))) goto bad_record;
+      break;
+    case MRM_CHECKPOINT_MCAST:
+      if (rec->size != sizeof(struct mrm_mcast_group)) goto bad_record;
+      break;
+    default:
+      goto bad_record;
+    }
+
+    /* the padding after the last record may be left out... */
+    left -= min(left, (size_t)MRM_CHECKPOINT_ALIGNED(sizeof(*rec) + rec->size));
+  }
+
+  return 0; /* success */
+
+bad_record:
+  printk(KERN_WARNING "MRM Bad checkpoint record %u!\n", i);
+  return -EINVAL;
+}
+
+/* restores all the records of the one type... the remaps need a copy of their own, being cut short */
+static int
+mrm_checkpoint_restore_type(const struct mrm_checkpoint_header * const hdr, const uint32_t type, struct mrm_remap_entry * const e) {
+  const struct mrm_checkpoint_record *rec;
+  const void *data;
+  unsigned i;
+  int rv;
+
+  rec = (const struct mrm_checkpoint_record *)(hdr + 1);
+  for (i = 0; i < hdr->record_count; ++i, rec = mrm_checkpoint_next(rec)) {
+    if (rec->type != type) continue;
+    data = rec + 1;
+
+    switch (type) {
+    case MRM_CHECKPOINT_GROUP:
+      rv = mrm_set_group(data);
+      break;
+    case MRM_CHECKPOINT_FILTER:
+      rv = mrm_stage_filter(data);
+      break;
+    case MRM_CHECKPOINT_REMAP:
+      memset(e, 0, sizeof(*e));
+      memcpy(e, data, rec->size);
+      rv = mrm_stage_remap_entry(e);
+      break;
+    default:
+      rv = mrm_set_mcast_group(data);
+      break;
+    }
+    if (rv != 0) return rv;
+  }
+
+  return 0; /* success */
+}
+
+/* the filters and remaps get staged and swapped in all at once, so the running ones keep working until
+   then, and it costs one grace period however many there are. the groups have to be there before the
+   remaps refering to them get staged though... any set before a failure stay set */
+int
+mrm_checkpoint_restore( const void * const buf, const size_t size ) {
+  const struct mrm_checkpoint_header * const hdr = buf;
+  struct mrm_remap_entry *e;
+  int rv;
+
+  rv = mrm_checkpoint_check(buf, size);
+  if (rv != 0) return rv;
+
+  e = kmalloc(sizeof(*e), GFP_KERNEL); /* too big for the kernel stack */
+  if (e == NULL) {
+    return -ENOMEM;
+  }
+
+  rv = mrm_checkpoint_restore_type(hdr, MRM_CHECKPOINT_GROUP, e);
+  if (rv != 0) goto done;
+
+  rv = mrm_stage_begin();
+  if (rv != 0) goto done;
+  rv = mrm_checkpoint_restore_type(hdr, MRM_CHECKPOINT_FILTER, e);
+  if (rv == 0) rv = mrm_checkpoint_restore_type(hdr, MRM_CHECKPOINT_REMAP, e);
+  if (rv != 0) {
+    mrm_stage_abort();
+    goto done;
+  }
+  rv = mrm_stage_commit();
+  if (rv != 0) goto done;
+
+  rv = mrm_checkpoint_restore_type(hdr, MRM_CHECKPOINT_MCAST, e);
+
+done:
+  kfree(e);
+  return rv;
+}
+
+
+
+int
+mrm_checkpoint_init( void ) {
+  const struct firmware *fw;
+  int rv;
+
+  if ((checkpoint == NULL) || (checkpoint[0] == '\0')) return 0; /* nothing to restore */
+
+  /* straight from the filesystem... no waiting on a user space helper while the module loads */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3,14,0)
+  rv = request_firmware_direct(&fw, checkpoint, NULL);
+#else
+  rv = request_firmware(&fw, checkpoint, NULL);
+#endif
+  if (rv != 0) {
+    printk(KERN_WARNING "MRM Could not load checkpoint \"%s\": %d\n", checkpoint, rv);
+    return rv;
+  }
+
+  mrm_runconf_lock();
+  rv = mrm_checkpoint_restore(fw->data, fw->size);
+  mrm_runconf_unlock();
+
+  if (rv != 0) printk(KERN_WARNING "MRM Could not restore checkpoint \"%s\": %d\n", checkpoint, rv);
+  else printk(KERN_INFO "MRM Restored checkpoint \"%s\" (%u bytes)\n", checkpoint, (unsigned)fw->size);
+
+  release_firmware(fw);
+  return rv;
+}
@@ -0,0 +1,28 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+* Copyright (c) 2018 Cable Television Laboratories, Inc. ("CableLabs")
+*                    and others.  All rights reserved.
+*
+* Created by Jon Dennis (j.dennis@cablelabs.com)
+*/
+
+#ifndef MRM_CHECKPOINT_H_INCLUDED
+#define MRM_CHECKPOINT_H_INCLUDED
+
+#include "./macremapper_checkpoint.h"
+
+#include <linux/types.h>
+
+/*
+  the binary checkpoint of the whole running configuration (see macremapper_checkpoint.h)...
+
+  the caller holds the runconf lock for these... mrm_checkpoint_export() hands back a
+  vmalloc()ed checkpoint for the caller to vfree()
+*/
+int mrm_checkpoint_export( void ** const /* output */, size_t * const /* size */ );
+int mrm_checkpoint_restore( const void * const /* buf */, const size_t /* size */ );
+
+/* restores the checkpoint named by the "checkpoint" module parameter, if any... */
+int mrm_checkpoint_init( void );
+
+#endif /* #ifndef MRM_CHECKPOINT_H_INCLUDED */
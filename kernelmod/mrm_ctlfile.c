@@ -10,131 +10,623 @@
 
 #include "./mrm_ctlfile.h"
 #include "./mrm_runconf.h"
+#include "./mrm_checkpoint.h"
+#include "./mrm_decision.h"
 #include "./macremapper_ioctl.h"
-#include "./bufprintf.h"
 
 #include <linux/proc_fs.h>
 #include <linux/uaccess.h>
-#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/seq_file.h>
 
 
 #define PROC_FILENAME "macremapctl"
 
+/* entries copied in from user space at a time by the MRM_STAGE* vector ioctl()s */
+#define MRM_STAGE_BATCH 16
+
+/* whoever is staging a configuration (one at a time)... protected by the runconf lock */
+static struct file *_stage_owner;
 
-/* declare a mutex to enforce one transcation at a time
-   in the event multiple processes/tasks are using this
-   file concurrently...
-*/
-static struct mutex _ctrl_mutex;
 
 
 /* gets called when a userland process does a open("/proc/macremapctl",...) */
 static int
 mrm_handle_open (struct inode *in, struct file *f) {
-  f->private_data = NULL; /* currently only being used for the read() function result text */
-  return 0; /* success ? */
+  /* read()s stream the running configuration out... (f->private_data belongs to the seq_file) */
+  return mrm_open_running_configuration(f);
+}
+
+/* gets called when a userland process mmap()s "/proc/macremapctl"... only the remap decision rings can be */
+static int
+mrm_handle_mmap (struct file *f, struct vm_area_struct *vma) {
+  return mrm_decision_mmap(vma);
 }
 
 /* gets called when a userland process closes a file descriptor opened from "/proc/macremapctl" */
 static int
 mrm_handle_release (struct inode *in, struct file *f) {
-  if (f->private_data != NULL) {
-    /* currently only being used for the read() function result text */
-    kfree(f->private_data);
-    f->private_data = NULL; /* defensive */
+  /* a staged configuration never committed goes away with the file descriptor that staged it */
+  mrm_runconf_lock();
+  if (_stage_owner == f) {
+    mrm_stage_abort();
+    _stage_owner = NULL;
   }
-  return 0; /* success ? */
+  mrm_runconf_unlock();
+
+  return seq_release_private(in, f);
 }
 
-static ssize_t
-mrm_handle_read(struct file *f, char __user *buf, size_t size, loff_t *off) {
-  struct bufprintf_buf *tb;
-  int offset_content_size;
-  int copy_size;
+/* the fixed size (version 1) filters get converted to and from version 2 on the way through... */
+static int
+mrm_filter_from_v1(const struct mrm_filter_config * const v1, struct mrm_filter_config_v2 ** const output) {
+  struct mrm_filter_config_v2 *filt;
+
+  if (v1->rules_active > MRM_FILTER_MAX_RULES) return -E2BIG;
+
+  filt = kmalloc(MRM_FILTER_CONFIG_V2_SIZE(v1->rules_active), GFP_KERNEL);
+  if (filt == NULL) {
+    return -ENOMEM;
+  }
+  filt->version    = MRM_FILTER_CONFIG_V2;
+  filt->rule_count = v1->rules_active;
+  memcpy(filt->name, v1->name, sizeof(filt->name));
+  memcpy(filt->rules, v1->rules, v1->rules_active * sizeof(filt->rules[0]));
+
+  *output = filt;
+  return 0; /* success */
+}
+
+static int
+mrm_get_filter_v1(struct mrm_filter_config * const v1) {
+  struct mrm_filter_config_v2 *filt;
+  int rv;
+
+  filt = kmalloc(MRM_FILTER_CONFIG_V2_SIZE(MRM_FILTER_MAX_RULES), GFP_KERNEL);
+  if (filt == NULL) {
+    return -ENOMEM;
+  }
+  memcpy(filt->name, v1->name, sizeof(filt->name));
+
+  rv = mrm_get_filter(filt, MRM_FILTER_MAX_RULES);
+  if (rv == 0) {
+    v1->rules_active = filt->rule_count;
+    memcpy(v1->rules, filt->rules, filt->rule_count * sizeof(filt->rules[0]));
+  }
+  else if (rv == -ENOSPC) {
+    rv = -E2BIG; /* too many rules for version 1... MRM_GETFILTER2 it is */
+  }
+
+  kfree(filt);
+  return rv;
+}
 
-  /* Note: using f->private_data as our text buffer... */
-  if (f->private_data == NULL) {
-    /* this is the first call to read()... we need to generate the contents of this "virtual file" */
-    tb = f->private_data = kmalloc(sizeof(struct bufprintf_buf), GFP_KERNEL);
-    if (f->private_data == NULL) {
-      return -ENOMEM;
+/* the version 1 remaps (a single class with replacements of its own) get converted the same way... */
+static int
+mrm_set_remap_v1(const struct mrm_remap_entry_v1 * const v1) {
+  struct mrm_remap_entry *remap;
+  struct mrm_remap_class *cls;
+  unsigned i;
+  int rv;
+
+  if (v1->replace_count > MRM_MAX_REPLACE) return -EINVAL;
+
+  remap = kzalloc(sizeof(*remap), GFP_KERNEL); /* round-robin, no weights or rate limits, like version 1 always was */
+  if (remap == NULL) {
+    return -ENOMEM;
+  }
+  memcpy(remap->match_macaddr, v1->match_macaddr, sizeof(remap->match_macaddr));
+  remap->class_count = 1;
+  cls = &remap->classes[0];
+  memcpy(cls->filter_name, v1->filter_name, sizeof(cls->filter_name));
+  cls->replace_count = v1->replace_count;
+  for (i = 0; i < v1->replace_count; ++i) {
+    memcpy(cls->replace[i].macaddr, v1->replace[i].macaddr, sizeof(cls->replace[i].macaddr));
+    memcpy(cls->replace[i].ifname, v1->replace[i].ifname, sizeof(cls->replace[i].ifname));
+  }
+
+  rv = mrm_set_remap_entry(remap);
+  kfree(remap);
+  return rv;
+}
+
+static int
+mrm_get_remap_v1(struct mrm_remap_entry_v1 * const v1) {
+  struct mrm_remap_entry *remap;
+  const struct mrm_remap_class *cls;
+  unsigned i;
+  int rv;
+
+  remap = kzalloc(sizeof(*remap), GFP_KERNEL);
+  if (remap == NULL) {
+    return -ENOMEM;
+  }
+  memcpy(remap->match_macaddr, v1->match_macaddr, sizeof(remap->match_macaddr));
+
+  rv = mrm_get_remap_entry(remap);
+  if (rv == 0) {
+    cls = &remap->classes[0];
+    if ((remap->class_count != 1) || (cls->group_name[0] != '\0')) {
+      rv = -E2BIG; /* more than version 1 can describe... MRM_GETREMAP2 it is */
+    }
+    else {
+      memcpy(v1->filter_name, cls->filter_name, sizeof(v1->filter_name));
+      v1->replace_count = cls->replace_count;
+      for (i = 0; i < cls->replace_count; ++i) {
+        memcpy(v1->replace[i].macaddr, cls->replace[i].macaddr, sizeof(v1->replace[i].macaddr));
+        memcpy(v1->replace[i].ifname, cls->replace[i].ifname, sizeof(v1->replace[i].ifname));
+      }
     }
-    bufprintf_init(tb);
-    mutex_lock(&_ctrl_mutex);
-    mrm_bufprintf_running_configuration(tb);
-    mutex_unlock(&_ctrl_mutex);
   }
-  tb = f->private_data;
 
-  offset_content_size = tb->len - *off;
-  copy_size = (size > offset_content_size) ? offset_content_size : size;
+  kfree(remap);
+  return rv;
+}
+
+/* a version 2 filter in user space is the header followed by the rules... */
+static int
+mrm_filter_from_user(const void __user * const param, struct mrm_filter_config_v2 ** const output) {
+  struct mrm_filter_config_v2 hdr, *filt;
+
+  if (copy_from_user(&hdr, param, sizeof(hdr)) != 0) return -EFAULT;
+  if (hdr.version != MRM_FILTER_CONFIG_V2) return -EINVAL;
+  if (hdr.rule_count > MRM_FILTER_RULES_LIMIT) return -E2BIG;
+
+  filt = kmalloc(MRM_FILTER_CONFIG_V2_SIZE(hdr.rule_count), GFP_KERNEL);
+  if (filt == NULL) {
+    return -ENOMEM;
+  }
+  memcpy(filt, &hdr, sizeof(hdr));
+  if (copy_from_user(filt->rules, (const char __user *)param + sizeof(hdr), hdr.rule_count * sizeof(filt->rules[0])) != 0) {
+    kfree(filt);
+    return -EFAULT;
+  }
+
+  *output = filt;
+  return 0; /* success */
+}
+
+static int
+mrm_filter_to_user(void __user * const param) {
+  struct mrm_filter_config_v2 hdr, *filt;
+  unsigned room;
+  int rv;
+
+  if (copy_from_user(&hdr, param, sizeof(hdr)) != 0) return -EFAULT;
+  if (hdr.version != MRM_FILTER_CONFIG_V2) return -EINVAL;
+  room = min(hdr.rule_count, (unsigned)MRM_FILTER_RULES_LIMIT);
 
-  if ((*off) >= tb->len) {
-    return 0; /* return no bytes read as we hit the end of our content */
+  filt = kmalloc(MRM_FILTER_CONFIG_V2_SIZE(room), GFP_KERNEL);
+  if (filt == NULL) {
+    return -ENOMEM;
   }
+  memcpy(filt, &hdr, sizeof(hdr));
 
-  if (copy_to_user(buf, &tb->buf[*off], copy_size) != 0) return -EFAULT;
-  (*off) += copy_size;
+  rv = mrm_get_filter(filt, room);
+  if ((rv == 0) || (rv == -ENOSPC)) {
+    /* the header (with the actual rule count) goes back either way... */
+    if (copy_to_user(param, filt, sizeof(hdr)) != 0) rv = -EFAULT;
+    else if ((rv == 0) && (copy_to_user((char __user *)param + sizeof(hdr), filt->rules, filt->rule_count * sizeof(filt->rules[0])) != 0)) rv = -EFAULT;
+  }
 
-  return copy_size;
+  kfree(filt);
+  return rv;
+}
+
+/* a replacement group in user space is the header followed by the replacements... */
+static int
+mrm_group_from_user(const void __user * const param, struct mrm_replace_group ** const output) {
+  struct mrm_replace_group hdr, *group;
+
+  if (copy_from_user(&hdr, param, sizeof(hdr)) != 0) return -EFAULT;
+  if (hdr.replace_count > MRM_REPLACE_GROUP_LIMIT) return -E2BIG;
+
+  group = kmalloc(MRM_REPLACE_GROUP_SIZE(hdr.replace_count), GFP_KERNEL);
+  if (group == NULL) {
+    return -ENOMEM;
+  }
+  memcpy(group, &hdr, sizeof(hdr));
+  if (copy_from_user(group->replace, (const char __user *)param + sizeof(hdr), hdr.replace_count * sizeof(group->replace[0])) != 0) {
+    kfree(group);
+    return -EFAULT;
+  }
+
+  *output = group;
+  return 0; /* success */
+}
+
+/* same as mrm_filter_to_user()... */
+static int
+mrm_group_to_user(void __user * const param) {
+  struct mrm_replace_group hdr, *group;
+  unsigned room;
+  int rv;
+
+  if (copy_from_user(&hdr, param, sizeof(hdr)) != 0) return -EFAULT;
+  room = min(hdr.replace_count, (unsigned)MRM_REPLACE_GROUP_LIMIT);
+
+  group = kmalloc(MRM_REPLACE_GROUP_SIZE(room), GFP_KERNEL);
+  if (group == NULL) {
+    return -ENOMEM;
+  }
+  memcpy(group, &hdr, sizeof(hdr));
+
+  rv = mrm_get_group(group, room);
+  if ((rv == 0) || (rv == -ENOSPC)) {
+    /* the header (with the actual replacement count) goes back either way... */
+    if (copy_to_user(param, group, sizeof(hdr)) != 0) rv = -EFAULT;
+    else if ((rv == 0) && (copy_to_user((char __user *)param + sizeof(hdr), group->replace, group->replace_count * sizeof(group->replace[0])) != 0)) rv = -EFAULT;
+  }
+
+  kfree(group);
+  return rv;
+}
+
+/* the checkpoint only gets copied back when there is room for all of it... the size goes back either way */
+static int
+mrm_checkpoint_to_user(struct mrm_checkpoint_buffer * const cb) {
+  void *buf;
+  size_t size;
+  int rv;
+
+  rv = mrm_checkpoint_export(&buf, &size);
+  if (rv != 0) return rv;
+
+  if (size > cb->size) rv = -ENOSPC; /* the caller now knows how much room it takes */
+  else if (copy_to_user((void __user *)(uintptr_t)cb->data, buf, size) != 0) rv = -EFAULT;
+  cb->size = size;
+
+  vfree(buf);
+  return rv;
+}
+
+static int
+mrm_checkpoint_from_user(const struct mrm_checkpoint_buffer * const cb) {
+  void *buf;
+  int rv;
+
+  if (cb->size < sizeof(struct mrm_checkpoint_header)) return -EINVAL;
+  if (cb->size > MRM_CHECKPOINT_SIZE_LIMIT) return -E2BIG;
+
+  buf = vmalloc(cb->size);
+  if (buf == NULL) {
+    return -ENOMEM;
+  }
+  if (copy_from_user(buf, (const void __user *)(uintptr_t)cb->data, cb->size) != 0) {
+    vfree(buf);
+    return -EFAULT;
+  }
+
+  rv = mrm_checkpoint_restore(buf, cb->size);
+  vfree(buf);
+  return rv;
+}
+
+static int
+mrm_stats_to_user(void __user * const param) {
+  struct mrm_stats stats;
+
+  mrm_get_stats(&stats);
+  if (copy_to_user(param, &stats, sizeof(stats)) != 0) return -EFAULT;
+  return 0; /* success */
+}
+
+/* same as mrm_filter_to_user()... */
+static int
+mrm_remap_stats_to_user(void __user * const param) {
+  struct mrm_remap_stats hdr, *stats;
+  unsigned room;
+  int rv;
+
+  if (copy_from_user(&hdr, param, sizeof(hdr)) != 0) return -EFAULT;
+  room = min(hdr.counter_count, (unsigned)MRM_REMAP_STATS_LIMIT);
+
+  stats = kmalloc(MRM_REMAP_STATS_SIZE(room), GFP_KERNEL);
+  if (stats == NULL) {
+    return -ENOMEM;
+  }
+  memcpy(stats, &hdr, sizeof(hdr));
+
+  rv = mrm_get_remap_stats(stats, room);
+  if ((rv == 0) || (rv == -ENOSPC)) {
+    /* the header (with the actual counter count) goes back either way... */
+    if (copy_to_user(param, stats, sizeof(hdr)) != 0) rv = -EFAULT;
+    else if ((rv == 0) && (copy_to_user((char __user *)param + sizeof(hdr), stats->counters, stats->counter_count * sizeof(stats->counters[0])) != 0)) rv = -EFAULT;
+  }
+
+  kfree(stats);
+  return rv;
+}
+
+static int
+mrm_mcast_stats_to_user(void __user * const param) {
+  struct mrm_mcast_stats stats;
+  int rv;
+
+  if (copy_from_user(&stats, param, sizeof(stats)) != 0) return -EFAULT;
+  rv = mrm_get_mcast_stats(&stats);
+  if (rv == 0) {
+    /* only copy back to user on success */
+    if (copy_to_user(param, &stats, sizeof(stats)) != 0) return -EFAULT;
+  }
+  return rv;
+}
+
+/* stages each filter or remap of a MRM_STAGEFILTERS or MRM_STAGEREMAPS vector in turn... */
+static int
+mrm_handle_stage_vector(const unsigned int type, struct mrm_stage_vector * const vec) {
+  const size_t entry_size = (type == MRM_STAGEFILTERS) ? sizeof(struct mrm_filter_config) : sizeof(struct mrm_remap_entry);
+  const char __user *entries;
+  unsigned batch, i;
+  struct mrm_filter_config_v2 *filt;
+  char *buf;
+  int rv;
+
+  entries = (const char __user *)(uintptr_t)vec->entries;
+  vec->staged = 0;
+
+  buf = kmalloc_array(MRM_STAGE_BATCH, entry_size, GFP_KERNEL);
+  if (buf == NULL) {
+    return -ENOMEM;
+  }
+
+  rv = 0;
+  while (vec->staged < vec->count) {
+    batch = min(vec->count - vec->staged, (unsigned)MRM_STAGE_BATCH);
+    if (copy_from_user(buf, entries + ((size_t)vec->staged * entry_size), batch * entry_size) != 0) {
+      rv = -EFAULT;
+      break;
+    }
+
+    for (i = 0; i < batch; ++i) {
+      if (type == MRM_STAGEFILTERS) {
+        rv = mrm_filter_from_v1((const struct mrm_filter_config *)&buf[i * entry_size], &filt);
+        if (rv != 0) break;
+        rv = mrm_stage_filter(filt);
+        kfree(filt);
+      }
+      else {
+        rv = mrm_stage_remap_entry((const struct mrm_remap_entry *)&buf[i * entry_size]);
+      }
+      if (rv != 0) break;
+      ++vec->staged;
+    }
+    if (rv != 0) break;
+  }
+
+  kfree(buf);
+  return rv;
 }
 
 static long
 mrm_handle_ioctl(struct file *f, unsigned int type, void __user *param) {
+  /* a remap entry with all its classes is too big for the kernel stack... */
   union {
     struct mrm_filter_config  filt_conf;
     struct mrm_remap_entry    remap_entry;
+    struct mrm_remap_entry_v1 remap_entry_v1;
+    struct mrm_mcast_group    mcast_group;
+    struct mrm_replace_group  group;
+    struct mrm_stage_vector   stage_vec;
+    struct mrm_checkpoint_buffer checkpoint;
+    struct mrm_decision_ring_info decision_ring;
     unsigned                  count;
-  } u;
+  } *up;
+  struct mrm_filter_config_v2 *filt;
+  struct mrm_replace_group *group;
   int rv;
 
-  mutex_lock(&_ctrl_mutex);
+  /* reading the counters does not need the runconf mutex... they are per cpu, and what they belong to
+     is looked up under the rcu read lock... so a busy poller never holds up a configuration change */
+  switch (type) {
+  case MRM_GETSTATS:
+    return mrm_stats_to_user(param);
+  case MRM_GETREMAPSTATS:
+    return mrm_remap_stats_to_user(param);
+  case MRM_GETMCASTSTATS:
+    return mrm_mcast_stats_to_user(param);
+  }
+
+  up = kmalloc(sizeof(*up), GFP_KERNEL);
+  if (up == NULL) {
+    return -ENOMEM;
+  }
+
+  mrm_runconf_lock();
 
   switch (type) {
   /* ioctl()s for working with filters... */
   case MRM_GETFILTERCOUNT:
-    u.count = mrm_get_filter_count();
-    if (copy_to_user(param, &u.count, _IOC_SIZE(type)) != 0) goto fail_fault;
+    up->count = mrm_get_filter_count();
+    if (copy_to_user(param, &up->count, _IOC_SIZE(type)) != 0) goto fail_fault;
     rv = 0; /* success */
     break;
   case MRM_GETFILTER:
-    if (copy_from_user(&u.filt_conf, param, _IOC_SIZE(type)) != 0) goto fail_fault;
-    rv = mrm_get_filter(&u.filt_conf);
+    if (copy_from_user(&up->filt_conf, param, _IOC_SIZE(type)) != 0) goto fail_fault;
+    rv = mrm_get_filter_v1(&up->filt_conf);
     if (rv == 0) {
       /* only copy back to user on success */
-      if (copy_to_user(param, &u.filt_conf, _IOC_SIZE(type)) != 0) goto fail_fault;
+      if (copy_to_user(param, &up->filt_conf, _IOC_SIZE(type)) != 0) goto fail_fault;
     }
     break;
   case MRM_SETFILTER:
-    if (copy_from_user(&u.filt_conf, param, _IOC_SIZE(type)) != 0) goto fail_fault;
-    rv = mrm_set_filter(&u.filt_conf);
+    if (copy_from_user(&up->filt_conf, param, _IOC_SIZE(type)) != 0) goto fail_fault;
+    rv = mrm_filter_from_v1(&up->filt_conf, &filt);
+    if (rv != 0) break;
+    rv = mrm_set_filter(filt);
+    kfree(filt);
     break;
   case MRM_DELETEFILTER:
-    if (copy_from_user(&u.filt_conf, param, _IOC_SIZE(type)) != 0) goto fail_fault;
-    rv = mrm_delete_filter(&u.filt_conf);
+    if (copy_from_user(&up->filt_conf, param, _IOC_SIZE(type)) != 0) goto fail_fault;
+    rv = mrm_delete_filter(up->filt_conf.name);
+    break;
+  case MRM_GETFILTER2:
+    rv = mrm_filter_to_user(param);
+    break;
+  case MRM_SETFILTER2:
+    rv = mrm_filter_from_user(param, &filt);
+    if (rv != 0) break;
+    rv = mrm_set_filter(filt);
+    kfree(filt);
     break;
 
   /* ioctl()s for working with MAC address remappings... */
   case MRM_GETREMAPCOUNT:
-    u.count = mrm_get_remap_count();
-    if (copy_to_user(param, &u.count, _IOC_SIZE(type)) != 0) goto fail_fault;
+    up->count = mrm_get_remap_count();
+    if (copy_to_user(param, &up->count, _IOC_SIZE(type)) != 0) goto fail_fault;
     rv = 0; /* success */
     break;
   case MRM_GETREMAP:
-    if (copy_from_user(&u.remap_entry, param, _IOC_SIZE(type)) != 0) goto fail_fault;
-    rv = mrm_get_remap_entry(&u.remap_entry);
+    if (copy_from_user(&up->remap_entry_v1, param, _IOC_SIZE(type)) != 0) goto fail_fault;
+    rv = mrm_get_remap_v1(&up->remap_entry_v1);
     if (rv == 0) {
       /* only copy back to user on success */
-      if (copy_to_user(param, &u.remap_entry, _IOC_SIZE(type)) != 0) goto fail_fault;
+      if (copy_to_user(param, &up->remap_entry_v1, _IOC_SIZE(type)) != 0) goto fail_fault;
     }
     break;
   case MRM_SETREMAP:
-    if (copy_from_user(&u.remap_entry, param, _IOC_SIZE(type)) != 0) goto fail_fault;
-    rv = mrm_set_remap_entry(&u.remap_entry);
+    if (copy_from_user(&up->remap_entry_v1, param, _IOC_SIZE(type)) != 0) goto fail_fault;
+    rv = mrm_set_remap_v1(&up->remap_entry_v1);
     break;
   case MRM_DELETEREMAP:
-    if (copy_from_user(&u.remap_entry, param, _IOC_SIZE(type)) != 0) goto fail_fault;
-    rv = mrm_delete_remap(u.remap_entry.match_macaddr);
+    if (copy_from_user(&up->remap_entry_v1, param, _IOC_SIZE(type)) != 0) goto fail_fault;
+    rv = mrm_delete_remap(up->remap_entry_v1.match_macaddr);
+    break;
+  case MRM_GETREMAP2:
+    if (copy_from_user(&up->remap_entry, param, _IOC_SIZE(type)) != 0) goto fail_fault;
+    rv = mrm_get_remap_entry(&up->remap_entry);
+    if (rv == 0) {
+      /* only copy back to user on success */
+      if (copy_to_user(param, &up->remap_entry, _IOC_SIZE(type)) != 0) goto fail_fault;
+    }
+    break;
+  case MRM_SETREMAP2:
+    if (copy_from_user(&up->remap_entry, param, _IOC_SIZE(type)) != 0) goto fail_fault;
+    rv = mrm_set_remap_entry(&up->remap_entry);
+    break;
+
+  /* ioctl()s for working with multicast to unicast conversions... */
+  case MRM_GETMCASTCOUNT:
+    up->count = mrm_get_mcast_group_count();
+    if (copy_to_user(param, &up->count, _IOC_SIZE(type)) != 0) goto fail_fault;
+    rv = 0; /* success */
+    break;
+  case MRM_GETMCAST:
+    if (copy_from_user(&up->mcast_group, param, _IOC_SIZE(type)) != 0) goto fail_fault;
+    rv = mrm_get_mcast_group(&up->mcast_group);
+    if (rv == 0) {
+      /* only copy back to user on success */
+      if (copy_to_user(param, &up->mcast_group, _IOC_SIZE(type)) != 0) goto fail_fault;
+    }
+    break;
+  case MRM_SETMCAST:
+    if (copy_from_user(&up->mcast_group, param, _IOC_SIZE(type)) != 0) goto fail_fault;
+    rv = mrm_set_mcast_group(&up->mcast_group);
+    break;
+  case MRM_DELETEMCAST:
+    if (copy_from_user(&up->mcast_group, param, _IOC_SIZE(type)) != 0) goto fail_fault;
+    rv = mrm_delete_mcast_group(up->mcast_group.group_macaddr);
+    break;
+
+  /* ioctl()s for working with replacement groups... */
+  case MRM_GETGROUPCOUNT:
+    up->count = mrm_get_group_count();
+    if (copy_to_user(param, &up->count, _IOC_SIZE(type)) != 0) goto fail_fault;
+    rv = 0; /* success */
+    break;
+  case MRM_GETGROUP:
+    rv = mrm_group_to_user(param);
+    break;
+  case MRM_SETGROUP:
+    rv = mrm_group_from_user(param, &group);
+    if (rv != 0) break;
+    rv = mrm_set_group(group);
+    kfree(group);
+    break;
+  case MRM_DELETEGROUP:
+    if (copy_from_user(&up->group, param, _IOC_SIZE(type)) != 0) goto fail_fault;
+    rv = mrm_delete_group(up->group.name);
+    break;
+
+  /* ioctl()s for swapping in a complete configuration all at once... */
+  case MRM_STAGEBEGIN:
+    if ((_stage_owner != NULL) && (_stage_owner != f)) {
+      rv = -EBUSY; /* somebody else is staging */
+      break;
+    }
+    rv = mrm_stage_begin();
+    _stage_owner = (rv == 0) ? f : NULL;
+    break;
+  case MRM_STAGEFILTERS:
+  case MRM_STAGEREMAPS:
+    if (_stage_owner != f) {
+      rv = -EINVAL; /* MRM_STAGEBEGIN first */
+      break;
+    }
+    if (copy_from_user(&up->stage_vec, param, _IOC_SIZE(type)) != 0) goto fail_fault;
+    rv = mrm_handle_stage_vector(type, &up->stage_vec);
+    /* copy back to user even on failure... tells how far it got */
+    if (copy_to_user(param, &up->stage_vec, _IOC_SIZE(type)) != 0) goto fail_fault;
+    break;
+  case MRM_STAGEFILTER2:
+    if (_stage_owner != f) {
+      rv = -EINVAL; /* MRM_STAGEBEGIN first */
+      break;
+    }
+    rv = mrm_filter_from_user(param, &filt);
+    if (rv != 0) break;
+    rv = mrm_stage_filter(filt);
+    kfree(filt);
+    break;
+  case MRM_STAGECOMMIT:
+  case MRM_STAGEABORT:
+    if (_stage_owner != f) {
+      rv = -EINVAL; /* nothing staged */
+      break;
+    }
+    if (type == MRM_STAGECOMMIT) {
+      rv = mrm_stage_commit();
+    }
+    else {
+      mrm_stage_abort();
+      rv = 0; /* success */
+    }
+    _stage_owner = NULL;
+    break;
+
+  /* ioctl()s for exporting and restoring the whole running configuration... */
+  case MRM_GETCHECKPOINT:
+    if (copy_from_user(&up->checkpoint, param, _IOC_SIZE(type)) != 0) goto fail_fault;
+    rv = mrm_checkpoint_to_user(&up->checkpoint);
+    if ((rv == 0) || (rv == -ENOSPC)) {
+      if (copy_to_user(param, &up->checkpoint, _IOC_SIZE(type)) != 0) goto fail_fault;
+    }
+    break;
+  case MRM_RESTORECHECKPOINT:
+    if (_stage_owner != NULL) {
+      rv = -EBUSY; /* the restore stages too... somebody (maybe the caller) is already at it */
+      break;
+    }
+    if (copy_from_user(&up->checkpoint, param, _IOC_SIZE(type)) != 0) goto fail_fault;
+    rv = mrm_checkpoint_from_user(&up->checkpoint);
+    break;
+
+  /* ioctl()s for the data plane counters... (the ones reading them are handled up front) */
+  case MRM_RESETSTATS:
+    mrm_reset_stats();
+    rv = 0; /* success */
+    break;
+
+  /* ioctl()s for the sampled remap decisions... */
+  case MRM_SETDECISIONSAMPLE:
+    if (copy_from_user(&up->count, param, _IOC_SIZE(type)) != 0) goto fail_fault;
+    rv = mrm_decision_set_sample(up->count);
+    break;
+  case MRM_GETDECISIONRING:
+    mrm_decision_get_ring_info(&up->decision_ring);
+    if (copy_to_user(param, &up->decision_ring, _IOC_SIZE(type)) != 0) goto fail_fault;
+    rv = 0; /* success */
     break;
 
   /* ioctl() for completely blowing away the running configuration */
@@ -148,12 +640,13 @@ mrm_handle_ioctl(struct file *f, unsigned int type, void __user *param) {
     break;
   }
 
-  synchronize_rcu(); /* is this really necessary? */
-  mutex_unlock(&_ctrl_mutex);
+  mrm_runconf_unlock();
+  kfree(up);
   return rv;
 
 fail_fault:
-  mutex_unlock(&_ctrl_mutex);
+  mrm_runconf_unlock();
+  kfree(up);
   return -EFAULT;
 
 }
@@ -163,7 +656,9 @@ static const struct file_operations _fops = {
   owner:           THIS_MODULE,
   open:            &mrm_handle_open,
   release:         &mrm_handle_release,
-  read:            &mrm_handle_read,
+  read:            &seq_read,
+  llseek:          &seq_lseek,
+  mmap:            &mrm_handle_mmap,
   unlocked_ioctl:  (void*)&mrm_handle_ioctl,
 };
 
@@ -175,8 +670,6 @@ int mrm_init_ctlfile( void ) {
     return 0; /* failure */
   }
 
-  mutex_init(&_ctrl_mutex);
-
   return 1; /* success */
 }
 
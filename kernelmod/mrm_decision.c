@@ -0,0 +1,188 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+* Copyright (c) 2018 Cable Television Laboratories, Inc. ("CableLabs")
+*                    and others.  All rights reserved.
+*
+* Created by Jon Dennis (j.dennis@cablelabs.com)
+*/
+
+#include "./mrm_decision.h"
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/vmalloc.h>
+#include <linux/string.h>
+#include <linux/log2.h>
+#include <linux/ktime.h>
+#include <linux/smp.h>
+#include <net/ipv6.h>
+
+
+/* tunables... */
+static unsigned int decision_ring_records = 1024;
+module_param(decision_ring_records, uint, 0444);
+MODULE_PARM_DESC(decision_ring_records, "Sampled remap decisions kept per cpu until user space reads them");
+
+#define DECISION_RING_RECORDS_MAX (1U << 16)
+
+struct mrm_decision_pcpu __percpu *mrm_decision_pcpu;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,3,0)
+  DEFINE_STATIC_KEY_FALSE(mrm_decision_key);
+  #define mrm_decision_switch_on()  static_branch_enable(&mrm_decision_key)
+  #define mrm_decision_switch_off() static_branch_disable(&mrm_decision_key)
+#else
+  struct static_key mrm_decision_key = STATIC_KEY_INIT_FALSE;
+  #define mrm_decision_switch_on()  static_key_slow_inc(&mrm_decision_key)
+  #define mrm_decision_switch_off() static_key_slow_dec(&mrm_decision_key)
+#endif
+
+unsigned mrm_decision_sample_every; /* 0 = off */
+
+/* the rings of all the cpus back to back, ring_size apart... allocated once and kept until the module goes */
+static void *_rings;
+static unsigned _ring_size;
+static unsigned _record_count;
+
+
+
+void
+mrm_decision_record(
+    const struct mrm_flow_key * const key,
+    const unsigned char * const match_macaddr,
+    const unsigned char * const replace_macaddr,
+    const unsigned replace_idx,
+    const unsigned len
+  ) {
+  struct mrm_decision_pcpu * const d = this_cpu_ptr(mrm_decision_pcpu);
+  struct mrm_decision_ring * const ring = (struct mrm_decision_ring *)((char *)_rings + (smp_processor_id() * _ring_size));
+  struct mrm_decision *rec;
+
+  /* the reader is done with a record once it moves tail past it... */
+  if ((u32)(d->head - smp_load_acquire(&ring->tail)) >= _record_count) {
+    WRITE_ONCE(ring->lost, ++d->lost);
+    return; /* the ring is full */
+  }
+
+  /* not trusting anything the reader could have changed... */
+  rec = (struct mrm_decision *)((char *)ring + sizeof(*ring)) + (d->head & (_record_count - 1));
+  memset(rec, 0, sizeof(*rec));
+  rec->timestamp = ktime_to_ns(ktime_get_real());
+  if (key != NULL) {
+    if (key->family == AF_INET) {
+      ipv6_addr_set_v4mapped(key->saddr.ip4, (struct in6_addr *)rec->saddr);
+      ipv6_addr_set_v4mapped(key->daddr.ip4, (struct in6_addr *)rec->daddr);
+    }
+    else {
+      memcpy(rec->saddr, &key->saddr.ip6, 16);
+      memcpy(rec->daddr, &key->daddr.ip6, 16);
+    }
+    rec->sport  = key->sport;
+    rec->dport  = key->dport;
+    rec->family = key->family;
+    rec->proto  = key->proto;
+  }
+  rec->len = len;
+  memcpy(rec->match_macaddr, match_macaddr, 6);
+  memcpy(rec->replace_macaddr, replace_macaddr, 6);
+  rec->replace_idx = replace_idx;
+
+  /* ...and the record is only there for the reader once head moves past it */
+  smp_store_release(&ring->head, ++d->head);
+}
+
+
+
+static int
+mrm_decision_alloc_rings( void ) {
+  struct mrm_decision_ring *ring;
+  unsigned records;
+  unsigned cpu;
+  void *rings;
+
+  records = clamp(decision_ring_records, 1U, DECISION_RING_RECORDS_MAX);
+  records = roundup_pow_of_two(records);
+  _ring_size = PAGE_ALIGN(sizeof(*ring) + (records * sizeof(struct mrm_decision)));
+
+  /* zeroed, and ready to be mmap()ed to user space */
+  rings = vmalloc_user((unsigned long)_ring_size * nr_cpu_ids);
+  if (rings == NULL) {
+    printk(KERN_WARNING "MRM Failed to allocate the remap decision rings\n");
+    return -ENOMEM;
+  }
+  for (cpu = 0; cpu < nr_cpu_ids; ++cpu) {
+    ring = (struct mrm_decision_ring *)((char *)rings + (cpu * _ring_size));
+    ring->record_count  = records;
+    ring->record_size   = sizeof(struct mrm_decision);
+    ring->record_offset = sizeof(*ring);
+  }
+  _record_count = records;
+
+  smp_store_release(&_rings, rings); /* mmap() may be looking */
+  return 0; /* success */
+}
+
+int
+mrm_decision_set_sample( const unsigned every ) {
+  int rv;
+
+  if ((every > 0) && (_rings == NULL)) {
+    rv = mrm_decision_alloc_rings();
+    if (rv != 0) return rv;
+  }
+
+  if ((every > 0) && (mrm_decision_sample_every == 0)) {
+    WRITE_ONCE(mrm_decision_sample_every, every);
+    mrm_decision_switch_on();
+  }
+  else if ((every == 0) && (mrm_decision_sample_every > 0)) {
+    mrm_decision_switch_off();
+    WRITE_ONCE(mrm_decision_sample_every, 0);
+  }
+  else {
+    WRITE_ONCE(mrm_decision_sample_every, every); /* just a new rate... or still off */
+  }
+
+  return 0; /* success */
+}
+
+void
+mrm_decision_get_ring_info( struct mrm_decision_ring_info * const output ) {
+  memset(output, 0, sizeof(*output));
+  output->sample_every = mrm_decision_sample_every;
+  if (_rings != NULL) {
+    output->ring_count = nr_cpu_ids;
+    output->ring_size  = _ring_size;
+  }
+}
+
+int
+mrm_decision_mmap( struct vm_area_struct * const vma ) {
+  void * const rings = smp_load_acquire(&_rings);
+
+  if (rings == NULL) {
+    return -ENODEV; /* the sampling was never started */
+  }
+  /* checks the mapping fits in the rings... */
+  return remap_vmalloc_range(vma, rings, vma->vm_pgoff);
+}
+
+
+
+int
+mrm_decision_init( void ) {
+  mrm_decision_pcpu = alloc_percpu(struct mrm_decision_pcpu);
+  if (mrm_decision_pcpu == NULL) {
+    return -ENOMEM;
+  }
+  return 0; /* success */
+}
+
+void
+mrm_decision_destroy( void ) {
+  if (mrm_decision_sample_every > 0) {
+    mrm_decision_switch_off();
+  }
+  vfree(_rings); /* whatever user space still has mapped holds on to its pages */
+  free_percpu(mrm_decision_pcpu);
+}
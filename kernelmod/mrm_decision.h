@@ -0,0 +1,83 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+* Copyright (c) 2018 Cable Television Laboratories, Inc. ("CableLabs")
+*                    and others.  All rights reserved.
+*
+* Created by Jon Dennis (j.dennis@cablelabs.com)
+*/
+
+#ifndef MRM_DECISION_H_INCLUDED
+#define MRM_DECISION_H_INCLUDED
+
+#include "./macremapper_ioctl.h"
+#include "./mrm_flowtable.h"
+
+#include <linux/version.h>
+#include <linux/types.h>
+#include <linux/percpu.h>
+#include <linux/jump_label.h>
+#include <linux/mm.h>
+
+/*
+  the sampled remap decisions... every Nth frame moved to a replacement on each cpu gets
+  a record in that cpu's ring, which user space reads straight out of the mmap()ed control
+  file (see struct mrm_decision_ring)... off (and patched out by a static key) until
+  MRM_SETDECISIONSAMPLE starts it
+*/
+
+struct mrm_decision_pcpu {
+  unsigned  countdown; /* frames until the next sample */
+  u32       head;      /* the ring's head... user space can scribble over the one in the ring */
+  u64       lost;
+};
+extern struct mrm_decision_pcpu __percpu *mrm_decision_pcpu;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,3,0)
+  DECLARE_STATIC_KEY_FALSE(mrm_decision_key);
+  #define mrm_decision_enabled() static_branch_unlikely(&mrm_decision_key)
+#else
+  extern struct static_key mrm_decision_key;
+  #define mrm_decision_enabled() static_key_false(&mrm_decision_key)
+#endif
+
+extern unsigned mrm_decision_sample_every;
+
+void mrm_decision_record(
+  const struct mrm_flow_key * const  /* key (may be NULL) */,
+  const unsigned char * const        /* match_macaddr */,
+  const unsigned char * const        /* replace_macaddr */,
+  const unsigned                     /* replace_idx */,
+  const unsigned                     /* len */
+);
+
+/* called (in the data path) for every frame about to be moved to a replacement */
+static inline void
+mrm_decision_sample(
+    const struct mrm_flow_key * const key,
+    const unsigned char * const match_macaddr,
+    const unsigned char * const replace_macaddr,
+    const unsigned replace_idx,
+    const unsigned len
+  ) {
+  struct mrm_decision_pcpu *d;
+
+  if (!mrm_decision_enabled()) return;
+  d = this_cpu_ptr(mrm_decision_pcpu);
+  if (d->countdown > 0) {
+    --d->countdown;
+    return;
+  }
+  d->countdown = max(READ_ONCE(mrm_decision_sample_every), 1U) - 1; /* may be getting switched off */
+  mrm_decision_record(key, match_macaddr, replace_macaddr, replace_idx, len);
+}
+
+/* the caller holds the runconf lock for these... */
+int mrm_decision_set_sample( const unsigned /* every */ );
+void mrm_decision_get_ring_info( struct mrm_decision_ring_info * const /* output */ );
+
+int mrm_decision_mmap( struct vm_area_struct * const /* vma */ );
+
+int mrm_decision_init( void );
+void mrm_decision_destroy( void );
+
+#endif /* #ifndef MRM_DECISION_H_INCLUDED */
@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+* Copyright (c) 2018 Cable Television Laboratories, Inc. ("CableLabs")
+*                    and others.  All rights reserved.
+*
+* Created by Jon Dennis (j.dennis@cablelabs.com)
+*/
+
+
+
+#include "./mrm_devwatch.h"
+#include "./mrm_runconf.h"
+
+#include <linux/version.h>
+#include <linux/netdevice.h>
+#include <linux/notifier.h>
+
+
+/* gets called (with the RTNL held) for every netdevice event in the system */
+static int
+mrm_devwatch_event(struct notifier_block *nb, unsigned long event, void *ptr) {
+#if LINUX_VERSION_CODE < KERNEL_VERSION(3,11,0)
+  struct net_device * const dev = ptr;
+#else
+  struct net_device * const dev = netdev_notifier_info_to_dev(ptr);
+#endif
+
+  /* replacement interfaces are only ever looked up in the "main system" network namespace */
+  if (!net_eq(dev_net(dev), &init_net)) return NOTIFY_DONE;
+
+  switch (event) {
+  case NETDEV_REGISTER:
+  case NETDEV_UNREGISTER:
+  case NETDEV_CHANGENAME:
+  case NETDEV_UP:
+  case NETDEV_GOING_DOWN:
+  case NETDEV_DOWN:
+  case NETDEV_CHANGE: /* carrier changes show up as these */
+    mrm_handle_netdev_event(dev, event);
+    break;
+  default:
+    break; /* nothing we care about */
+  }
+
+  return NOTIFY_DONE;
+}
+
+static struct notifier_block _devwatch_nb = {
+  notifier_call:  &mrm_devwatch_event,
+};
+
+int
+mrm_devwatch_init( void ) {
+  return register_netdevice_notifier(&_devwatch_nb);
+}
+
+void
+mrm_devwatch_destroy( void ) {
+  unregister_netdevice_notifier(&_devwatch_nb);
+}
@@ -0,0 +1,24 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+* Copyright (c) 2018 Cable Television Laboratories, Inc. ("CableLabs")
+*                    and others.  All rights reserved.
+*
+* Created by Jon Dennis (j.dennis@cablelabs.com)
+*/
+
+#ifndef MRM_DEVWATCH_H_INCLUDED
+#define MRM_DEVWATCH_H_INCLUDED
+
+/*
+  the replacement interface watcher...
+
+  listens for netdevice events so that replacements whose
+  interface is down, lost carrier or went away altogether
+  stop getting traffic, and so that our references on an
+  interface being unregistered are let go of
+*/
+
+int mrm_devwatch_init( void );
+void mrm_devwatch_destroy( void );
+
+#endif /* #ifndef MRM_DEVWATCH_H_INCLUDED */
@@ -0,0 +1,227 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+* Copyright (c) 2018 Cable Television Laboratories, Inc. ("CableLabs")
+*                    and others.  All rights reserved.
+*
+* Created by Jon Dennis (j.dennis@cablelabs.com)
+*/
+
+
+
+#include "./mrm_elephant.h"
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/spinlock.h>
+#include <linux/etherdevice.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/jhash.h>
+#include <linux/random.h>
+#include <linux/jiffies.h>
+#include <linux/log2.h>
+
+
+/* tunables... */
+static unsigned int elephant_table_size = 4096;
+module_param(elephant_table_size, uint, 0444);
+MODULE_PARM_DESC(elephant_table_size, "Number of flows tracked for elephant flow detection");
+
+
+/* a flow that went quiet for this long starts over as a mouse */
+#define ELEPHANT_IDLE_TIMEOUT (30 * HZ)
+
+/* entries per set... a new flow evicts the stalest entry of its set */
+#define ELEPHANT_WAYS 4
+
+/* the sets share this many locks at most (set index modulo the lock count)... */
+#define ELEPHANT_LOCKS_MAX 256U
+
+struct mrm_elephant_entry {
+  struct mrm_flow_key   key;
+  unsigned long         window_start;  /* jiffies */
+  unsigned long         last_seen;     /* jiffies */
+  u32                   bytes;         /* within the current window */
+  u32                   packets;       /* within the current window */
+  u8                    in_use;
+  u8                    elephant;
+  u8                    class_idx;     /* the remap class the bytes are counted for */
+};
+
+struct mrm_elephant_lock {
+  spinlock_t                  lock;
+} ____cacheline_aligned_in_smp;
+
+static u32                                  _elephant_hash_salt  __read_mostly;
+static unsigned                             _elephant_set_mask   __read_mostly;
+static unsigned                             _elephant_lock_mask  __read_mostly;
+static struct mrm_elephant_entry           *_elephant_entries    __read_mostly;
+static struct mrm_elephant_lock            *_elephant_locks      __read_mostly;
+
+
+int
+mrm_elephant_init( void ) {
+  unsigned sets;
+  unsigned locks;
+  unsigned i;
+
+  get_random_bytes(&_elephant_hash_salt, sizeof(_elephant_hash_salt));
+
+  sets = max(elephant_table_size / ELEPHANT_WAYS, 1U);
+  sets = roundup_pow_of_two(sets);
+  _elephant_set_mask = sets - 1;
+  locks = min(sets, ELEPHANT_LOCKS_MAX); /* both powers of 2 */
+  _elephant_lock_mask = locks - 1;
+
+  _elephant_entries = kcalloc(sets * ELEPHANT_WAYS, sizeof(*_elephant_entries), GFP_KERNEL);
+  _elephant_locks = kcalloc(locks, sizeof(*_elephant_locks), GFP_KERNEL);
+  if ((_elephant_entries == NULL) || (_elephant_locks == NULL)) {
+    mrm_elephant_destroy();
+    return -ENOMEM;
+  }
+  for (i = 0; i < locks; ++i) {
+    spin_lock_init(&_elephant_locks[i].lock);
+  }
+
+  return 0; /* success */
+}
+
+void
+mrm_elephant_destroy( void ) {
+  kfree(_elephant_entries); /* kfree(NULL) is fine */
+  kfree(_elephant_locks);
+  _elephant_entries = NULL;
+  _elephant_locks = NULL;
+}
+
+/* the set of the flow, with the lock of the set taken... */
+static inline struct mrm_elephant_entry *
+mrm_elephant_lock_set(const struct mrm_flow_key * const key, spinlock_t ** const lock) {
+  const u32 hash = jhash2((const u32 *)key, sizeof(*key) / sizeof(u32), _elephant_hash_salt);
+  const unsigned set_idx = hash & _elephant_set_mask;
+
+  *lock = &_elephant_locks[set_idx & _elephant_lock_mask].lock;
+  spin_lock(*lock);
+  return &_elephant_entries[set_idx * ELEPHANT_WAYS];
+}
+
+static inline struct mrm_elephant_entry *
+mrm_elephant_find(struct mrm_elephant_entry * const set, const struct mrm_flow_key * const key, const unsigned long now) {
+  unsigned i;
+
+  for (i = 0; i < ELEPHANT_WAYS; ++i) {
+    if (!set[i].in_use) continue;
+    if (memcmp(&set[i].key, key, sizeof(*key)) != 0) continue;
+    if (time_after(now, set[i].last_seen + ELEPHANT_IDLE_TIMEOUT)) return NULL; /* went quiet... */
+    return &set[i];
+  }
+  return NULL; /* not tracked */
+}
+
+/* returns the class the flow is an elephant of... or -1 */
+int
+mrm_elephant_check(const struct mrm_flow_key * const key) {
+  struct mrm_elephant_entry *e;
+  const unsigned long now = jiffies;
+  spinlock_t *lock;
+  int class_idx;
+
+  e = mrm_elephant_find(mrm_elephant_lock_set(key, &lock), key, now);
+  class_idx = -1;
+  if ((e != NULL) && e->elephant) {
+    e->last_seen = now;
+    class_idx = e->class_idx; /* once an elephant, always an elephant */
+  }
+  spin_unlock(lock);
+
+  return class_idx;
+}
+
+int
+mrm_elephant_account(
+  const struct mrm_flow_key * const key,
+  const unsigned                    class_idx,
+  const unsigned                    len,
+  const unsigned                    threshold_bytes,
+  const unsigned long               window_jiffies
+) {
+  struct mrm_elephant_entry *set;
+  struct mrm_elephant_entry *e;
+  const unsigned long now = jiffies;
+  spinlock_t *lock;
+  unsigned i;
+  int rv;
+
+  set = mrm_elephant_lock_set(key, &lock);
+  e = mrm_elephant_find(set, key, now);
+  if (e == NULL) {
+    /* start tracking the flow... in a free way, or in place of the stalest one */
+    e = &set[0];
+    for (i = 0; i < ELEPHANT_WAYS; ++i) {
+      if (!set[i].in_use) {
+        e = &set[i];
+        break;
+      }
+      if (time_before(set[i].last_seen, e->last_seen)) e = &set[i];
+    }
+    memset(e, 0, sizeof(*e));
+    memcpy(&e->key, key, sizeof(e->key));
+    e->in_use = 1;
+    e->window_start = now;
+    e->class_idx = class_idx;
+  }
+  e->last_seen = now;
+
+  if (e->elephant && (e->class_idx == class_idx)) {
+    spin_unlock(lock);
+    return 1;
+  }
+
+  /* window expired before the flow got big enough (or the flow changed class)? start counting over */
+  if (time_after(now, e->window_start + window_jiffies) || (e->class_idx != class_idx)) {
+    e->class_idx = class_idx;
+    e->elephant = 0;
+    e->window_start = now;
+    e->bytes = 0;
+    e->packets = 0;
+  }
+
+  e->bytes += len;
+  e->packets++;
+  rv = 0; /* still a mouse */
+  if (e->bytes >= threshold_bytes) {
+    e->elephant = 1;
+    rv = 1;
+  }
+  spin_unlock(lock);
+
+  return rv;
+}
+
+/* macaddr NULL = every flow... */
+static void
+mrm_elephant_clear(const unsigned char * const macaddr) {
+  struct mrm_elephant_entry *set;
+  unsigned l, s, i;
+
+  for (l = 0; l <= _elephant_lock_mask; ++l) {
+    spin_lock_bh(&_elephant_locks[l].lock);
+    for (s = l; s <= _elephant_set_mask; s += _elephant_lock_mask + 1) {
+      set = &_elephant_entries[s * ELEPHANT_WAYS];
+      for (i = 0; i < ELEPHANT_WAYS; ++i) {
+        if ((macaddr == NULL) || ether_addr_equal(set[i].key.macaddr, macaddr)) set[i].in_use = 0;
+      }
+    }
+    spin_unlock_bh(&_elephant_locks[l].lock);
+  }
+}
+
+void
+mrm_elephant_forget(const unsigned char * const macaddr) {
+  mrm_elephant_clear(macaddr);
+}
+
+void
+mrm_elephant_flush( void ) {
+  mrm_elephant_clear(NULL);
+}
@@ -0,0 +1,41 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+* Copyright (c) 2018 Cable Television Laboratories, Inc. ("CableLabs")
+*                    and others.  All rights reserved.
+*
+* Created by Jon Dennis (j.dennis@cablelabs.com)
+*/
+
+#ifndef MRM_ELEPHANT_H_INCLUDED
+#define MRM_ELEPHANT_H_INCLUDED
+
+#include "./mrm_flowtable.h"
+
+/*
+  elephant flow detection...
+
+  keeps per-flow byte/packet counters so a remap can be restricted
+  to "bulk" flows: a flow is only remapped once it moved a given
+  amount of (filter matching) bytes within a time window, and from
+  then on all of its frames are remapped (within the class that
+  made it an elephant)
+
+  the table is a single fixed size set associative array shared by
+  all the cpus, so the frames of a flow count towards the same entry
+  whichever cpu they go through... the sets are spread over a number
+  of spinlocks, a flow only ever takes the one of its set
+*/
+
+int mrm_elephant_init( void );
+void mrm_elephant_destroy( void );
+
+/* these get called from the "critical path" (bottom halves disabled) */
+int mrm_elephant_check(const struct mrm_flow_key * const /* key */);
+int mrm_elephant_account(const struct mrm_flow_key * const /* key */, const unsigned /* class_idx */, const unsigned /* len */, const unsigned /* threshold_bytes */, const unsigned long /* window_jiffies */);
+
+/* the counts are only good for the classes they were made with... forget the flows of a remap
+   whenever it gets set/deleted, and every flow when the whole configuration changes */
+void mrm_elephant_forget(const unsigned char * const /* macaddr */);
+void mrm_elephant_flush( void );
+
+#endif /* #ifndef MRM_ELEPHANT_H_INCLUDED */
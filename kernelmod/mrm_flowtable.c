@@ -0,0 +1,213 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+* Copyright (c) 2018 Cable Television Laboratories, Inc. ("CableLabs")
+*                    and others.  All rights reserved.
+*
+* Created by Jon Dennis (j.dennis@cablelabs.com)
+*/
+
+
+
+#include "./mrm_flowtable.h"
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/jhash.h>
+#include <linux/random.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+#include <linux/jiffies.h>
+
+
+/* tunables... */
+unsigned int mrm_sticky_flow_timeout = 0;
+module_param_named(sticky_flow_timeout, mrm_sticky_flow_timeout, uint, 0644);
+MODULE_PARM_DESC(sticky_flow_timeout, "Seconds a pinned flow may be idle before it is forgotten (0 = sticky flow table disabled)");
+
+static unsigned int sticky_flow_max = 4096;
+module_param(sticky_flow_max, uint, 0444);
+MODULE_PARM_DESC(sticky_flow_max, "Maximum number of pinned flows; least recently used flows are evicted past this");
+
+
+/* flow storage... */
+#define FLOW_HASH_BITS 10
+#define FLOW_HASH_COUNT (1 << FLOW_HASH_BITS)
+#define FLOW_AGING_INTERVAL HZ
+static u32                               _flow_hash_salt              __read_mostly;
+static struct hlist_head                 _flow_hash[FLOW_HASH_COUNT]  __read_mostly;
+static struct kmem_cache                *_flow_cache                  __read_mostly;
+static struct list_head                  _flow_lru;   /* least recently inserted at the head */
+static unsigned                          _flow_count;
+static spinlock_t                        _flow_lock;  /* serializes all writers; readers use RCU */
+static struct delayed_work               _flow_aging_work;
+#define flow_for_each(pos, headidx) hlist_for_each_entry_rcu(pos, &_flow_hash[headidx], hlist)
+
+static void mrm_flowtable_age(struct work_struct * /* work */);
+
+int
+mrm_flowtable_init( void ) {
+  BUILD_BUG_ON((sizeof(struct mrm_flow_key) % sizeof(u32)) != 0);
+
+  _flow_cache = kmem_cache_create("mrm_flow_cache", sizeof(struct mrm_flow_entry), 0, SLAB_HWCACHE_ALIGN, NULL);
+  if (_flow_cache == NULL) return -ENOMEM;
+
+  memset(_flow_hash, 0, sizeof(_flow_hash));
+  get_random_bytes(&_flow_hash_salt, sizeof(_flow_hash_salt));
+  INIT_LIST_HEAD(&_flow_lru);
+  _flow_count = 0;
+  spin_lock_init(&_flow_lock);
+  INIT_DEFERRABLE_WORK(&_flow_aging_work, &mrm_flowtable_age);
+
+  return 0; /* success */
+}
+
+void
+mrm_flowtable_destroy( void ) {
+  /* note: by the time this is called the netfilter hook is gone,
+           so nothing can schedule the aging worker again */
+  cancel_delayed_work_sync(&_flow_aging_work);
+  mrm_flowtable_flush();
+  rcu_barrier(); /* wait for the call_rcu()s queued by the flush */
+  kmem_cache_destroy(_flow_cache);
+}
+
+static inline unsigned
+mrm_flowtable_hash(const struct mrm_flow_key * const key) {
+  return jhash2((const u32 *)key, sizeof(*key) / sizeof(u32), _flow_hash_salt) & (FLOW_HASH_COUNT - 1);
+}
+
+static void
+mrm_flowtable_rcu_free(struct rcu_head *head) {
+  kmem_cache_free(_flow_cache, container_of(head, struct mrm_flow_entry, rcu));
+}
+
+/* caller must hold _flow_lock */
+static void
+mrm_flowtable_unlink(struct mrm_flow_entry * const fe) {
+  hlist_del_rcu(&fe->hlist);
+  list_del(&fe->lru);
+  --_flow_count;
+  call_rcu(&fe->rcu, &mrm_flowtable_rcu_free);
+}
+
+/* caller must hold _flow_lock
+   approximates LRU with a "clock" sweep so that the critical path
+   only ever has to set a bit rather than re-order a shared list */
+static void
+mrm_flowtable_evict_lru( void ) {
+  struct mrm_flow_entry *fe;
+  unsigned second_chances;
+
+  second_chances = _flow_count;
+  while (!list_empty(&_flow_lru)) {
+    fe = list_first_entry(&_flow_lru, struct mrm_flow_entry, lru);
+    if (fe->referenced && (second_chances-- > 0)) {
+      /* used since we last looked at it... move it to the back of the line */
+      fe->referenced = 0;
+      list_move_tail(&fe->lru, &_flow_lru);
+      continue;
+    }
+    mrm_flowtable_unlink(fe);
+    return;
+  }
+}
+
+static void
+mrm_flowtable_age(struct work_struct *work) {
+  struct mrm_flow_entry *fe, *fe_tmp;
+  const unsigned long timeout = mrm_sticky_flow_timeout * HZ;
+  unsigned remaining;
+
+  spin_lock_bh(&_flow_lock);
+  list_for_each_entry_safe(fe, fe_tmp, &_flow_lru, lru) {
+    /* if the table got disabled everything goes */
+    if ((timeout == 0) || time_after(jiffies, fe->last_used + timeout)) {
+      mrm_flowtable_unlink(fe);
+    }
+  }
+  remaining = _flow_count;
+  spin_unlock_bh(&_flow_lock);
+
+  /* only keep ticking while there is something to age out... mrm_flowtable_pin() re-arms us */
+  if (remaining > 0) schedule_delayed_work(&_flow_aging_work, FLOW_AGING_INTERVAL);
+}
+
+void
+mrm_flowtable_flush( void ) {
+  struct mrm_flow_entry *fe, *fe_tmp;
+
+  spin_lock_bh(&_flow_lock);
+  list_for_each_entry_safe(fe, fe_tmp, &_flow_lru, lru) {
+    mrm_flowtable_unlink(fe);
+  }
+  spin_unlock_bh(&_flow_lock);
+}
+
+unsigned
+mrm_flowtable_get_count( void ) {
+  return _flow_count;
+}
+
+const struct mrm_flow_entry *
+mrm_flowtable_lookup(const struct mrm_flow_key * const key) {
+  struct mrm_flow_entry *fe;
+  const unsigned headidx = mrm_flowtable_hash(key);
+  const unsigned long now = jiffies;
+
+  flow_for_each(fe, headidx) {
+    if (memcmp(&fe->key, key, sizeof(*key)) != 0) continue;
+
+    /* idle for too long? act as if it is already gone... the aging worker will reap it */
+    if (time_after(now, fe->last_used + (mrm_sticky_flow_timeout * HZ))) return NULL;
+
+    /* only dirty the entry when there is something new to say */
+    if (fe->last_used != now) fe->last_used = now;
+    if (!fe->referenced) fe->referenced = 1;
+    return fe;
+  }
+
+  return NULL; /* not pinned */
+}
+
+void
+mrm_flowtable_pin(const struct mrm_flow_key * const key, const unsigned class_idx, const unsigned char * const replace_macaddr, const unsigned replace_idx) {
+  struct mrm_flow_entry *fe, *existing;
+  const unsigned headidx = mrm_flowtable_hash(key);
+
+  if (sticky_flow_max == 0) return; /* defensive */
+
+  fe = kmem_cache_alloc(_flow_cache, GFP_ATOMIC);
+  if (fe == NULL) {
+    return; /* out of memory... the flow simply wont be sticky */
+  }
+  memset(fe, 0, sizeof(*fe));
+  memcpy(&fe->key, key, sizeof(fe->key));
+  memcpy(fe->replace_macaddr, replace_macaddr, sizeof(fe->replace_macaddr));
+  fe->replace_idx = replace_idx;
+  fe->class_idx   = class_idx;
+  fe->last_used   = jiffies;
+
+  spin_lock_bh(&_flow_lock);
+
+  /* replace a stale (or concurrently pinned) entry for the same flow... */
+  hlist_for_each_entry(existing, &_flow_hash[headidx], hlist) {
+    if (memcmp(&existing->key, key, sizeof(*key)) == 0) break;
+  }
+  if (existing != NULL) {
+    mrm_flowtable_unlink(existing);
+  }
+  else if (_flow_count >= sticky_flow_max) {
+    mrm_flowtable_evict_lru();
+  }
+
+  hlist_add_head_rcu(&fe->hlist, &_flow_hash[headidx]);
+  list_add_tail(&fe->lru, &_flow_lru);
+  ++_flow_count;
+
+  spin_unlock_bh(&_flow_lock);
+
+  /* no-op if the aging worker is already queued */
+  schedule_delayed_work(&_flow_aging_work, FLOW_AGING_INTERVAL);
+}
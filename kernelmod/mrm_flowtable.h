@@ -0,0 +1,74 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+* Copyright (c) 2018 Cable Television Laboratories, Inc. ("CableLabs")
+*                    and others.  All rights reserved.
+*
+* Created by Jon Dennis (j.dennis@cablelabs.com)
+*/
+
+#ifndef MRM_FLOWTABLE_H_INCLUDED
+#define MRM_FLOWTABLE_H_INCLUDED
+
+#include <linux/types.h>
+#include <linux/in6.h>
+#include <linux/list.h>
+
+/*
+  the "sticky" flow table...
+
+  records which class a flow fell into and which replacement
+  it was sent to on its first remapped packet, and keeps
+  sending the rest of the flow there (without re-evaluating
+  the filter rules) until the flow has been idle for
+  "sticky_flow_timeout" seconds
+*/
+
+
+/* identifies a single flow... hashed as an array of u32s, keep it padded to a multiple of 4 bytes */
+struct mrm_flow_key {
+  union {
+    __be32            ip4;
+    struct in6_addr   ip6;
+  }                 saddr;
+  union {
+    __be32            ip4;
+    struct in6_addr   ip6;
+  }                 daddr;
+  u16               sport;   /* host byte order, 0 for non tcp/udp */
+  u16               dport;   /* host byte order, 0 for non tcp/udp */
+  unsigned char     macaddr[6]; /* the matched (pre-remap) destination MAC address */
+  u8                family;
+  u8                proto;
+};
+
+struct mrm_flow_entry {
+  struct hlist_node     hlist;
+  struct list_head      lru;
+  struct rcu_head       rcu;
+  struct mrm_flow_key   key;
+  unsigned long         last_used;           /* jiffies of the last packet seen on this flow */
+  unsigned char         replace_macaddr[6];  /* the replacement this flow is pinned to */
+  unsigned char         referenced;          /* "second chance" bit used by the LRU eviction */
+  unsigned char         class_idx;           /* the class of the remap entry the flow fell into */
+  unsigned              replace_idx;         /* hint: replace[] index the flow was pinned to */
+};
+
+
+/* zero means the sticky flow table is disabled */
+extern unsigned int mrm_sticky_flow_timeout;
+
+static inline int
+mrm_flowtable_enabled( void ) {
+  return mrm_sticky_flow_timeout != 0;
+}
+
+int mrm_flowtable_init( void );
+void mrm_flowtable_destroy( void );
+void mrm_flowtable_flush( void );
+unsigned mrm_flowtable_get_count( void );
+
+/* these get called from the "critical path" (under the RCU read lock) */
+const struct mrm_flow_entry *mrm_flowtable_lookup(const struct mrm_flow_key * const /* key */);
+void mrm_flowtable_pin(const struct mrm_flow_key * const /* key */, const unsigned /* class_idx */, const unsigned char * const /* replace_macaddr */, const unsigned /* replace_idx */);
+
+#endif /* #ifndef MRM_FLOWTABLE_H_INCLUDED */
@@ -0,0 +1,1042 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+* Copyright (c) 2018 Cable Television Laboratories, Inc. ("CableLabs")
+*                    and others.  All rights reserved.
+*
+* Created by Jon Dennis (j.dennis@cablelabs.com)
+*/
+
+
+
+#include "./mrm_genl.h"
+#include "./mrm_runconf.h"
+#include "./mrm_private.h"
+
+#include <linux/version.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/if_ether.h>
+#include <net/genetlink.h>
+
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,2,0)
+
+static struct genl_family _genl_family;
+
+
+/* attribute policies... */
+static const struct nla_policy _genl_policy[MRM_GENLA_MAX + 1] = {
+  [MRM_GENLA_GENERATION]          = { type: NLA_U32 },
+  [MRM_GENLA_FILTER_NAME]         = { type: NLA_STRING, len: MRM_FILTER_NAME_MAX },
+  [MRM_GENLA_FILTER_RULES]        = { type: NLA_NESTED },
+  [MRM_GENLA_FILTER_RULE]         = { type: NLA_BINARY, len: sizeof(struct mrm_filter_rule) },
+  [MRM_GENLA_REMAP_MACADDR]       = { type: NLA_BINARY, len: ETH_ALEN },
+  [MRM_GENLA_REMAP_CLASSES]       = { type: NLA_NESTED },
+  [MRM_GENLA_REMAP_CLASS]         = { type: NLA_NESTED },
+  [MRM_GENLA_REMAP_SHADOW]        = { type: NLA_FLAG },
+  [MRM_GENLA_REMAP_IDLE_TIMEOUT]  = { type: NLA_U32 },
+  [MRM_GENLA_GROUP_NAME]          = { type: NLA_STRING, len: MRM_FILTER_NAME_MAX },
+  [MRM_GENLA_GROUP_REPLACEMENTS]  = { type: NLA_NESTED },
+  [MRM_GENLA_GROUP_REPLACEMENT]   = { type: NLA_NESTED },
+  [MRM_GENLA_MCAST_MACADDR]       = { type: NLA_BINARY, len: ETH_ALEN },
+  [MRM_GENLA_MCAST_KEEP_ORIGINAL] = { type: NLA_FLAG },
+  [MRM_GENLA_MCAST_MEMBERS]       = { type: NLA_NESTED },
+  [MRM_GENLA_MCAST_MEMBER]        = { type: NLA_NESTED },
+};
+
+static const struct nla_policy _genl_class_policy[MRM_GENLA_CLASS_MAX + 1] = {
+  [MRM_GENLA_CLASS_FILTER_NAME]     = { type: NLA_STRING, len: MRM_FILTER_NAME_MAX },
+  [MRM_GENLA_CLASS_POLICY]          = { type: NLA_U32 },
+  [MRM_GENLA_CLASS_SPILL]           = { type: NLA_U32 },
+  [MRM_GENLA_CLASS_ELEPHANT_BYTES]  = { type: NLA_U32 },
+  [MRM_GENLA_CLASS_ELEPHANT_WINDOW] = { type: NLA_U32 },
+  [MRM_GENLA_CLASS_REPLACEMENTS]    = { type: NLA_NESTED },
+  [MRM_GENLA_CLASS_REPLACEMENT]     = { type: NLA_NESTED },
+  [MRM_GENLA_CLASS_GROUP_NAME]      = { type: NLA_STRING, len: MRM_FILTER_NAME_MAX },
+};
+
+static const struct nla_policy _genl_repl_policy[MRM_GENLA_REPL_MAX + 1] = {
+  [MRM_GENLA_REPL_MACADDR]        = { type: NLA_BINARY, len: ETH_ALEN },
+  [MRM_GENLA_REPL_IFNAME]         = { type: NLA_STRING, len: IFNAMSIZ - 1 },
+  [MRM_GENLA_REPL_WEIGHT]         = { type: NLA_U32 },
+  [MRM_GENLA_REPL_RATE]           = { type: NLA_U32 },
+  [MRM_GENLA_REPL_BURST]          = { type: NLA_U32 },
+};
+
+static const struct nla_policy _genl_member_policy[MRM_GENLA_MEMBER_MAX + 1] = {
+  [MRM_GENLA_MEMBER_MACADDR]      = { type: NLA_BINARY, len: ETH_ALEN },
+  [MRM_GENLA_MEMBER_IFNAME]       = { type: NLA_STRING, len: IFNAMSIZ - 1 },
+};
+
+
+
+/* message building... */
+
+/* a filter may have far more rules than fit in the usual message size... and a group more replacements */
+#define MRM_GENL_FILTER_SIZE(RULE_COUNT) (NLMSG_GOODSIZE + ((RULE_COUNT) * nla_total_size(sizeof(struct mrm_filter_rule))))
+#define MRM_GENL_REPL_SIZE (nla_total_size(0) + nla_total_size(ETH_ALEN) + nla_total_size(IFNAMSIZ) + (3 * nla_total_size(sizeof(u32))))
+#define MRM_GENL_GROUP_SIZE(REPLACE_COUNT) (NLMSG_GOODSIZE + ((REPLACE_COUNT) * MRM_GENL_REPL_SIZE))
+
+static inline int
+mrm_genl_put_string(struct sk_buff * const skb, const int type, const char * const str, const size_t size) {
+  /* the config structs strings are not always "\0" terminated (a full size filter name) */
+  return nla_put(skb, type, strnlen(str, size), str);
+}
+
+static int
+mrm_genl_put_filter(struct sk_buff * const skb, const struct mrm_filter_rule * const rules, const unsigned rule_count) {
+  struct nlattr *nest;
+  unsigned i;
+
+  nest = nla_nest_start(skb, MRM_GENLA_FILTER_RULES);
+  if (nest == NULL) return -EMSGSIZE;
+  for (i = 0; i < rule_count; ++i) {
+    if (nla_put(skb, MRM_GENLA_FILTER_RULE, sizeof(rules[i]), &rules[i]) != 0) return -EMSGSIZE;
+  }
+  nla_nest_end(skb, nest);
+  return 0; /* success */
+}
+
+static int
+mrm_genl_put_replacement(struct sk_buff * const skb, const int type, const struct mrm_replacement * const r) {
+  struct nlattr *repl;
+
+  repl = nla_nest_start(skb, type);
+  if (repl == NULL) return -EMSGSIZE;
+  if ((nla_put(skb, MRM_GENLA_REPL_MACADDR, ETH_ALEN, r->macaddr) != 0) ||
+      ((r->ifname[0] != '\0') && (mrm_genl_put_string(skb, MRM_GENLA_REPL_IFNAME, r->ifname, sizeof(r->ifname)) != 0)) ||
+      (nla_put_u32(skb, MRM_GENLA_REPL_WEIGHT, r->weight) != 0) ||
+      (nla_put_u32(skb, MRM_GENLA_REPL_RATE, r->rate) != 0) ||
+      (nla_put_u32(skb, MRM_GENLA_REPL_BURST, r->burst) != 0)) {
+    return -EMSGSIZE;
+  }
+  nla_nest_end(skb, repl);
+  return 0; /* success */
+}
+
+static int
+mrm_genl_put_remap(struct sk_buff * const skb, const struct mrm_remap_entry * const e) {
+  const struct mrm_remap_class *cls;
+  struct nlattr *classes, *class, *repls;
+  unsigned i, j;
+
+  if (e->shadow && (nla_put_flag(skb, MRM_GENLA_REMAP_SHADOW) != 0)) return -EMSGSIZE;
+  if ((e->idle_timeout > 0) && (nla_put_u32(skb, MRM_GENLA_REMAP_IDLE_TIMEOUT, e->idle_timeout) != 0)) return -EMSGSIZE;
+
+  classes = nla_nest_start(skb, MRM_GENLA_REMAP_CLASSES);
+  if (classes == NULL) return -EMSGSIZE;
+  for (i = 0; (i < e->class_count) && (i < MRM_MAX_CLASSES); ++i) {
+    cls = &e->classes[i];
+
+    class = nla_nest_start(skb, MRM_GENLA_REMAP_CLASS);
+    if (class == NULL) return -EMSGSIZE;
+    if ((mrm_genl_put_string(skb, MRM_GENLA_CLASS_FILTER_NAME, cls->filter_name, sizeof(cls->filter_name)) != 0) ||
+        (nla_put_u32(skb, MRM_GENLA_CLASS_POLICY, cls->policy) != 0) ||
+        (nla_put_u32(skb, MRM_GENLA_CLASS_SPILL, cls->spill) != 0) ||
+        (nla_put_u32(skb, MRM_GENLA_CLASS_ELEPHANT_BYTES, cls->elephant_bytes) != 0) ||
+        (nla_put_u32(skb, MRM_GENLA_CLASS_ELEPHANT_WINDOW, cls->elephant_window) != 0) ||
+        ((cls->group_name[0] != '\0') && (mrm_genl_put_string(skb, MRM_GENLA_CLASS_GROUP_NAME, cls->group_name, sizeof(cls->group_name)) != 0))) {
+      return -EMSGSIZE;
+    }
+
+    repls = nla_nest_start(skb, MRM_GENLA_CLASS_REPLACEMENTS);
+    if (repls == NULL) return -EMSGSIZE;
+    for (j = 0; (j < cls->replace_count) && (j < MRM_MAX_REPLACE); ++j) {
+      if (mrm_genl_put_replacement(skb, MRM_GENLA_CLASS_REPLACEMENT, &cls->replace[j]) != 0) return -EMSGSIZE;
+    }
+    nla_nest_end(skb, repls);
+
+    nla_nest_end(skb, class);
+  }
+  nla_nest_end(skb, classes);
+  return 0; /* success */
+}
+
+static int
+mrm_genl_put_group(struct sk_buff * const skb, const struct mrm_replace_group * const g) {
+  struct nlattr *repls;
+  unsigned i;
+
+  repls = nla_nest_start(skb, MRM_GENLA_GROUP_REPLACEMENTS);
+  if (repls == NULL) return -EMSGSIZE;
+  for (i = 0; (i < g->replace_count) && (i < MRM_REPLACE_GROUP_LIMIT); ++i) {
+    if (mrm_genl_put_replacement(skb, MRM_GENLA_GROUP_REPLACEMENT, &g->replace[i]) != 0) return -EMSGSIZE;
+  }
+  nla_nest_end(skb, repls);
+  return 0; /* success */
+}
+
+static int
+mrm_genl_put_mcast(struct sk_buff * const skb, const struct mrm_mcast_group * const g) {
+  struct nlattr *members, *member;
+  unsigned i;
+
+  if ((g->original == MRMMCAST_KEEP_ORIGINAL) && (nla_put_flag(skb, MRM_GENLA_MCAST_KEEP_ORIGINAL) != 0)) return -EMSGSIZE;
+
+  members = nla_nest_start(skb, MRM_GENLA_MCAST_MEMBERS);
+  if (members == NULL) return -EMSGSIZE;
+  for (i = 0; (i < g->member_count) && (i < MRM_MAX_MCAST_MEMBERS); ++i) {
+    member = nla_nest_start(skb, MRM_GENLA_MCAST_MEMBER);
+    if (member == NULL) return -EMSGSIZE;
+    if ((nla_put(skb, MRM_GENLA_MEMBER_MACADDR, ETH_ALEN, g->members[i].macaddr) != 0) ||
+        (mrm_genl_put_string(skb, MRM_GENLA_MEMBER_IFNAME, g->members[i].ifname, sizeof(g->members[i].ifname)) != 0)) {
+      return -EMSGSIZE;
+    }
+    nla_nest_end(skb, member);
+  }
+  nla_nest_end(skb, members);
+  return 0; /* success */
+}
+
+/* what a message describes... a filter, a remap, a group or a multicast group
+   (by name/MAC address only when its conf is NULL) */
+struct mrm_genl_msg {
+  const char                           *filter_name;
+  const struct mrm_filter_config_v2    *filter_conf;
+  const unsigned char                  *remap_macaddr;
+  const struct mrm_remap_entry         *remap_conf;
+  const char                           *group_name;
+  const struct mrm_replace_group       *group_conf;
+  const unsigned char                  *mcast_macaddr;
+  const struct mrm_mcast_group         *mcast_conf;
+};
+
+/* builds a single message... returns NULL if out of memory */
+static struct sk_buff *
+mrm_genl_build(
+  const u32                               portid,
+  const u32                               seq,
+  const u8                                cmd,
+  const u32                               generation,
+  const struct mrm_genl_msg * const       m,
+  const gfp_t                             gfp
+) {
+  struct sk_buff *skb;
+  size_t size;
+  void *hdr;
+
+  if (m->filter_conf != NULL) size = MRM_GENL_FILTER_SIZE(m->filter_conf->rule_count);
+  else if (m->group_conf != NULL) size = MRM_GENL_GROUP_SIZE(m->group_conf->replace_count);
+  else size = NLMSG_GOODSIZE;
+
+  skb = genlmsg_new(size, gfp);
+  if (skb == NULL) {
+    return NULL; /* out of memory */
+  }
+
+  hdr = genlmsg_put(skb, portid, seq, &_genl_family, 0, cmd);
+  if (hdr == NULL) goto failed;
+  if (nla_put_u32(skb, MRM_GENLA_GENERATION, generation) != 0) goto failed;
+  if (m->filter_name != NULL) {
+    if (mrm_genl_put_string(skb, MRM_GENLA_FILTER_NAME, m->filter_name, MRM_FILTER_NAME_MAX) != 0) goto failed;
+    if ((m->filter_conf != NULL) && (mrm_genl_put_filter(skb, m->filter_conf->rules, m->filter_conf->rule_count) != 0)) goto failed;
+  }
+  if (m->remap_macaddr != NULL) {
+    if (nla_put(skb, MRM_GENLA_REMAP_MACADDR, ETH_ALEN, m->remap_macaddr) != 0) goto failed;
+    if ((m->remap_conf != NULL) && (mrm_genl_put_remap(skb, m->remap_conf) != 0)) goto failed;
+  }
+  if (m->group_name != NULL) {
+    if (mrm_genl_put_string(skb, MRM_GENLA_GROUP_NAME, m->group_name, MRM_FILTER_NAME_MAX) != 0) goto failed;
+    if ((m->group_conf != NULL) && (mrm_genl_put_group(skb, m->group_conf) != 0)) goto failed;
+  }
+  if (m->mcast_macaddr != NULL) {
+    if (nla_put(skb, MRM_GENLA_MCAST_MACADDR, ETH_ALEN, m->mcast_macaddr) != 0) goto failed;
+    if ((m->mcast_conf != NULL) && (mrm_genl_put_mcast(skb, m->mcast_conf) != 0)) goto failed;
+  }
+  genlmsg_end(skb, hdr);
+  return skb;
+
+failed:
+  nlmsg_free(skb); /* cant happen... the message got sized to fit */
+  return NULL;
+}
+
+
+
+/* message parsing... */
+
+static void
+mrm_genl_get_string(char * const dst, const size_t size, const struct nlattr * const nla) {
+  /* the policies keep the strings from being any longer than the destination */
+  memset(dst, 0, size);
+  memcpy(dst, nla_data(nla), min_t(size_t, nla_len(nla), size));
+}
+
+/* allocates the filter to fit the rules given... */
+static int
+mrm_genl_parse_filter(struct genl_info * const info, struct mrm_filter_config_v2 ** const output) {
+  struct mrm_filter_config_v2 *conf;
+  const struct nlattr *rule;
+  unsigned rule_count;
+  int rem;
+
+  if ((info->attrs[MRM_GENLA_FILTER_NAME] == NULL) || (info->attrs[MRM_GENLA_FILTER_RULES] == NULL)) return -EINVAL;
+
+  rule_count = 0;
+  nla_for_each_nested(rule, info->attrs[MRM_GENLA_FILTER_RULES], rem) {
+    if ((nla_type(rule) != MRM_GENLA_FILTER_RULE) || (nla_len(rule) != sizeof(conf->rules[0]))) return -EINVAL;
+    if (++rule_count > MRM_FILTER_RULES_LIMIT) return -E2BIG;
+  }
+
+  conf = kzalloc(MRM_FILTER_CONFIG_V2_SIZE(rule_count), GFP_KERNEL);
+  if (conf == NULL) {
+    return -ENOMEM;
+  }
+  conf->version = MRM_FILTER_CONFIG_V2;
+  mrm_genl_get_string(conf->name, sizeof(conf->name), info->attrs[MRM_GENLA_FILTER_NAME]);
+  nla_for_each_nested(rule, info->attrs[MRM_GENLA_FILTER_RULES], rem) {
+    memcpy(&conf->rules[conf->rule_count++], nla_data(rule), sizeof(conf->rules[0]));
+  }
+
+  *output = conf;
+  return 0; /* success */
+}
+
+static int
+mrm_genl_parse_replacement(const struct nlattr * const nla, struct mrm_replacement * const r, struct netlink_ext_ack * const extack) {
+  struct nlattr *tb[MRM_GENLA_REPL_MAX + 1];
+  int rv;
+
+  rv = nla_parse_nested(tb, MRM_GENLA_REPL_MAX, nla, _genl_repl_policy, extack);
+  if (rv != 0) return rv;
+
+  if ((tb[MRM_GENLA_REPL_MACADDR] == NULL) || (nla_len(tb[MRM_GENLA_REPL_MACADDR]) != ETH_ALEN)) return -EINVAL;
+  memcpy(r->macaddr, nla_data(tb[MRM_GENLA_REPL_MACADDR]), ETH_ALEN);
+  if (tb[MRM_GENLA_REPL_IFNAME] != NULL) mrm_genl_get_string(r->ifname, sizeof(r->ifname), tb[MRM_GENLA_REPL_IFNAME]);
+  if (tb[MRM_GENLA_REPL_WEIGHT] != NULL) r->weight = nla_get_u32(tb[MRM_GENLA_REPL_WEIGHT]);
+  if (tb[MRM_GENLA_REPL_RATE] != NULL)   r->rate   = nla_get_u32(tb[MRM_GENLA_REPL_RATE]);
+  if (tb[MRM_GENLA_REPL_BURST] != NULL)  r->burst  = nla_get_u32(tb[MRM_GENLA_REPL_BURST]);
+  return 0; /* success */
+}
+
+static int
+mrm_genl_parse_class(const struct nlattr * const nla, struct mrm_remap_class * const cls, struct netlink_ext_ack * const extack) {
+  struct nlattr *tb[MRM_GENLA_CLASS_MAX + 1];
+  const struct nlattr *repl;
+  int rem;
+  int rv;
+
+  rv = nla_parse_nested(tb, MRM_GENLA_CLASS_MAX, nla, _genl_class_policy, extack);
+  if (rv != 0) return rv;
+
+  if (tb[MRM_GENLA_CLASS_FILTER_NAME] == NULL) return -EINVAL;
+  if ((tb[MRM_GENLA_CLASS_REPLACEMENTS] == NULL) && (tb[MRM_GENLA_CLASS_GROUP_NAME] == NULL)) return -EINVAL;
+  mrm_genl_get_string(cls->filter_name, sizeof(cls->filter_name), tb[MRM_GENLA_CLASS_FILTER_NAME]);
+  if (tb[MRM_GENLA_CLASS_GROUP_NAME] != NULL)      mrm_genl_get_string(cls->group_name, sizeof(cls->group_name), tb[MRM_GENLA_CLASS_GROUP_NAME]);
+  if (tb[MRM_GENLA_CLASS_POLICY] != NULL)          cls->policy          = nla_get_u32(tb[MRM_GENLA_CLASS_POLICY]);
+  if (tb[MRM_GENLA_CLASS_SPILL] != NULL)           cls->spill           = nla_get_u32(tb[MRM_GENLA_CLASS_SPILL]);
+  if (tb[MRM_GENLA_CLASS_ELEPHANT_BYTES] != NULL)  cls->elephant_bytes  = nla_get_u32(tb[MRM_GENLA_CLASS_ELEPHANT_BYTES]);
+  if (tb[MRM_GENLA_CLASS_ELEPHANT_WINDOW] != NULL) cls->elephant_window = nla_get_u32(tb[MRM_GENLA_CLASS_ELEPHANT_WINDOW]);
+
+  if (tb[MRM_GENLA_CLASS_REPLACEMENTS] == NULL) return 0; /* the replacements come from the group */
+  nla_for_each_nested(repl, tb[MRM_GENLA_CLASS_REPLACEMENTS], rem) {
+    if (nla_type(repl) != MRM_GENLA_CLASS_REPLACEMENT) return -EINVAL;
+    if (cls->replace_count >= MRM_MAX_REPLACE) return -E2BIG;
+    rv = mrm_genl_parse_replacement(repl, &cls->replace[cls->replace_count], extack);
+    if (rv != 0) return rv;
+    ++cls->replace_count;
+  }
+  return 0; /* success... the rest of the validation is up to mrm_set_remap_entry() */
+}
+
+static int
+mrm_genl_parse_remap(struct genl_info * const info, struct mrm_remap_entry * const e) {
+  const struct nlattr *class;
+  int rem;
+  int rv;
+
+  if (info->attrs[MRM_GENLA_REMAP_CLASSES] == NULL) return -EINVAL;
+  e->shadow = nla_get_flag(info->attrs[MRM_GENLA_REMAP_SHADOW]);
+  if (info->attrs[MRM_GENLA_REMAP_IDLE_TIMEOUT] != NULL) e->idle_timeout = nla_get_u32(info->attrs[MRM_GENLA_REMAP_IDLE_TIMEOUT]);
+
+  nla_for_each_nested(class, info->attrs[MRM_GENLA_REMAP_CLASSES], rem) {
+    if (nla_type(class) != MRM_GENLA_REMAP_CLASS) return -EINVAL;
+    if (e->class_count >= MRM_MAX_CLASSES) return -E2BIG;
+    rv = mrm_genl_parse_class(class, &e->classes[e->class_count], info->extack);
+    if (rv != 0) return rv;
+    ++e->class_count;
+  }
+  return 0; /* success */
+}
+
+/* allocates the group to fit the replacements given... */
+static int
+mrm_genl_parse_group(struct genl_info * const info, struct mrm_replace_group ** const output) {
+  struct mrm_replace_group *g;
+  const struct nlattr *repl;
+  unsigned replace_count;
+  int rem;
+  int rv;
+
+  if ((info->attrs[MRM_GENLA_GROUP_NAME] == NULL) || (info->attrs[MRM_GENLA_GROUP_REPLACEMENTS] == NULL)) return -EINVAL;
+
+  replace_count = 0;
+  nla_for_each_nested(repl, info->attrs[MRM_GENLA_GROUP_REPLACEMENTS], rem) {
+    if (nla_type(repl) != MRM_GENLA_GROUP_REPLACEMENT) return -EINVAL;
+    if (++replace_count > MRM_REPLACE_GROUP_LIMIT) return -E2BIG;
+  }
+
+  g = kzalloc(MRM_REPLACE_GROUP_SIZE(replace_count), GFP_KERNEL);
+  if (g == NULL) {
+    return -ENOMEM;
+  }
+  mrm_genl_get_string(g->name, sizeof(g->name), info->attrs[MRM_GENLA_GROUP_NAME]);
+  nla_for_each_nested(repl, info->attrs[MRM_GENLA_GROUP_REPLACEMENTS], rem) {
+    rv = mrm_genl_parse_replacement(repl, &g->replace[g->replace_count], info->extack);
+    if (rv != 0) {
+      kfree(g);
+      return rv;
+    }
+    ++g->replace_count;
+  }
+
+  *output = g;
+  return 0; /* success... the rest of the validation is up to mrm_set_group() */
+}
+
+static int
+mrm_genl_parse_mcast(struct genl_info * const info, struct mrm_mcast_group * const g) {
+  struct nlattr *tb[MRM_GENLA_MEMBER_MAX + 1];
+  const struct nlattr *member;
+  int rem;
+  int rv;
+
+  if (info->attrs[MRM_GENLA_MCAST_MEMBERS] == NULL) return -EINVAL;
+  g->original = nla_get_flag(info->attrs[MRM_GENLA_MCAST_KEEP_ORIGINAL]) ? MRMMCAST_KEEP_ORIGINAL : MRMMCAST_DROP_ORIGINAL;
+
+  nla_for_each_nested(member, info->attrs[MRM_GENLA_MCAST_MEMBERS], rem) {
+    if (nla_type(member) != MRM_GENLA_MCAST_MEMBER) return -EINVAL;
+    if (g->member_count >= MRM_MAX_MCAST_MEMBERS) return -E2BIG;
+    rv = nla_parse_nested(tb, MRM_GENLA_MEMBER_MAX, member, _genl_member_policy, info->extack);
+    if (rv != 0) return rv;
+
+    if ((tb[MRM_GENLA_MEMBER_MACADDR] == NULL) || (nla_len(tb[MRM_GENLA_MEMBER_MACADDR]) != ETH_ALEN)) return -EINVAL;
+    memcpy(g->members[g->member_count].macaddr, nla_data(tb[MRM_GENLA_MEMBER_MACADDR]), ETH_ALEN);
+    if (tb[MRM_GENLA_MEMBER_IFNAME] != NULL) {
+      mrm_genl_get_string(g->members[g->member_count].ifname, sizeof(g->members[g->member_count].ifname), tb[MRM_GENLA_MEMBER_IFNAME]);
+    }
+    ++g->member_count;
+  }
+  return 0; /* success... the rest of the validation is up to mrm_set_mcast_group() */
+}
+
+static int
+mrm_genl_get_macaddr(struct genl_info * const info, const int type, unsigned char * const macaddr) {
+  const struct nlattr * const nla = info->attrs[type];
+
+  if ((nla == NULL) || (nla_len(nla) != ETH_ALEN)) return -EINVAL;
+  memcpy(macaddr, nla_data(nla), ETH_ALEN);
+  return 0; /* success */
+}
+
+
+
+/* request handlers... */
+
+static int
+mrm_genl_reply(struct genl_info * const info, const u32 generation, const struct mrm_genl_msg * const m) {
+  struct sk_buff *skb;
+
+  skb = mrm_genl_build(info->snd_portid, info->snd_seq, info->genlhdr->cmd, generation, m, GFP_KERNEL);
+  if (skb == NULL) {
+    return -ENOMEM;
+  }
+  return genlmsg_reply(skb, info);
+}
+
+static int
+mrm_genl_getfilter(struct sk_buff *skb, struct genl_info *info) {
+  struct mrm_filter_config_v2 hdr, *conf;
+  struct mrm_genl_msg m;
+  u32 generation;
+  int rv;
+
+  if (info->attrs[MRM_GENLA_FILTER_NAME] == NULL) return -EINVAL;
+
+  memset(&hdr, 0, sizeof(hdr));
+  mrm_genl_get_string(hdr.name, sizeof(hdr.name), info->attrs[MRM_GENLA_FILTER_NAME]);
+
+  conf = NULL;
+  mrm_runconf_lock();
+  rv = mrm_get_filter(&hdr, 0); /* just finding out how many rules there are... */
+  if (rv == -ENOSPC) {
+    conf = kmalloc(MRM_FILTER_CONFIG_V2_SIZE(hdr.rule_count), GFP_KERNEL);
+    if (conf == NULL) {
+      rv = -ENOMEM;
+    }
+    else {
+      memcpy(conf, &hdr, sizeof(hdr));
+      rv = mrm_get_filter(conf, hdr.rule_count);
+    }
+  }
+  generation = mrm_get_generation();
+  mrm_runconf_unlock();
+
+  if (rv == 0) {
+    memset(&m, 0, sizeof(m));
+    m.filter_conf = (conf != NULL) ? conf : &hdr;
+    m.filter_name = m.filter_conf->name;
+    rv = mrm_genl_reply(info, generation, &m);
+  }
+  kfree(conf);
+  return rv;
+}
+
+static int
+mrm_genl_setfilter(struct sk_buff *skb, struct genl_info *info) {
+  struct mrm_filter_config_v2 *conf;
+  int rv;
+
+  rv = mrm_genl_parse_filter(info, &conf);
+  if (rv != 0) return rv;
+
+  mrm_runconf_lock();
+  rv = mrm_set_filter(conf);
+  mrm_runconf_unlock();
+
+  kfree(conf);
+  return rv;
+}
+
+static int
+mrm_genl_delfilter(struct sk_buff *skb, struct genl_info *info) {
+  char name[MRM_FILTER_NAME_MAX];
+  int rv;
+
+  if (info->attrs[MRM_GENLA_FILTER_NAME] == NULL) return -EINVAL;
+  mrm_genl_get_string(name, sizeof(name), info->attrs[MRM_GENLA_FILTER_NAME]);
+
+  mrm_runconf_lock();
+  rv = mrm_delete_filter(name);
+  mrm_runconf_unlock();
+  return rv;
+}
+
+static int
+mrm_genl_getremap(struct sk_buff *skb, struct genl_info *info) {
+  struct mrm_remap_entry *e;
+  struct mrm_genl_msg m;
+  u32 generation;
+  int rv;
+
+  e = kzalloc(sizeof(*e), GFP_KERNEL); /* too big for the kernel stack */
+  if (e == NULL) {
+    return -ENOMEM;
+  }
+
+  rv = mrm_genl_get_macaddr(info, MRM_GENLA_REMAP_MACADDR, e->match_macaddr);
+  if (rv == 0) {
+    mrm_runconf_lock();
+    rv = mrm_get_remap_entry(e);
+    generation = mrm_get_generation();
+    mrm_runconf_unlock();
+
+    if (rv == 0) {
+      memset(&m, 0, sizeof(m));
+      m.remap_macaddr = e->match_macaddr;
+      m.remap_conf    = e;
+      rv = mrm_genl_reply(info, generation, &m);
+    }
+  }
+
+  kfree(e);
+  return rv;
+}
+
+static int
+mrm_genl_setremap(struct sk_buff *skb, struct genl_info *info) {
+  struct mrm_remap_entry *e;
+  int rv;
+
+  e = kzalloc(sizeof(*e), GFP_KERNEL); /* too big for the kernel stack */
+  if (e == NULL) {
+    return -ENOMEM;
+  }
+
+  rv = mrm_genl_get_macaddr(info, MRM_GENLA_REMAP_MACADDR, e->match_macaddr);
+  if (rv == 0) rv = mrm_genl_parse_remap(info, e);
+  if (rv == 0) {
+    mrm_runconf_lock();
+    rv = mrm_set_remap_entry(e);
+    mrm_runconf_unlock();
+  }
+
+  kfree(e);
+  return rv;
+}
+
+static int
+mrm_genl_delremap(struct sk_buff *skb, struct genl_info *info) {
+  unsigned char macaddr[ETH_ALEN];
+  int rv;
+
+  rv = mrm_genl_get_macaddr(info, MRM_GENLA_REMAP_MACADDR, macaddr);
+  if (rv != 0) return rv;
+
+  mrm_runconf_lock();
+  rv = mrm_delete_remap(macaddr);
+  mrm_runconf_unlock();
+  return rv;
+}
+
+static int
+mrm_genl_getgroup(struct sk_buff *skb, struct genl_info *info) {
+  struct mrm_replace_group hdr, *conf;
+  struct mrm_genl_msg m;
+  u32 generation;
+  int rv;
+
+  if (info->attrs[MRM_GENLA_GROUP_NAME] == NULL) return -EINVAL;
+
+  memset(&hdr, 0, sizeof(hdr));
+  mrm_genl_get_string(hdr.name, sizeof(hdr.name), info->attrs[MRM_GENLA_GROUP_NAME]);
+
+  conf = NULL;
+  mrm_runconf_lock();
+  rv = mrm_get_group(&hdr, 0); /* just finding out how many replacements there are... */
+  if (rv == -ENOSPC) {
+    conf = kmalloc(MRM_REPLACE_GROUP_SIZE(hdr.replace_count), GFP_KERNEL);
+    if (conf == NULL) {
+      rv = -ENOMEM;
+    }
+    else {
+      memcpy(conf, &hdr, sizeof(hdr));
+      rv = mrm_get_group(conf, hdr.replace_count);
+    }
+  }
+  generation = mrm_get_generation();
+  mrm_runconf_unlock();
+
+  if (rv == 0) {
+    memset(&m, 0, sizeof(m));
+    m.group_conf = (conf != NULL) ? conf : &hdr;
+    m.group_name = m.group_conf->name;
+    rv = mrm_genl_reply(info, generation, &m);
+  }
+  kfree(conf);
+  return rv;
+}
+
+static int
+mrm_genl_setgroup(struct sk_buff *skb, struct genl_info *info) {
+  struct mrm_replace_group *conf;
+  int rv;
+
+  rv = mrm_genl_parse_group(info, &conf);
+  if (rv != 0) return rv;
+
+  mrm_runconf_lock();
+  rv = mrm_set_group(conf);
+  mrm_runconf_unlock();
+
+  kfree(conf);
+  return rv;
+}
+
+static int
+mrm_genl_delgroup(struct sk_buff *skb, struct genl_info *info) {
+  char name[MRM_FILTER_NAME_MAX];
+  int rv;
+
+  if (info->attrs[MRM_GENLA_GROUP_NAME] == NULL) return -EINVAL;
+  mrm_genl_get_string(name, sizeof(name), info->attrs[MRM_GENLA_GROUP_NAME]);
+
+  mrm_runconf_lock();
+  rv = mrm_delete_group(name);
+  mrm_runconf_unlock();
+  return rv;
+}
+
+static int
+mrm_genl_getmcast(struct sk_buff *skb, struct genl_info *info) {
+  struct mrm_mcast_group *g;
+  struct mrm_genl_msg m;
+  u32 generation;
+  int rv;
+
+  g = kzalloc(sizeof(*g), GFP_KERNEL);
+  if (g == NULL) {
+    return -ENOMEM;
+  }
+
+  rv = mrm_genl_get_macaddr(info, MRM_GENLA_MCAST_MACADDR, g->group_macaddr);
+  if (rv == 0) {
+    mrm_runconf_lock();
+    rv = mrm_get_mcast_group(g);
+    generation = mrm_get_generation();
+    mrm_runconf_unlock();
+
+    if (rv == 0) {
+      memset(&m, 0, sizeof(m));
+      m.mcast_macaddr = g->group_macaddr;
+      m.mcast_conf    = g;
+      rv = mrm_genl_reply(info, generation, &m);
+    }
+  }
+
+  kfree(g);
+  return rv;
+}
+
+static int
+mrm_genl_setmcast(struct sk_buff *skb, struct genl_info *info) {
+  struct mrm_mcast_group *g;
+  int rv;
+
+  g = kzalloc(sizeof(*g), GFP_KERNEL);
+  if (g == NULL) {
+    return -ENOMEM;
+  }
+
+  rv = mrm_genl_get_macaddr(info, MRM_GENLA_MCAST_MACADDR, g->group_macaddr);
+  if (rv == 0) rv = mrm_genl_parse_mcast(info, g);
+  if (rv == 0) {
+    mrm_runconf_lock();
+    rv = mrm_set_mcast_group(g);
+    mrm_runconf_unlock();
+  }
+
+  kfree(g);
+  return rv;
+}
+
+static int
+mrm_genl_delmcast(struct sk_buff *skb, struct genl_info *info) {
+  unsigned char macaddr[ETH_ALEN];
+  int rv;
+
+  rv = mrm_genl_get_macaddr(info, MRM_GENLA_MCAST_MACADDR, macaddr);
+  if (rv != 0) return rv;
+
+  mrm_runconf_lock();
+  rv = mrm_delete_mcast_group(macaddr);
+  mrm_runconf_unlock();
+  return rv;
+}
+
+static int
+mrm_genl_getgeneration(struct sk_buff *skb, struct genl_info *info) {
+  struct mrm_genl_msg m;
+
+  memset(&m, 0, sizeof(m));
+  return mrm_genl_reply(info, mrm_get_generation(), &m);
+}
+
+
+
+/* dumps... these walk the running configuration under the rcu read lock only,
+   picking up where the previous message left off (cb->args[0] and [1] hold the cursor) */
+
+struct mrm_genl_dump_ctx {
+  struct sk_buff            *skb;
+  struct netlink_callback   *cb;
+  u32                        generation;
+};
+
+static void *
+mrm_genl_dump_start_message(struct mrm_genl_dump_ctx * const d, const u8 cmd) {
+  void *hdr;
+
+  hdr = genlmsg_put(d->skb, NETLINK_CB(d->cb->skb).portid, d->cb->nlh->nlmsg_seq, &_genl_family, NLM_F_MULTI, cmd);
+  if (hdr == NULL) return NULL;
+  genl_dump_check_consistent(d->cb, hdr); /* flags the dump if the configuration changed since it started */
+  if (nla_put_u32(d->skb, MRM_GENLA_GENERATION, d->generation) != 0) {
+    genlmsg_cancel(d->skb, hdr);
+    return NULL;
+  }
+  return hdr;
+}
+
+static int
+mrm_genl_dump_filter(const char * const name, const struct mrm_filter_rule * const rules, const unsigned rule_count, void * const ctx) {
+  struct mrm_genl_dump_ctx * const d = ctx;
+  void *hdr;
+
+  hdr = mrm_genl_dump_start_message(d, MRM_GENL_CMD_GETFILTER);
+  if (hdr == NULL) return -EMSGSIZE;
+  if ((mrm_genl_put_string(d->skb, MRM_GENLA_FILTER_NAME, name, MRM_FILTER_NAME_MAX) != 0) ||
+      (mrm_genl_put_filter(d->skb, rules, rule_count) != 0)) {
+    genlmsg_cancel(d->skb, hdr);
+    return -EMSGSIZE; /* the next message picks up from here */
+  }
+  genlmsg_end(d->skb, hdr);
+  return 0; /* keep going */
+}
+
+static int
+mrm_genl_dump_remap(const struct mrm_remap_entry * const e, void * const ctx) {
+  struct mrm_genl_dump_ctx * const d = ctx;
+  void *hdr;
+
+  hdr = mrm_genl_dump_start_message(d, MRM_GENL_CMD_GETREMAP);
+  if (hdr == NULL) return -EMSGSIZE;
+  if ((nla_put(d->skb, MRM_GENLA_REMAP_MACADDR, ETH_ALEN, e->match_macaddr) != 0) ||
+      (mrm_genl_put_remap(d->skb, e) != 0)) {
+    genlmsg_cancel(d->skb, hdr);
+    return -EMSGSIZE; /* the next message picks up from here */
+  }
+  genlmsg_end(d->skb, hdr);
+  return 0; /* keep going */
+}
+
+static int
+mrm_genl_dump_group(const struct mrm_replace_group * const g, void * const ctx) {
+  struct mrm_genl_dump_ctx * const d = ctx;
+  void *hdr;
+
+  hdr = mrm_genl_dump_start_message(d, MRM_GENL_CMD_GETGROUP);
+  if (hdr == NULL) return -EMSGSIZE;
+  if ((mrm_genl_put_string(d->skb, MRM_GENLA_GROUP_NAME, g->name, MRM_FILTER_NAME_MAX) != 0) ||
+      (mrm_genl_put_group(d->skb, g) != 0)) {
+    genlmsg_cancel(d->skb, hdr);
+    return -EMSGSIZE; /* the next message picks up from here */
+  }
+  genlmsg_end(d->skb, hdr);
+  return 0; /* keep going */
+}
+
+static int
+mrm_genl_dump_mcast(const struct mrm_mcast_group * const g, void * const ctx) {
+  struct mrm_genl_dump_ctx * const d = ctx;
+  void *hdr;
+
+  hdr = mrm_genl_dump_start_message(d, MRM_GENL_CMD_GETMCAST);
+  if (hdr == NULL) return -EMSGSIZE;
+  if ((nla_put(d->skb, MRM_GENLA_MCAST_MACADDR, ETH_ALEN, g->group_macaddr) != 0) ||
+      (mrm_genl_put_mcast(d->skb, g) != 0)) {
+    genlmsg_cancel(d->skb, hdr);
+    return -EMSGSIZE; /* the next message picks up from here */
+  }
+  genlmsg_end(d->skb, hdr);
+  return 0; /* keep going */
+}
+
+static int
+mrm_genl_dump(struct sk_buff *skb, struct netlink_callback *cb, const u8 cmd) {
+  struct mrm_genl_dump_ctx d;
+  struct mrm_rcdb_cursor cursor;
+  int rv;
+
+  d.skb = skb;
+  d.cb  = cb;
+  d.generation = mrm_get_generation();
+  cb->seq = d.generation; /* what genl_dump_check_consistent() compares against */
+
+  cursor.headidx = cb->args[0];
+  cursor.pos     = cb->args[1];
+  switch (cmd) {
+  case MRM_GENL_CMD_GETFILTER:
+    rv = mrm_walk_filters(&cursor, &mrm_genl_dump_filter, &d);
+    break;
+  case MRM_GENL_CMD_GETREMAP:
+    rv = mrm_walk_remaps(&cursor, &mrm_genl_dump_remap, &d);
+    break;
+  case MRM_GENL_CMD_GETGROUP:
+    rv = mrm_walk_groups(&cursor, &mrm_genl_dump_group, &d);
+    break;
+  default:
+    rv = mrm_walk_mcast_groups(&cursor, &mrm_genl_dump_mcast, &d);
+    break;
+  }
+  cb->args[0] = cursor.headidx;
+  cb->args[1] = cursor.pos;
+
+  if ((rv != 0) && (rv != -EMSGSIZE)) return rv;
+  if ((rv == -EMSGSIZE) && (skb->len == 0)) return rv; /* a filter/group too big for even an empty dump message */
+  return skb->len; /* 0 once there is nothing left */
+}
+
+static int
+mrm_genl_largest_filter(const char * const name, const struct mrm_filter_rule * const rules, const unsigned rule_count, void * const ctx) {
+  unsigned * const largest = ctx;
+
+  if (rule_count > *largest) *largest = rule_count;
+  return 0; /* keep going */
+}
+
+/* every message of the dump gets room for the largest filter... a filter set larger than that
+   mid-dump ends it with EMSGSIZE (the dump is flagged as interrupted by then anyway) */
+static int
+mrm_genl_dump_filters_start(struct netlink_callback *cb) {
+  struct mrm_rcdb_cursor cursor;
+  unsigned largest;
+
+  memset(&cursor, 0, sizeof(cursor));
+  largest = 0;
+  mrm_walk_filters(&cursor, &mrm_genl_largest_filter, &largest);
+  cb->min_dump_alloc = MRM_GENL_FILTER_SIZE(largest);
+  return 0; /* success */
+}
+
+static int
+mrm_genl_dump_filters(struct sk_buff *skb, struct netlink_callback *cb) {
+  return mrm_genl_dump(skb, cb, MRM_GENL_CMD_GETFILTER);
+}
+
+static int
+mrm_genl_dump_remaps(struct sk_buff *skb, struct netlink_callback *cb) {
+  return mrm_genl_dump(skb, cb, MRM_GENL_CMD_GETREMAP);
+}
+
+static int
+mrm_genl_largest_group(const struct mrm_replace_group * const g, void * const ctx) {
+  unsigned * const largest = ctx;
+
+  if (g->replace_count > *largest) *largest = g->replace_count;
+  return 0; /* keep going */
+}
+
+/* same as mrm_genl_dump_filters_start() */
+static int
+mrm_genl_dump_groups_start(struct netlink_callback *cb) {
+  struct mrm_rcdb_cursor cursor;
+  unsigned largest;
+
+  memset(&cursor, 0, sizeof(cursor));
+  largest = 0;
+  mrm_walk_groups(&cursor, &mrm_genl_largest_group, &largest);
+  cb->min_dump_alloc = MRM_GENL_GROUP_SIZE(largest);
+  return 0; /* success */
+}
+
+static int
+mrm_genl_dump_groups(struct sk_buff *skb, struct netlink_callback *cb) {
+  return mrm_genl_dump(skb, cb, MRM_GENL_CMD_GETGROUP);
+}
+
+static int
+mrm_genl_dump_mcasts(struct sk_buff *skb, struct netlink_callback *cb) {
+  return mrm_genl_dump(skb, cb, MRM_GENL_CMD_GETMCAST);
+}
+
+
+
+/* the family itself... */
+
+/* the configuration is no one else's business either (station MAC addresses, ipset names)...
+   same as the control file, which only root can open */
+static const struct genl_ops _genl_ops[] = {
+  { cmd: MRM_GENL_CMD_GETFILTER,     doit: &mrm_genl_getfilter,     start: &mrm_genl_dump_filters_start, dumpit: &mrm_genl_dump_filters, flags: GENL_ADMIN_PERM },
+  { cmd: MRM_GENL_CMD_SETFILTER,     doit: &mrm_genl_setfilter,     flags: GENL_ADMIN_PERM },
+  { cmd: MRM_GENL_CMD_DELFILTER,     doit: &mrm_genl_delfilter,     flags: GENL_ADMIN_PERM },
+  { cmd: MRM_GENL_CMD_GETREMAP,      doit: &mrm_genl_getremap,      dumpit: &mrm_genl_dump_remaps, flags: GENL_ADMIN_PERM },
+  { cmd: MRM_GENL_CMD_SETREMAP,      doit: &mrm_genl_setremap,      flags: GENL_ADMIN_PERM },
+  { cmd: MRM_GENL_CMD_DELREMAP,      doit: &mrm_genl_delremap,      flags: GENL_ADMIN_PERM },
+  { cmd: MRM_GENL_CMD_GETGENERATION, doit: &mrm_genl_getgeneration },
+  { cmd: MRM_GENL_CMD_GETGROUP,      doit: &mrm_genl_getgroup,      start: &mrm_genl_dump_groups_start, dumpit: &mrm_genl_dump_groups, flags: GENL_ADMIN_PERM },
+  { cmd: MRM_GENL_CMD_SETGROUP,      doit: &mrm_genl_setgroup,      flags: GENL_ADMIN_PERM },
+  { cmd: MRM_GENL_CMD_DELGROUP,      doit: &mrm_genl_delgroup,      flags: GENL_ADMIN_PERM },
+  { cmd: MRM_GENL_CMD_GETMCAST,      doit: &mrm_genl_getmcast,      dumpit: &mrm_genl_dump_mcasts, flags: GENL_ADMIN_PERM },
+  { cmd: MRM_GENL_CMD_SETMCAST,      doit: &mrm_genl_setmcast,      flags: GENL_ADMIN_PERM },
+  { cmd: MRM_GENL_CMD_DELMCAST,      doit: &mrm_genl_delmcast,      flags: GENL_ADMIN_PERM },
+};
+
+/* the notifications carry the configuration too... kernels that can check who joins the group get to */
+static const struct genl_multicast_group _genl_mcgrps[] = {
+#ifdef GENL_MCAST_CAP_NET_ADMIN
+  { name: MRM_GENL_MCGRP, flags: GENL_MCAST_CAP_NET_ADMIN },
+#else
+  { name: MRM_GENL_MCGRP },
+#endif
+};
+
+static struct genl_family _genl_family = {
+  name:      MRM_GENL_NAME,
+  version:   MRM_GENL_VERSION,
+  maxattr:   MRM_GENLA_MAX,
+  policy:    _genl_policy,
+  module:    THIS_MODULE,
+  ops:       _genl_ops,
+  n_ops:     ARRAY_SIZE(_genl_ops),
+  mcgrps:    _genl_mcgrps,
+  n_mcgrps:  ARRAY_SIZE(_genl_mcgrps),
+};
+
+int
+mrm_genl_init( void ) {
+  return genl_register_family(&_genl_family);
+}
+
+void
+mrm_genl_destroy( void ) {
+  genl_unregister_family(&_genl_family);
+}
+
+
+
+/* change notifications... called with the runconf lock held */
+
+static void
+mrm_genl_notify(struct sk_buff * const skb) {
+  if (skb == NULL) {
+    printk(KERN_WARNING "MRM Out of memory sending a netlink change notification!\n");
+    return; /* the generation still moved on... listeners can tell they missed something */
+  }
+  genlmsg_multicast(&_genl_family, skb, 0, 0, GFP_KERNEL);
+}
+
+void
+mrm_genl_notify_filter(const u8 cmd, const char * const name, const struct mrm_filter_config_v2 * const conf, const u32 generation) {
+  struct mrm_genl_msg m;
+
+  if (!genl_has_listeners(&_genl_family, &init_net, 0)) return;
+  memset(&m, 0, sizeof(m));
+  m.filter_name = name;
+  m.filter_conf = conf;
+  mrm_genl_notify(mrm_genl_build(0, 0, cmd, generation, &m, GFP_KERNEL));
+}
+
+void
+mrm_genl_notify_remap(const u8 cmd, const unsigned char * const macaddr, const struct mrm_remap_entry * const conf, const u32 generation) {
+  struct mrm_genl_msg m;
+
+  if (!genl_has_listeners(&_genl_family, &init_net, 0)) return;
+  memset(&m, 0, sizeof(m));
+  m.remap_macaddr = macaddr;
+  m.remap_conf    = conf;
+  mrm_genl_notify(mrm_genl_build(0, 0, cmd, generation, &m, GFP_KERNEL));
+}
+
+void
+mrm_genl_notify_group(const u8 cmd, const char * const name, const struct mrm_replace_group * const conf, const u32 generation) {
+  struct mrm_genl_msg m;
+
+  if (!genl_has_listeners(&_genl_family, &init_net, 0)) return;
+  memset(&m, 0, sizeof(m));
+  m.group_name = name;
+  m.group_conf = conf;
+  mrm_genl_notify(mrm_genl_build(0, 0, cmd, generation, &m, GFP_KERNEL));
+}
+
+void
+mrm_genl_notify_mcast(const u8 cmd, const unsigned char * const macaddr, const struct mrm_mcast_group * const conf, const u32 generation) {
+  struct mrm_genl_msg m;
+
+  if (!genl_has_listeners(&_genl_family, &init_net, 0)) return;
+  memset(&m, 0, sizeof(m));
+  m.mcast_macaddr = macaddr;
+  m.mcast_conf    = conf;
+  mrm_genl_notify(mrm_genl_build(0, 0, cmd, generation, &m, GFP_KERNEL));
+}
+
+void
+mrm_genl_notify_resync(const u32 generation) {
+  struct mrm_genl_msg m;
+
+  if (!genl_has_listeners(&_genl_family, &init_net, 0)) return;
+  memset(&m, 0, sizeof(m));
+  mrm_genl_notify(mrm_genl_build(0, 0, MRM_GENL_CMD_RESYNC, generation, &m, GFP_KERNEL));
+}
+
+
+#else /* the generic netlink interface needs Linux 5.2+ (strict attribute validation)... the ioctl()s still work */
+
+int mrm_genl_init( void ) { return 0; }
+void mrm_genl_destroy( void ) { }
+void mrm_genl_notify_filter(const u8 cmd, const char * const name, const struct mrm_filter_config_v2 * const conf, const u32 generation) { }
+void mrm_genl_notify_remap(const u8 cmd, const unsigned char * const macaddr, const struct mrm_remap_entry * const conf, const u32 generation) { }
+void mrm_genl_notify_group(const u8 cmd, const char * const name, const struct mrm_replace_group * const conf, const u32 generation) { }
+void mrm_genl_notify_mcast(const u8 cmd, const unsigned char * const macaddr, const struct mrm_mcast_group * const conf, const u32 generation) { }
+void mrm_genl_notify_resync(const u32 generation) { }
+
+#endif
@@ -0,0 +1,34 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+* Copyright (c) 2018 Cable Television Laboratories, Inc. ("CableLabs")
+*                    and others.  All rights reserved.
+*
+* Created by Jon Dennis (j.dennis@cablelabs.com)
+*/
+
+#ifndef MRM_GENL_H_INCLUDED
+#define MRM_GENL_H_INCLUDED
+
+#include "./macremapper_netlink.h"
+
+#include <linux/types.h>
+
+/*
+  the generic netlink control interface (see macremapper_netlink.h)...
+
+  works alongside the /proc/macremapctl ioctl()s, and tells
+  anyone listening about filter/remap/group/multicast group changes made through
+  either one of them
+*/
+
+int mrm_genl_init( void );
+void mrm_genl_destroy( void );
+
+/* change notifications... conf is NULL for deletions */
+void mrm_genl_notify_filter( const u8 /* cmd */, const char * const /* name */, const struct mrm_filter_config_v2 * const /* conf */, const u32 /* generation */ );
+void mrm_genl_notify_remap( const u8 /* cmd */, const unsigned char * const /* macaddr */, const struct mrm_remap_entry * const /* conf */, const u32 /* generation */ );
+void mrm_genl_notify_group( const u8 /* cmd */, const char * const /* name */, const struct mrm_replace_group * const /* conf */, const u32 /* generation */ );
+void mrm_genl_notify_mcast( const u8 /* cmd */, const unsigned char * const /* macaddr */, const struct mrm_mcast_group * const /* conf */, const u32 /* generation */ );
+void mrm_genl_notify_resync( const u32 /* generation */ );
+
+#endif /* #ifndef MRM_GENL_H_INCLUDED */
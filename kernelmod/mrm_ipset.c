@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+* Copyright (c) 2018 Cable Television Laboratories, Inc. ("CableLabs")
+*                    and others.  All rights reserved.
+*
+* Created by Jon Dennis (j.dennis@cablelabs.com)
+*/
+
+#include "./mrm_ipset.h"
+
+#include <linux/module.h>
+#include <linux/string.h>
+#include <linux/netfilter.h>
+#include <net/net_namespace.h>
+
+#ifdef MRM_HAVE_IPSET
+  #include <linux/netfilter/x_tables.h>
+  #include <linux/netfilter/ipset/ip_set.h>
+#endif
+
+
+#ifdef MRM_HAVE_IPSET
+
+/* the sets are the ones of the initial network namespace, same as the bridge ports we look at */
+#define IPSET_NET (&init_net)
+
+static int
+mrm_ipset_get(struct mrm_filter_rule * const rule) {
+  struct mrm_ipaddr_filter * const f = &rule->src_ipaddr;
+  struct ip_set *set;
+  ip_set_id_t index;
+  u8 family;
+
+  if (strnlen(f->ipset_name, sizeof(f->ipset_name)) >= sizeof(f->ipset_name)) {
+    printk(KERN_WARNING "MRM Bad ipset name!\n");
+    return -EINVAL;
+  }
+
+  /* the rule only ever gets consulted for frames of its own family... */
+  switch (rule->family) {
+  case AF_INET:  family = NFPROTO_IPV4; break;
+  case AF_INET6: family = NFPROTO_IPV6; break;
+  default:
+    printk(KERN_WARNING "MRM ipset rule without an address family!\n");
+    return -EINVAL;
+  }
+
+  index = ip_set_get_byname(IPSET_NET, f->ipset_name, &set);
+  if (index == IPSET_INVALID_ID) {
+    printk(KERN_WARNING "MRM No such ipset: %s\n", f->ipset_name);
+    return -ENOENT;
+  }
+
+  /* ...and the set has to be one of plain addresses of that family */
+  if ((set->type->dimension > IPSET_DIM_ONE) || ((set->family != NFPROTO_UNSPEC) && (set->family != family))) {
+    printk(KERN_WARNING "MRM ipset %s is not a set of %s addresses\n", f->ipset_name, (family == NFPROTO_IPV4) ? "IPv4" : "IPv6");
+    ip_set_put_byindex(IPSET_NET, index);
+    return -EINVAL;
+  }
+
+  f->ipset_index = index;
+  return 0; /* success */
+}
+
+int
+mrm_ipset_get_rules( struct mrm_filter_rule * const rules, const unsigned rule_count ) {
+  unsigned count;
+  unsigned i;
+  int rv;
+
+  count = 0;
+  for (i = 0; i < rule_count; ++i) {
+    if (rules[i].src_ipaddr.match_type != MRMIPFILT_MATCHIPSET) continue;
+    rv = mrm_ipset_get(&rules[i]);
+    if (rv != 0) {
+      mrm_ipset_put_rules(rules, i); /* the ones before this one */
+      return rv;
+    }
+    ++count;
+  }
+  return count;
+}
+
+void
+mrm_ipset_put_rules( const struct mrm_filter_rule * const rules, const unsigned rule_count ) {
+  unsigned i;
+
+  for (i = 0; i < rule_count; ++i) {
+    if (rules[i].src_ipaddr.match_type != MRMIPFILT_MATCHIPSET) continue;
+    ip_set_put_byindex(IPSET_NET, rules[i].src_ipaddr.ipset_index);
+  }
+}
+
+int
+mrm_ipset_test( const unsigned ipset_index, const int family, const struct sk_buff * const skb ) {
+  struct xt_action_param par;
+  struct ip_set_adt_opt opt;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,10,0)
+  struct nf_hook_state state;
+#endif
+
+  /* what the set match (xt_set) would hand it for "--match-set <name> src"... */
+  memset(&par, 0, sizeof(par));
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,10,0)
+  memset(&state, 0, sizeof(state));
+  state.pf  = (family == AF_INET6) ? NFPROTO_IPV6 : NFPROTO_IPV4;
+  state.net = IPSET_NET;
+  par.state = &state;
+#else
+  par.family = (family == AF_INET6) ? NFPROTO_IPV6 : NFPROTO_IPV4;
+  par.in     = skb->dev;
+  #if LINUX_VERSION_CODE >= KERNEL_VERSION(4,4,0)
+    par.net  = IPSET_NET;
+  #endif
+#endif
+
+  memset(&opt, 0, sizeof(opt));
+  opt.family      = (family == AF_INET6) ? NFPROTO_IPV6 : NFPROTO_IPV4;
+  opt.dim         = IPSET_DIM_ONE;
+  opt.flags       = IPSET_DIM_ONE_SRC;
+  opt.ext.timeout = UINT_MAX; /* keep the entry's own timeout */
+
+  return ip_set_test((ip_set_id_t)ipset_index, skb, &par, &opt) > 0;
+}
+
+#else /* #ifdef MRM_HAVE_IPSET */
+
+int
+mrm_ipset_get_rules( struct mrm_filter_rule * const rules, const unsigned rule_count ) {
+  unsigned i;
+
+  for (i = 0; i < rule_count; ++i) {
+    if (rules[i].src_ipaddr.match_type == MRMIPFILT_MATCHIPSET) {
+      printk(KERN_WARNING "MRM ipset rules need a kernel with ipset support!\n");
+      return -EOPNOTSUPP;
+    }
+  }
+  return 0; /* none of them are ipset rules */
+}
+
+void
+mrm_ipset_put_rules( const struct mrm_filter_rule * const rules, const unsigned rule_count ) {
+}
+
+int
+mrm_ipset_test( const unsigned ipset_index, const int family, const struct sk_buff * const skb ) {
+  return 0; /* cant get here... no ipset rule gets set */
+}
+
+#endif /* #ifdef MRM_HAVE_IPSET */
@@ -0,0 +1,40 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+* Copyright (c) 2018 Cable Television Laboratories, Inc. ("CableLabs")
+*                    and others.  All rights reserved.
+*
+* Created by Jon Dennis (j.dennis@cablelabs.com)
+*/
+
+#ifndef MRM_IPSET_H_INCLUDED
+#define MRM_IPSET_H_INCLUDED
+
+#include "./macremapper_filter_config.h"
+
+#include <linux/version.h>
+#include <linux/kconfig.h>
+#include <linux/skbuff.h>
+
+/*
+  the MRMIPFILT_MATCHIPSET source address matches...
+
+  the filter rules name an existing ipset, which gets looked up (and
+  held on to) when the filter is set, and tested against in the
+  "critical path" with the set's own in-kernel test function... so
+  its members can change with ipset(8) without touching the filter
+*/
+
+#if IS_ENABLED(CONFIG_IP_SET) && (LINUX_VERSION_CODE >= KERNEL_VERSION(3,13,0))
+  #define MRM_HAVE_IPSET
+#endif
+
+/* takes a reference on the set of every ipset rule (filling in its ipset_index)...
+   returns how many of the rules are ipset rules, or a negative error with no references taken */
+int mrm_ipset_get_rules( struct mrm_filter_rule * const /* rules */, const unsigned /* rule_count */ );
+/* ...and drops them again (process context only) */
+void mrm_ipset_put_rules( const struct mrm_filter_rule * const /* rules */, const unsigned /* rule_count */ );
+
+/* is the frame's source address in the set? */
+int mrm_ipset_test( const unsigned /* ipset_index */, const int /* family */, const struct sk_buff * const /* skb */ );
+
+#endif /* #ifndef MRM_IPSET_H_INCLUDED */
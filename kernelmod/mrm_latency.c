@@ -0,0 +1,175 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+* Copyright (c) 2018 Cable Television Laboratories, Inc. ("CableLabs")
+*                    and others.  All rights reserved.
+*
+* Created by Jon Dennis (j.dennis@cablelabs.com)
+*/
+
+#include "./mrm_latency.h"
+
+#include <linux/module.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
+#include <linux/mutex.h>
+#include <linux/string.h>
+
+
+#define DEBUGFS_DIRNAME "macremapper"
+
+struct mrm_latency_pcpu __percpu *mrm_latency_pcpu;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,3,0)
+  DEFINE_STATIC_KEY_FALSE(mrm_latency_key);
+  #define mrm_latency_switch_on()  static_branch_enable(&mrm_latency_key)
+  #define mrm_latency_switch_off() static_branch_disable(&mrm_latency_key)
+#else
+  struct static_key mrm_latency_key = STATIC_KEY_INIT_FALSE;
+  #define mrm_latency_switch_on()  static_key_slow_inc(&mrm_latency_key)
+  #define mrm_latency_switch_off() static_key_slow_dec(&mrm_latency_key)
+#endif
+
+unsigned mrm_latency_sample_every; /* 0 = off */
+
+static DEFINE_MUTEX(_latency_mutex); /* one sample rate change at a time */
+static struct dentry *_debugfs_dir;
+
+static const char * const _stage_names[MRM_LAT_STAGES] = {
+  [MRM_LAT_HOOK]     = "Bridge Hook",
+  [MRM_LAT_LOOKUP]   = "Remap Lookup",
+  [MRM_LAT_PARSE]    = "Header Parse",
+  [MRM_LAT_CLASSIFY] = "Rule Scan",
+  [MRM_LAT_APPLY]    = "Apply Remap",
+};
+
+
+
+/* read()s of "latency" add up the histograms of all the cpus... */
+static int
+mrm_latency_show(struct seq_file *sf, void *v) {
+  unsigned long total[MRM_LATENCY_BUCKETS];
+  unsigned long samples;
+  unsigned stage, cpu, i;
+
+  seq_printf(sf, "Sampling 1 in %u frames per cpu%s\n", mrm_latency_sample_every, (mrm_latency_sample_every == 0) ? " (off)" : "");
+  for (stage = 0; stage < MRM_LAT_STAGES; ++stage) {
+    memset(total, 0, sizeof(total));
+    samples = 0;
+    for_each_possible_cpu(cpu) {
+      for (i = 0; i < MRM_LATENCY_BUCKETS; ++i) {
+        total[i] += per_cpu_ptr(mrm_latency_pcpu, cpu)->hist[stage][i];
+      }
+    }
+    for (i = 0; i < MRM_LATENCY_BUCKETS; ++i) {
+      samples += total[i];
+    }
+
+    seq_printf(sf, "%s: (Total Samples %lu)\n", _stage_names[stage], samples);
+    for (i = 0; i < MRM_LATENCY_BUCKETS; ++i) {
+      if (total[i] == 0) continue;
+      if (i == 0) seq_printf(sf, "  %10u            ns: %lu\n", 0, total[i]);
+      else if (i == MRM_LATENCY_BUCKETS - 1) seq_printf(sf, "  %10lu and over   ns: %lu\n", 1UL << (i - 1), total[i]);
+      else seq_printf(sf, "  %10lu-%-10lu ns: %lu\n", 1UL << (i - 1), (1UL << i) - 1, total[i]);
+    }
+  }
+  return 0;
+}
+
+static int
+mrm_latency_open(struct inode *in, struct file *f) {
+  return single_open(f, &mrm_latency_show, NULL);
+}
+
+/* ...and any write()s clear them (a sample being recorded right then may survive) */
+static ssize_t
+mrm_latency_write(struct file *f, const char __user *buf, size_t len, loff_t *ppos) {
+  unsigned cpu;
+
+  for_each_possible_cpu(cpu) {
+    memset(per_cpu_ptr(mrm_latency_pcpu, cpu)->hist, 0, sizeof(per_cpu_ptr(mrm_latency_pcpu, cpu)->hist));
+  }
+  return len;
+}
+
+static const struct file_operations _latency_fops = {
+  owner:    THIS_MODULE,
+  open:     &mrm_latency_open,
+  read:     &seq_read,
+  write:    &mrm_latency_write,
+  llseek:   &seq_lseek,
+  release:  &single_release,
+};
+
+
+/* "latency_sample_every" switches the sampling on (and the static key along with it) or off */
+static ssize_t
+mrm_latency_sample_read(struct file *f, char __user *buf, size_t len, loff_t *ppos) {
+  char tmp[16];
+  int n;
+
+  n = snprintf(tmp, sizeof(tmp), "%u\n", READ_ONCE(mrm_latency_sample_every));
+  return simple_read_from_buffer(buf, len, ppos, tmp, n);
+}
+
+static ssize_t
+mrm_latency_sample_write(struct file *f, const char __user *buf, size_t len, loff_t *ppos) {
+  unsigned every;
+  int rv;
+
+  rv = kstrtouint_from_user(buf, len, 0, &every);
+  if (rv != 0) return rv;
+
+  mutex_lock(&_latency_mutex);
+  if ((every > 0) && (mrm_latency_sample_every == 0)) {
+    WRITE_ONCE(mrm_latency_sample_every, every);
+    mrm_latency_switch_on();
+  }
+  else if ((every == 0) && (mrm_latency_sample_every > 0)) {
+    mrm_latency_switch_off();
+    WRITE_ONCE(mrm_latency_sample_every, 0);
+  }
+  else {
+    WRITE_ONCE(mrm_latency_sample_every, every); /* just a new rate... or still off */
+  }
+  mutex_unlock(&_latency_mutex);
+
+  return len;
+}
+
+static const struct file_operations _sample_fops = {
+  owner:    THIS_MODULE,
+  read:     &mrm_latency_sample_read,
+  write:    &mrm_latency_sample_write,
+  llseek:   &default_llseek,
+};
+
+
+
+int
+mrm_latency_init( void ) {
+  mrm_latency_pcpu = alloc_percpu(struct mrm_latency_pcpu);
+  if (mrm_latency_pcpu == NULL) {
+    return -ENOMEM;
+  }
+
+  /* debugfs is a nice to have... the module does just fine without it */
+  _debugfs_dir = debugfs_create_dir(DEBUGFS_DIRNAME, NULL);
+  if (IS_ERR_OR_NULL(_debugfs_dir)) {
+    _debugfs_dir = NULL;
+    return 0;
+  }
+  debugfs_create_file("latency", 0600, _debugfs_dir, NULL, &_latency_fops);
+  debugfs_create_file("latency_sample_every", 0600, _debugfs_dir, NULL, &_sample_fops);
+
+  return 0; /* success */
+}
+
+void
+mrm_latency_destroy( void ) {
+  debugfs_remove_recursive(_debugfs_dir); /* fine with NULL */
+  if (mrm_latency_sample_every > 0) {
+    mrm_latency_switch_off();
+  }
+  free_percpu(mrm_latency_pcpu);
+}
@@ -0,0 +1,111 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+* Copyright (c) 2018 Cable Television Laboratories, Inc. ("CableLabs")
+*                    and others.  All rights reserved.
+*
+* Created by Jon Dennis (j.dennis@cablelabs.com)
+*/
+
+#ifndef MRM_LATENCY_H_INCLUDED
+#define MRM_LATENCY_H_INCLUDED
+
+#include <linux/version.h>
+#include <linux/types.h>
+#include <linux/percpu.h>
+#include <linux/kernel.h>
+#include <linux/jump_label.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,11,0)
+  #include <linux/sched/clock.h>
+#else
+  #include <linux/sched.h>
+#endif
+
+/*
+  sampled latency histograms of the bridge hook, stage by stage...
+
+  off (and patched out by a static key) until a sample rate gets written to
+  /sys/kernel/debug/macremapper/latency_sample_every... then every Nth frame
+  on each cpu gets timed, and the log2 histograms read out of
+  /sys/kernel/debug/macremapper/latency (any write to it clears them)
+*/
+
+enum {
+  MRM_LAT_HOOK = 0,   /* the whole hook */
+  MRM_LAT_LOOKUP,     /* the remap table lookup */
+  MRM_LAT_PARSE,      /* the L3/L4 headers into a flow key */
+  MRM_LAT_CLASSIFY,   /* the rule scan */
+  MRM_LAT_APPLY,      /* picking a replacement and moving the frame */
+  MRM_LAT_STAGES,
+};
+
+/* bucket N counts the samples that took [2^(N-1), 2^N) nanoseconds... the last one anything longer */
+#define MRM_LATENCY_BUCKETS 32
+
+struct mrm_latency_pcpu {
+  unsigned        countdown; /* frames until the next sample */
+  unsigned        sampling;  /* the frame going through right now is being timed */
+  unsigned long   hist[MRM_LAT_STAGES][MRM_LATENCY_BUCKETS];
+};
+extern struct mrm_latency_pcpu __percpu *mrm_latency_pcpu;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,3,0)
+  DECLARE_STATIC_KEY_FALSE(mrm_latency_key);
+  #define mrm_latency_enabled() static_branch_unlikely(&mrm_latency_key)
+#else
+  extern struct static_key mrm_latency_key;
+  #define mrm_latency_enabled() static_key_false(&mrm_latency_key)
+#endif
+
+extern unsigned mrm_latency_sample_every;
+
+static inline void
+mrm_latency_record(const unsigned stage, const u64 start) {
+  const u64 elapsed = local_clock() - start;
+  unsigned bucket;
+
+  bucket = fls64(elapsed);
+  if (bucket >= MRM_LATENCY_BUCKETS) bucket = MRM_LATENCY_BUCKETS - 1;
+  this_cpu_ptr(mrm_latency_pcpu)->hist[stage][bucket]++;
+}
+
+/* the hook decides whether its frame gets timed... returns 0 when it does not */
+static inline u64
+mrm_latency_hook_begin( void ) {
+  struct mrm_latency_pcpu *l;
+
+  if (!mrm_latency_enabled()) return 0;
+  l = this_cpu_ptr(mrm_latency_pcpu);
+  if (l->countdown > 0) {
+    --l->countdown;
+    l->sampling = 0; /* in case sampling got switched off halfway through the last one */
+    return 0;
+  }
+  l->countdown = max(READ_ONCE(mrm_latency_sample_every), 1U) - 1; /* may be getting switched off */
+  l->sampling  = 1;
+  return local_clock();
+}
+
+static inline void
+mrm_latency_hook_end(const u64 start) {
+  if (!mrm_latency_enabled() || (start == 0)) return;
+  mrm_latency_record(MRM_LAT_HOOK, start);
+  this_cpu_ptr(mrm_latency_pcpu)->sampling = 0;
+}
+
+/* ...and the stages along the way only time themselves when it does */
+static inline u64
+mrm_latency_start( void ) {
+  if (!mrm_latency_enabled() || !this_cpu_ptr(mrm_latency_pcpu)->sampling) return 0;
+  return local_clock();
+}
+
+static inline void
+mrm_latency_end(const unsigned stage, const u64 start) {
+  if (!mrm_latency_enabled() || (start == 0)) return;
+  mrm_latency_record(stage, start);
+}
+
+int mrm_latency_init( void );
+void mrm_latency_destroy( void );
+
+#endif /* #ifndef MRM_LATENCY_H_INCLUDED */
@@ -0,0 +1,120 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+* Copyright (c) 2018 Cable Television Laboratories, Inc. ("CableLabs")
+*                    and others.  All rights reserved.
+*
+* Created by Jon Dennis (j.dennis@cablelabs.com)
+*/
+
+
+
+#include "./mrm_loadbal.h"
+#include "./mrm_rcdb.h"
+#include "./mrm_stats.h"
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/percpu.h>
+#include <linux/workqueue.h>
+#include <linux/jiffies.h>
+
+
+/* tunables... */
+unsigned int mrm_load_sample_interval = 5;
+module_param_named(load_sample_interval, mrm_load_sample_interval, uint, 0644);
+MODULE_PARM_DESC(load_sample_interval, "Milliseconds between load samples for least-load remaps");
+
+/* the EWMA gives each new sample a weight of 1/(2^LOAD_EWMA_SHIFT) */
+#define LOAD_EWMA_SHIFT 3
+
+static struct delayed_work _sample_work;
+static unsigned _sample_pass; /* bumped for every sample taken */
+
+
+static void
+mrm_loadbal_sample_replace_set(struct mrm_runconf_replace_set * const r) {
+  const unsigned long * const live_mask = rcu_dereference(r->live)->mask;
+  unsigned long sum;
+  unsigned long best_score, score;
+  u64 frames, bytes;
+  unsigned best;
+  unsigned cpu, i;
+
+  best = 0;
+  best_score = ~0UL;
+  for (i = 0; i < r->replace_count; ++i) {
+    sum = 0;
+    for_each_possible_cpu(cpu) {
+      mrm_counter_fetch(&per_cpu_ptr(r->replace_pcpu, cpu)[i].tx, &frames, &bytes);
+      sum += (unsigned long)bytes; /* only the low bits... the delta survives the wrapping */
+    }
+
+    /* the counters only ever go up (modulo wrapping)... so the delta is what we sent since last time */
+    r->replace[i].load_ewma -= r->replace[i].load_ewma >> LOAD_EWMA_SHIFT;
+    r->replace[i].load_ewma += (sum - r->replace[i].load_last) >> LOAD_EWMA_SHIFT;
+    r->replace[i].load_last  = sum;
+
+    /* a replacement with twice the weight is meant to carry twice the load... and a dead one carries none */
+    if (!test_bit(i, live_mask)) continue;
+    score = r->replace[i].load_ewma / r->replace[i].weight;
+    if (score < best_score) {
+      best_score = score;
+      best = i;
+    }
+  }
+
+  /* only dirty the cache line the critical path reads when the answer changes */
+  if (r->replace_best != best) r->replace_best = best;
+}
+
+static void
+mrm_loadbal_sample_remap_entry(struct mrm_runconf_remap_entry * const r, void * const ctx) {
+  unsigned *leastload_count = ctx;
+  struct mrm_runconf_replace_set *s;
+  unsigned i;
+
+  for (i = 0; i < r->class_count; ++i) {
+    if (r->classes[i].policy != MRMREPLPOL_LEASTLOAD) continue;
+    ++(*leastload_count);
+
+    /* a named replacement group may be shared by any number of classes... sample it once */
+    s = rcu_dereference(r->classes[i].group->set);
+    if (s->load_pass == _sample_pass) continue;
+    s->load_pass = _sample_pass;
+    mrm_loadbal_sample_replace_set(s);
+  }
+}
+
+static void
+mrm_loadbal_sample(struct work_struct *work) {
+  unsigned leastload_count;
+
+  leastload_count = 0;
+  if (++_sample_pass == 0) _sample_pass = 1; /* a brand new set has never taken part in one */
+  rcu_read_lock();
+  mrm_rcdb_foreach_remap_entry(&mrm_loadbal_sample_remap_entry, &leastload_count);
+  rcu_read_unlock();
+
+  /* nobody left to sample for? go idle until mrm_loadbal_kick() */
+  if (leastload_count > 0) mrm_loadbal_kick();
+}
+
+int
+mrm_loadbal_init( void ) {
+  INIT_DELAYED_WORK(&_sample_work, &mrm_loadbal_sample);
+  return 0; /* success */
+}
+
+void
+mrm_loadbal_destroy( void ) {
+  cancel_delayed_work_sync(&_sample_work);
+}
+
+void
+mrm_loadbal_kick( void ) {
+  unsigned long delay;
+
+  delay = msecs_to_jiffies(mrm_load_sample_interval);
+  if (delay == 0) delay = 1;
+  schedule_delayed_work(&_sample_work, delay); /* no-op if already queued */
+}
@@ -0,0 +1,26 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+* Copyright (c) 2018 Cable Television Laboratories, Inc. ("CableLabs")
+*                    and others.  All rights reserved.
+*
+* Created by Jon Dennis (j.dennis@cablelabs.com)
+*/
+
+#ifndef MRM_LOADBAL_H_INCLUDED
+#define MRM_LOADBAL_H_INCLUDED
+
+/*
+  the load sampler...
+
+  periodically (off the "critical path") folds the per-cpu byte
+  counters of every MRMREPLPOL_LEASTLOAD replacement set into an
+  EWMA and publishes the least loaded replacement as "replace_best"
+*/
+
+extern unsigned int mrm_load_sample_interval;
+
+int mrm_loadbal_init( void );
+void mrm_loadbal_destroy( void );
+void mrm_loadbal_kick( void );
+
+#endif /* #ifndef MRM_LOADBAL_H_INCLUDED */
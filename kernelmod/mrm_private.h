@@ -14,27 +14,178 @@
 
 #include <linux/list.h>
 #include <linux/hash.h>
+#include <linux/percpu.h>
+#include <linux/atomic.h>
+#include <linux/bitmap.h>
+#include <linux/u64_stats_sync.h>
+#include <linux/llist.h>
+
+
+/* a per-cpu data plane counter (see mrm_stats.h)... 64 bits even on the 32 bit machines, hence the syncp.
+   a reset just remembers where it was at, the reset_ members belong to whoever holds the runconf lock */
+struct mrm_counter_pcpu {
+  struct u64_stats_sync                  syncp;
+  u64                                    frames;
+  u64                                    bytes;
+  u64                                    reset_frames;
+  u64                                    reset_bytes;
+};
+
+/* the rules of a filter... a single allocation sized to the rule count, with the accelerator's
+   references stored right after the rules, swapped out as a whole whenever the filter gets set */
+struct mrm_runconf_filter_rules {
+  struct rcu_head                        rcu;
+  struct llist_node                      put_node;    /* waiting for its ipset references to be dropped */
+  struct mrm_filter_config_accelerator   accelerator;
+  unsigned                               ipset_count; /* MRMIPFILT_MATCHIPSET rules... each holds a reference on its set */
+  unsigned                               rule_count;
+  struct mrm_filter_rule                 rules[];
+};
 
 struct mrm_runconf_filter_node {
   struct list_head                       list;
+  struct hlist_node                      hnode; /* in the generation's filter name hash */
   struct rcu_head                        rcu;
-  struct mrm_filter_config               conf;
-  struct mrm_filter_config_accelerator   accelerator;
-  unsigned                               refcnt;
+  char                                   name[MRM_FILTER_NAME_MAX];
+  struct mrm_runconf_filter_rules __rcu *rules; /* NULL until the filter is first set */
+  atomic_t                               refcnt; /* count of remap classes using the filter */
+};
+
+
+/* the weighted replacement "slot" table is this big at most... and as the slots are u8,
+   so is a set of replacements (MRM_REPLACE_GROUP_LIMIT) */
+#define MRM_MAX_REPLACE_SLOTS 256
+
+/* per-cpu state of a single replacement, touched by the "critical path" for every frame moved to it */
+struct mrm_runconf_replace_pcpu {
+  struct mrm_counter_pcpu           tx;            /* what got moved to the replacement (the load sampler looks at tx.bytes too) */
+  struct mrm_counter_pcpu           shadow;        /* what remaps in shadow mode would have moved to it */
+  struct mrm_counter_pcpu           spilled;       /* what went over the replacement's rate limit */
+  struct mrm_counter_pcpu           dup;           /* MRMREPLPOL_REPLICATE: the extra copies (also in tx) */
+
+  /* this cpu's cache of tokens taken from the replacement's bucket (when rate limited)...
+     may go negative so that a (gso) frame larger than the burst still gets through once */
+  long                              tokens;
+};
+
+/* the token bucket of a rate limited replacement, shared by all the cpus... they only come
+   to it once their own cache of tokens (up to token_quantum of them) runs out */
+struct mrm_runconf_replace_bucket {
+  atomic_long_t                     tokens;       /* never more than the burst */
+  atomic_long_t                     stamp;        /* jiffies of the last refill */
+} ____cacheline_aligned_in_smp;
+
+/* which replacements of a set can currently take traffic (their interface is up and has carrier)...
+   rebuilt by the netdevice notifier and swapped in with RCU */
+struct mrm_runconf_replace_live {
+  struct rcu_head                   rcu;
+  DECLARE_BITMAP(mask, MRM_REPLACE_GROUP_LIMIT); /* bit per replace[] index */
+
+  /* precomputed from the live replacements' weights... each slot holds a replace[] index,
+     and each replacement occupies a share of the slots proportional to its weight */
+  unsigned                          slot_count;    /* 0 = none of the replacements are live */
+  u8                                slot[MRM_MAX_REPLACE_SLOTS];
+};
+
+struct mrm_runconf_replacement {
+  unsigned char                     macaddr[6];
+  char                              ifname[IFNAMSIZ]; /* "" = the replacement does not move frames to another interface */
+  struct net_device                *dev;              /* NULL while the named interface is not registered */
+  unsigned                          weight;
+  unsigned                          rate;       /* bytes per second, 0 = unlimited */
+  unsigned                          burst;      /* bytes */
+  long                              token_quantum; /* tokens a cpu takes from the bucket at a time */
+
+  /* MRMREPLPOL_LEASTLOAD: owned by the load sampler (see mrm_loadbal.c) */
+  unsigned long                     load_last;
+  unsigned long                     load_ewma;  /* bytes per sample interval */
+};
+
+/* a set of replacements... a single allocation sized to the replacement count, swapped out as a whole
+   (along with its counters) whenever the group it belongs to gets set */
+struct mrm_runconf_replace_set {
+  struct rcu_head                   rcu;
+  unsigned                          replace_idx;   /* used by the "critical path" to round-robin which live->slot[] member is to be used */
+  struct mrm_runconf_replace_live __rcu *live;
+  struct mrm_runconf_replace_pcpu __percpu *replace_pcpu; /* replace_count of them on every cpu */
+  struct mrm_runconf_replace_bucket *bucket;       /* replace_count of them */
+
+  /* MRMREPLPOL_LEASTLOAD: the "critical path" only ever reads replace_best,
+     everything else here is owned by the load sampler (see mrm_loadbal.c) */
+  unsigned                          replace_best;
+  unsigned                          load_pass;     /* the sample the set last took part in... it may be shared by many classes */
+
+  unsigned                          replace_count; /* total count of elements in the replace[] member */
+  struct mrm_runconf_replacement    replace[];
+};
+
+/* a replacement group... either a named one (shared by any number of remap classes)
+   or the replacements a class carries itself */
+struct mrm_runconf_replace_group {
+  struct list_head                  list;   /* named groups only */
+  struct rcu_head                   rcu;
+  char                              name[MRM_FILTER_NAME_MAX]; /* "" for the replacements of a class */
+  struct mrm_runconf_replace_set __rcu *set;
+  atomic_t                          refcnt; /* count of remap classes using the (named) group */
+};
+
+/* one traffic class of a remap entry... */
+struct mrm_runconf_remap_class {
+  struct mrm_runconf_filter_node   *filter;
+  unsigned                          policy;          /* MRMREPLPOL_* */
+  unsigned                          spill;           /* MRMSPILL_* */
+  unsigned                          elephant_bytes;  /* 0 = elephant flow mode disabled */
+  unsigned                          elephant_window; /* milliseconds */
+  unsigned long                     elephant_window_jiffies;
+  struct mrm_runconf_replace_group *group;           /* a named group, or own */
+  struct mrm_runconf_replace_group  own;
 };
 
+/* the merged classifier of a remap entry... rebuilt (and swapped in) whenever one of its filters changes,
+   the rule references are stored right after it */
+struct mrm_runconf_classifier {
+  struct rcu_head                   rcu;
+  struct mrm_classifier             classifier;
+  unsigned                          ref_count;
+  struct mrm_counter_pcpu __percpu *ref_pcpu;      /* a match counter per rule reference, ref_count of them on every cpu */
+  struct mrm_classifier_ruleref     refs[];
+};
 
 struct mrm_runconf_remap_entry {
   struct hlist_node                 hlist;
   struct rcu_head                   rcu;
-  struct mrm_runconf_filter_node   *filter;
   unsigned char                     match_macaddr[6];
-  unsigned                          replace_count; /* total count of elements in the replace[] member */
-  unsigned                          replace_idx;   /* used by the "critical path" to round-robin which replace[] member is to be used */
-  struct {
-    unsigned char                     macaddr[6];
-    struct net_device                *dev;
-  } replace[MRM_MAX_REPLACE];
+  unsigned                          elephant_classes; /* how many of the classes are in elephant flow mode */
+  unsigned                          shadow;           /* only counting where the frames would go */
+  unsigned                          idle_timeout;     /* seconds... 0 = never ages out */
+  unsigned long                     last_hit;         /* jiffies... only kept (coarsely) with an idle timeout */
+  struct mrm_runconf_classifier __rcu *classifier;
+  struct mrm_runconf_classifier    *next_classifier; /* only while mrm_rcdb_rebuild_classifiers() runs */
+  unsigned                          class_count;
+  struct mrm_runconf_remap_class   *classes;       /* class_count long, in evaluation order */
+};
+
+
+/* per-cpu counters of a multicast group being converted to unicast */
+struct mrm_runconf_mcast_pcpu {
+  struct mrm_counter_pcpu           converted;   /* multicast frames converted */
+  struct mrm_counter_pcpu           copies;      /* unicast copies sent */
+};
+
+struct mrm_runconf_mcast_group {
+  struct list_head                  list;
+  struct rcu_head                   rcu;
+  struct mrm_mcast_group            conf;
+  int                               ifindex[MRM_MAX_MCAST_MEMBERS]; /* of each member's bridge port, 0 while no interface has its name */
+  struct mrm_runconf_mcast_pcpu __percpu *pcpu;
+};
+
+
+/* a resumable position in the running configuration, for walking it a chunk at a time (netlink dumps)...
+   starts out zeroed */
+struct mrm_rcdb_cursor {
+  unsigned                          headidx;
+  unsigned                          pos;
 };
 
 #endif /* #ifndef MRM_PRIVATE_H_INCLUDED */
@@ -9,6 +9,8 @@
 
 
 #include "./mrm_rcdb.h"
+#include "./mrm_stats.h"
+#include "./mrm_ipset.h"
 
 #include <linux/etherdevice.h> /* ether_addr_equal() */
 #include <linux/slab.h>
@@ -16,27 +18,100 @@
 #include <linux/jhash.h>
 #include <linux/random.h>
 #include <linux/mutex.h>
-
-
-/* filter storage... */
+#include <linux/cpumask.h>
+#include <linux/jiffies.h>
+#include <linux/netdevice.h>
+#include <linux/workqueue.h>
+#include <linux/llist.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/version.h>
+#include <linux/vmalloc.h>
+
+
+/* filter storage... the list keeps the order for walking, the hash is for finding them by name */
+#define FILTER_HASH_BITS 8
+#define FILTER_HASH_COUNT (1 << FILTER_HASH_BITS)
+static u32                               _filter_hash_salt              __read_mostly;
 static struct kmem_cache                *_filter_cache __read_mostly;
-static struct list_head                  _filter_list  __read_mostly;
-#define filter_for_each(pos) list_for_each_entry_rcu(pos, &_filter_list, list)
+#define filter_for_each(pos, t) list_for_each_entry_rcu(pos, &(t)->filter_list, list)
+#define filter_for_each_named(pos, t, headidx) hlist_for_each_entry_rcu(pos, &(t)->filter_hash[headidx], hnode)
 
 
-/* remap storage... */
-#define MRM_MAX_REMAPS 100
-#define REMAP_HASH_BITS 8
+/* remap storage... the hash is sized for the default max_remaps, about one remap per chain */
+static unsigned int max_remaps = 10000;
+module_param(max_remaps, uint, 0444);
+MODULE_PARM_DESC(max_remaps, "Most remaps the running (or a staged) configuration can hold");
+#define REMAP_HASH_BITS 13
 #define REMAP_HASH_COUNT (1 << REMAP_HASH_BITS)
 static u32                               _remap_hash_salt               __read_mostly;
-static struct hlist_head                 _remap_hash[REMAP_HASH_COUNT]  __read_mostly;
 static struct kmem_cache                *_remap_cache                   __read_mostly;
-#define remap_for_each(pos, headidx) hlist_for_each_entry_rcu(pos, &_remap_hash[headidx], hlist)
+#define remap_for_each(pos, t, headidx) hlist_for_each_entry_rcu(pos, &(t)->remap_hash[headidx], hlist)
+
+
+/* a generation of the filter set and remap table... the "critical path" only ever sees the running one,
+   a staged one gets built up off to the side and then published with a single pointer swap */
+struct mrm_rcdb_table {
+  struct rcu_head                        rcu;
+  struct list_head                       filter_list;
+  struct hlist_head                      filter_hash[FILTER_HASH_COUNT];
+  struct hlist_head                      remap_hash[REMAP_HASH_COUNT];
+  unsigned                               filter_count; /* kept up to date by whoever holds the runconf mutex... */
+  unsigned                               remap_count;  /* ...readers may see them a change behind */
+};
+static struct mrm_rcdb_table __rcu      *_running      __read_mostly;
+static struct mrm_rcdb_table            *_staged; /* NULL when nothing is being staged */
+
+
+/* replacement group storage... the groups are not part of a generation, the running and staged remaps
+   can both refer to them (and both hold references) */
+#define MRM_MAX_REPLACE_GROUPS 256
+static struct list_head                  _group_list   __read_mostly;
+static unsigned                          _group_count;
+#define group_for_each(pos) list_for_each_entry_rcu(pos, &_group_list, list)
+
+
+/* multicast group storage... */
+#define MRM_MAX_MCAST_GROUPS 32
+static struct kmem_cache                *_mcast_cache  __read_mostly;
+static struct list_head                  _mcast_list   __read_mostly;
+#define mcast_for_each(pos) list_for_each_entry_rcu(pos, &_mcast_list, list)
+
+static struct mrm_rcdb_table *
+mrm_rcdb_alloc_table( void ) {
+  struct mrm_rcdb_table *t;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,12,0)
+  t = kvzalloc(sizeof(*t), GFP_KERNEL); /* empty hash chains and zero counts... too big to count on kmalloc() */
+#else
+  t = vzalloc(sizeof(*t));
+#endif
+  if (t == NULL) {
+    return NULL; /* out of memory */
+  }
+  INIT_LIST_HEAD(&t->filter_list);
+  return t;
+}
+
+struct mrm_rcdb_table *
+mrm_rcdb_running( void ) {
+  /* the "critical path" holds the rcu read lock, anyone changing the configuration holds the runconf mutex */
+  return rcu_dereference_raw(_running);
+}
+
+struct mrm_rcdb_table *
+mrm_rcdb_staged( void ) {
+  return _staged;
+}
 
 int
 mrm_rcdb_init( void ) {
+  struct mrm_rcdb_table *t;
+
   _filter_cache = NULL;
   _remap_cache  = NULL;
+  _mcast_cache  = NULL;
+  _staged       = NULL;
 
   _filter_cache = kmem_cache_create("mrm_filter_cache", sizeof(struct mrm_runconf_filter_node), 0, SLAB_HWCACHE_ALIGN, NULL);
   if (_filter_cache == NULL) goto failed;
@@ -44,52 +119,157 @@ mrm_rcdb_init( void ) {
   _remap_cache = kmem_cache_create("mrm_rcdb_cache", sizeof(struct mrm_runconf_remap_entry), 0, SLAB_HWCACHE_ALIGN, NULL);
   if (_remap_cache == NULL) goto failed;
 
-  INIT_LIST_HEAD(&_filter_list);
+  _mcast_cache = kmem_cache_create("mrm_mcast_cache", sizeof(struct mrm_runconf_mcast_group), 0, SLAB_HWCACHE_ALIGN, NULL);
+  if (_mcast_cache == NULL) goto failed;
+
+  t = mrm_rcdb_alloc_table();
+  if (t == NULL) goto failed;
+  RCU_INIT_POINTER(_running, t);
+
+  INIT_LIST_HEAD(&_mcast_list);
+  INIT_LIST_HEAD(&_group_list);
+  _group_count = 0;
 
-  memset(_remap_hash, 0, sizeof(_remap_hash)); /* XXX is there a better way to initialize? */
   get_random_bytes(&_remap_hash_salt, sizeof(_remap_hash_salt));
+  get_random_bytes(&_filter_hash_salt, sizeof(_filter_hash_salt));
 
   return 0; /* success */
 
 failed:
   if (_filter_cache != NULL) kmem_cache_destroy(_filter_cache);
   if (_remap_cache != NULL) kmem_cache_destroy(_remap_cache);
+  if (_mcast_cache != NULL) kmem_cache_destroy(_mcast_cache);
 
 
   _filter_cache = NULL;
   _remap_cache  = NULL;
+  _mcast_cache  = NULL;
   
   return -ENOMEM;
 }
 
 static void mrm_rcdb_rcu_free_filter(struct rcu_head * /* head */);
 static void mrm_rcdb_rcu_free_remap_entry(struct rcu_head * /* head */);
+static void mrm_rcdb_rcu_free_mcast_group(struct rcu_head * /* head */);
+static void mrm_rcdb_rcu_free_group(struct rcu_head * /* head */);
 
-void
-mrm_rcdb_destroy( void ) {
-  /* note: by the time this function is called,
-           no more traffic should be flowing,
-           therfore, it should be safe to simply just
-           dealloc this directly...
-  */
+/* filter rules holding ipset references... those cant be dropped from an rcu callback
+   (older kernels take a mutex to do it), so a work item does it along with the kfree() */
+static LLIST_HEAD(_ipset_put_list);
+
+static void
+mrm_rcdb_put_ipset_rules(struct work_struct *work) {
+  struct mrm_runconf_filter_rules *fr, *fr_tmp;
+
+  llist_for_each_entry_safe(fr, fr_tmp, llist_del_all(&_ipset_put_list), put_node) {
+    mrm_ipset_put_rules(fr->rules, fr->rule_count);
+    kfree(fr);
+  }
+}
+static DECLARE_WORK(_ipset_put_work, &mrm_rcdb_put_ipset_rules);
+
+/* frees filter rules nobody can see anymore... fine from an rcu callback */
+static void
+mrm_rcdb_retire_filter_rules(struct mrm_runconf_filter_rules * const fr) {
+  if (fr == NULL) return;
+  if (fr->ipset_count == 0) {
+    kfree(fr);
+    return;
+  }
+  llist_add(&fr->put_node, &_ipset_put_list);
+  schedule_work(&_ipset_put_work);
+}
 
+static void
+mrm_rcdb_rcu_free_filter_rules(struct rcu_head *head) {
+  mrm_rcdb_retire_filter_rules(container_of(head, struct mrm_runconf_filter_rules, rcu));
+}
+
+/* frees a generation along with everything in it... no filter reference counting needed,
+   the remaps and the filters they use all go together (see mrm_rcdb_release_groups() for the groups) */
+static void
+mrm_rcdb_free_table(struct mrm_rcdb_table * const t) {
   struct mrm_runconf_remap_entry *r;
   struct mrm_runconf_filter_node *f, *f_tmp;
   struct hlist_node *hlist_tmp;
   unsigned i;
 
-
   for (i = 0; i < REMAP_HASH_COUNT; i++) {
-    hlist_for_each_entry_safe(r, hlist_tmp, &_remap_hash[i], hlist) {
-      r->filter = NULL; /* force no filter refcnt decrement */
+    hlist_for_each_entry_safe(r, hlist_tmp, &t->remap_hash[i], hlist) {
       mrm_rcdb_rcu_free_remap_entry(&r->rcu);
     }
   }
 
-  list_for_each_entry_safe(f, f_tmp, &_filter_list, list) {
+  list_for_each_entry_safe(f, f_tmp, &t->filter_list, list) {
     mrm_rcdb_rcu_free_filter(&f->rcu);
   }
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,12,0)
+  kvfree(t);
+#else
+  vfree(t);
+#endif
+}
+
+static void
+mrm_rcdb_rcu_free_table(struct rcu_head *head) {
+  mrm_rcdb_free_table(container_of(head, struct mrm_rcdb_table, rcu));
+}
+
+/* drops the filter and replacement group references of a remap entry... done as soon as the entry
+   is unlinked (rather than in its rcu callback) so the filters and groups can be deleted right away,
+   which is safe as they themselves are only ever freed after a grace period too */
+static inline void
+mrm_rcdb_release_refs(struct mrm_runconf_remap_entry * const r) {
+  unsigned i;
+  for (i = 0; i < r->class_count; ++i) {
+    atomic_dec(&r->classes[i].filter->refcnt);
+    if (r->classes[i].group != &r->classes[i].own) atomic_dec(&r->classes[i].group->refcnt);
+  }
+}
+
+/* the same for the replacement groups used by a whole generation... the filters go along with it */
+static void
+mrm_rcdb_release_groups(struct mrm_rcdb_table * const t) {
+  struct mrm_runconf_remap_entry *r;
+  unsigned headidx;
+  unsigned i;
+
+  for (headidx = 0; headidx < REMAP_HASH_COUNT; headidx++) {
+    hlist_for_each_entry(r, &t->remap_hash[headidx], hlist) {
+      for (i = 0; i < r->class_count; ++i) {
+        if (r->classes[i].group != &r->classes[i].own) atomic_dec(&r->classes[i].group->refcnt);
+      }
+    }
+  }
+}
+
+void
+mrm_rcdb_destroy( void ) {
+  /* note: by the time this function is called,
+           no more traffic should be flowing,
+           therfore, it should be safe to simply just
+           dealloc this directly...
+  */
+
+  struct mrm_runconf_mcast_group *m, *m_tmp;
+  struct mrm_runconf_replace_group *g, *g_tmp;
+
+  mrm_rcdb_free_table(rcu_dereference_protected(_running, 1));
+  RCU_INIT_POINTER(_running, NULL);
+  mrm_rcdb_stage_abort();
+
+  list_for_each_entry_safe(g, g_tmp, &_group_list, list) {
+    mrm_rcdb_rcu_free_group(&g->rcu);
+  }
+
+  list_for_each_entry_safe(m, m_tmp, &_mcast_list, list) {
+    mrm_rcdb_rcu_free_mcast_group(&m->rcu);
+  }
+
+  rcu_barrier(); /* wait for any call_rcu()s still in flight */
+  flush_work(&_ipset_put_work); /* ...and for the ipset references they handed off */
+  kmem_cache_destroy(_mcast_cache);
   kmem_cache_destroy(_remap_cache);
   kmem_cache_destroy(_filter_cache);
 }
@@ -97,28 +277,47 @@ mrm_rcdb_destroy( void ) {
 void
 mrm_rcdb_clear( void ) {
 
+  struct mrm_rcdb_table * const t = rcu_dereference_protected(_running, 1);
   struct mrm_runconf_remap_entry *r;
   struct mrm_runconf_filter_node *f, *f_tmp;
+  struct mrm_runconf_mcast_group *m, *m_tmp;
+  struct mrm_runconf_replace_group *g, *g_tmp;
   struct hlist_node *hlist_tmp;
   unsigned i;
 
+  /* everything gets unlinked right away and reclaimed by rcu callbacks...
+     so clearing costs a single grace period no matter how much is configured,
+     and nothing here blocks */
+
+  list_for_each_entry_safe(m, m_tmp, &_mcast_list, list) {
+    list_del_rcu(&m->list);
+    call_rcu(&m->rcu, &mrm_rcdb_rcu_free_mcast_group);
+  }
+
   for (i = 0; i < REMAP_HASH_COUNT; i++) {
-    hlist_for_each_entry_safe(r, hlist_tmp, &_remap_hash[i], hlist) {
-      /* remove the entry from the hash and wait for all things using the hash to finish... */
+    hlist_for_each_entry_safe(r, hlist_tmp, &t->remap_hash[i], hlist) {
       hlist_del_rcu(&r->hlist);
-      synchronize_rcu();
-
-      /* destroy it */
-      r->filter = NULL; /* force no filter refcnt decrement */
-      mrm_rcdb_rcu_free_remap_entry(&r->rcu);
+      mrm_rcdb_release_refs(r);
+      call_rcu(&r->rcu, &mrm_rcdb_rcu_free_remap_entry);
     }
   }
+  t->remap_count = 0;
+
+  list_for_each_entry_safe(g, g_tmp, &_group_list, list) {
+    if (atomic_read(&g->refcnt) > 0) continue; /* still used by a staged remap */
+    list_del_rcu(&g->list);
+    --_group_count;
+    call_rcu(&g->rcu, &mrm_rcdb_rcu_free_group);
+  }
 
-  list_for_each_entry_safe(f, f_tmp, &_filter_list, list) {
-    /* remove the entry from the linked list.... no need to wait on RCUs as nothing can be using the filter */
+  list_for_each_entry_safe(f, f_tmp, &t->filter_list, list) {
+    /* the remaps using the filter are already gone (see above)... readers may still be
+       looking at it through them though, hence the deferred free */
     list_del_rcu(&f->list);
-    mrm_rcdb_rcu_free_filter(&f->rcu);
+    hlist_del_rcu(&f->hnode);
+    call_rcu(&f->rcu, &mrm_rcdb_rcu_free_filter);
   }
+  t->filter_count = 0;
 }
 
 
@@ -126,22 +325,22 @@ mrm_rcdb_clear( void ) {
 
 unsigned
 mrm_rcdb_get_filter_count( void ) {
-  struct mrm_runconf_filter_node   *f;
-  unsigned                          result;
+  return READ_ONCE(mrm_rcdb_running()->filter_count);
+}
 
-  result = 0;
-  filter_for_each(f) {
-    ++result;
-  }
-  return result;
+static inline unsigned
+mrm_rcdb_hash_filter_name(const char * const name) {
+  /* names are not necessarily nul terminated when they use up the whole field */
+  return jhash(name, strnlen(name, MRM_FILTER_NAME_MAX), _filter_hash_salt) & (FILTER_HASH_COUNT - 1);
 }
 
 struct mrm_runconf_filter_node *
-mrm_rcdb_lookup_filter_by_name(const char * const name) {
+mrm_rcdb_lookup_filter_by_name(struct mrm_rcdb_table * const t, const char * const name) {
   struct mrm_runconf_filter_node   *f;
+  const unsigned headidx = mrm_rcdb_hash_filter_name(name);
 
-  filter_for_each(f) {
-    if (strncmp(f->conf.name, name, sizeof(f->conf.name)) == 0)
+  filter_for_each_named(f, t, headidx) {
+    if (strncmp(f->name, name, sizeof(f->name)) == 0)
       return f;
   }
 
@@ -151,7 +350,7 @@ mrm_rcdb_lookup_filter_by_name(const char * const name) {
 struct mrm_runconf_filter_node *mrm_rcdb_lookup_filter_by_index(unsigned index) {
   struct mrm_runconf_filter_node   *f;
 
-  filter_for_each(f) {
+  filter_for_each(f, mrm_rcdb_running()) {
     if (index-- == 0) break;
   }
 
@@ -159,11 +358,11 @@ struct mrm_runconf_filter_node *mrm_rcdb_lookup_filter_by_index(unsigned index)
 }
 
 struct mrm_runconf_filter_node *
-mrm_rcdb_insert_filter( const char * const name) {
+mrm_rcdb_insert_filter( struct mrm_rcdb_table * const t, const char * const name) {
   struct mrm_runconf_filter_node   *rv;
 
   /* first make sure a filter by the same name dont already exist */
-  rv = mrm_rcdb_lookup_filter_by_name(name);
+  rv = mrm_rcdb_lookup_filter_by_name(t, name);
   if (rv != NULL) return rv; /* filter by said name already exists */
 
   /* allocate a new filter */
@@ -175,38 +374,136 @@ mrm_rcdb_insert_filter( const char * const name) {
   /* initialize it */
   memset(rv, 0, sizeof(*rv));
   INIT_LIST_HEAD(&rv->list);
-  strncpy(rv->conf.name, name, sizeof(rv->conf.name));
+  strncpy(rv->name, name, sizeof(rv->name));
 
-  /* add it to the list */
-  list_add_rcu(&rv->list, &_filter_list);
+  /* add it to the list and the name hash */
+  list_add_rcu(&rv->list, &t->filter_list);
+  hlist_add_head_rcu(&rv->hnode, &t->filter_hash[mrm_rcdb_hash_filter_name(rv->name)]);
+  ++t->filter_count;
 
   return rv;
 }
 
+/* frees filter rules that never got set for any filter */
+void
+mrm_rcdb_free_filter_rules(struct mrm_runconf_filter_rules * const fr) {
+  if (fr->ipset_count > 0) mrm_ipset_put_rules(fr->rules, fr->rule_count);
+  kfree(fr);
+}
+
 static void
 mrm_rcdb_rcu_free_filter(struct rcu_head *head) {
   struct mrm_runconf_filter_node *f;
 
   f = container_of(head, struct mrm_runconf_filter_node, rcu);
+  mrm_rcdb_retire_filter_rules(rcu_dereference_raw(f->rules)); /* nobody else can see it anymore */
   kmem_cache_free(_filter_cache, f);
 }
 
+/* the rules of a filter along with their acceleration tables, in a single allocation sized to fit...
+   returns NULL if out of memory */
+struct mrm_runconf_filter_rules *
+mrm_rcdb_alloc_filter_rules(const struct mrm_filter_rule * const rules, const unsigned rule_count) {
+  struct mrm_runconf_filter_rules *fr;
+  size_t refs_offset;
+
+  refs_offset = ALIGN(offsetof(struct mrm_runconf_filter_rules, rules) + (rule_count * sizeof(fr->rules[0])), sizeof(void *));
+  fr = kmalloc(refs_offset + (mrm_acceleration_tables_size(rules, rule_count) * sizeof(void *)), GFP_KERNEL);
+  if (fr == NULL) {
+    return NULL; /* out of memory */
+  }
+
+  fr->ipset_count = 0; /* see mrm_ipset_get_rules() */
+  fr->rule_count  = rule_count;
+  memcpy(fr->rules, rules, rule_count * sizeof(fr->rules[0]));
+  mrm_generate_acceleration_tables(&fr->accelerator, fr->rules, rule_count, (const struct mrm_filter_rule **)((char *)fr + refs_offset));
+  return fr;
+}
+
+/* swaps in new rules for a filter (taking ownership of them) and rebuilds the classifiers of the
+   remaps using it... on failure the filter and its remaps are left exactly as they were */
 int
-mrm_rcdb_delete_filter( struct mrm_runconf_filter_node * const filter ) {
+mrm_rcdb_set_filter_rules(struct mrm_rcdb_table * const t, struct mrm_runconf_filter_node * const filter, struct mrm_runconf_filter_rules * const rules) {
+  struct mrm_runconf_filter_rules *old_rules;
+  int rv;
+
+  old_rules = rcu_dereference_protected(filter->rules, 1);
+  rcu_assign_pointer(filter->rules, rules);
+
+  rv = mrm_rcdb_rebuild_classifiers(t, filter);
+  if (rv != 0) {
+    /* the remaps still reference the old rules... */
+    rcu_assign_pointer(filter->rules, old_rules);
+    call_rcu(&rules->rcu, &mrm_rcdb_rcu_free_filter_rules); /* the show output may have had a look */
+    return rv;
+  }
+
+  if (old_rules != NULL) call_rcu(&old_rules->rcu, &mrm_rcdb_rcu_free_filter_rules); /* the old classifiers go after the same grace period */
+  return 0; /* success */
+}
 
-  if (filter->refcnt > 0) {
+int
+mrm_rcdb_delete_filter( struct mrm_rcdb_table * const t, struct mrm_runconf_filter_node * const filter ) {
+
+  if (atomic_read(&filter->refcnt) > 0) {
     return -EADDRINUSE; 
   }
 
   list_del_rcu(&filter->list);
+  hlist_del_rcu(&filter->hnode);
+  --t->filter_count;
   call_rcu(&filter->rcu, &mrm_rcdb_rcu_free_filter);
 
   return 0; /* success */
 }
 
 
+/* fn gets called for each filter from the cursor on... the cursor moves past
+   every filter fn returns 0 for, and the walk stops at the first one it does not */
+int
+mrm_rcdb_walk_filters(
+  struct mrm_rcdb_cursor * const cursor,
+  int (*fn)(struct mrm_runconf_filter_node * const, void * const),
+  void * const ctx
+) {
+  struct mrm_runconf_filter_node *f;
+  unsigned skip;
+  int rv;
+
+  skip = cursor->pos;
+  filter_for_each(f, mrm_rcdb_running()) {
+    if (skip > 0) {
+      --skip;
+      continue;
+    }
+    rv = fn(f, ctx);
+    if (rv != 0) return rv;
+    ++cursor->pos;
+  }
+  return 0; /* walked them all */
+}
 
 
+/* for walking a generation one filter at a time (under the rcu read lock)...
+   the cursor keeps track of the position so the walk can be picked up again later */
+struct mrm_runconf_filter_node *
+mrm_rcdb_filter_at(struct mrm_rcdb_table * const t, struct mrm_rcdb_cursor * const cursor) {
+  struct mrm_runconf_filter_node *f;
+  unsigned skip;
+
+  skip = cursor->pos;
+  filter_for_each(f, t) {
+    if (skip-- == 0) return f;
+  }
+  return NULL; /* no more */
+}
+
+struct mrm_runconf_filter_node *
+mrm_rcdb_next_filter(struct mrm_rcdb_table * const t, struct mrm_runconf_filter_node * const f, struct mrm_rcdb_cursor * const cursor) {
+  ++cursor->pos;
+  return list_next_or_null_rcu(&t->filter_list, &f->list, struct mrm_runconf_filter_node, list);
+}
+
 
 /* remap entry functions... */
 
@@ -221,42 +518,107 @@ mrm_rcsb_hash_macaddr(const unsigned char * const macaddr) {
 
 unsigned
 mrm_rcdb_get_remap_count( void ) {
+  return READ_ONCE(mrm_rcdb_running()->remap_count);
+}
+
+static struct mrm_runconf_remap_entry *
+mrm_rcdb_lookup_remap_entry_in(struct mrm_rcdb_table * const t, const unsigned char * const macaddr) {
   struct mrm_runconf_remap_entry *r;
-  unsigned headidx;
-  unsigned result;
+  const int headidx = mrm_rcsb_hash_macaddr(macaddr);
 
-  /* theres gotta be a better way of doing this */
+  remap_for_each(r, t, headidx) {
+    if (ether_addr_equal(r->match_macaddr, macaddr))
+      return r; /* success */
+  }
+
+  return NULL; /* lookup failed */
+}
+
+struct mrm_runconf_remap_entry *
+mrm_rcdb_lookup_remap_entry_by_macaddr(const unsigned char * const macaddr) {
+  return mrm_rcdb_lookup_remap_entry_in(mrm_rcdb_running(), macaddr);
+}
+
+void
+mrm_rcdb_foreach_remap_entry(void (*fn)(struct mrm_runconf_remap_entry * const, void * const), void * const ctx) {
+  struct mrm_rcdb_table * const t = mrm_rcdb_running();
+  struct mrm_runconf_remap_entry *r;
+  unsigned headidx;
 
-  result = 0;
   for (headidx = 0; headidx < REMAP_HASH_COUNT; headidx++) {
-    remap_for_each(r, headidx) {
-      ++result;
+    remap_for_each(r, t, headidx) {
+      fn(r, ctx);
     }
   }
-  return result;
 }
 
+/* same as mrm_rcdb_walk_filters()... only ever walks one hash chain per call to find its place again */
+int
+mrm_rcdb_walk_remaps(
+  struct mrm_rcdb_cursor * const cursor,
+  int (*fn)(struct mrm_runconf_remap_entry * const, void * const),
+  void * const ctx
+) {
+  struct mrm_rcdb_table * const t = mrm_rcdb_running();
+  struct mrm_runconf_remap_entry *r;
+  unsigned skip;
+  int rv;
+
+  for (; cursor->headidx < REMAP_HASH_COUNT; cursor->headidx++, cursor->pos = 0) {
+    skip = cursor->pos;
+    remap_for_each(r, t, cursor->headidx) {
+      if (skip > 0) {
+        --skip;
+        continue;
+      }
+      rv = fn(r, ctx);
+      if (rv != 0) return rv;
+      ++cursor->pos;
+    }
+  }
+  return 0; /* walked them all */
+}
+
+/* same as mrm_rcdb_filter_at() and mrm_rcdb_next_filter()... */
 struct mrm_runconf_remap_entry *
-mrm_rcdb_lookup_remap_entry_by_macaddr(const unsigned char * const macaddr) {
+mrm_rcdb_remap_entry_at(struct mrm_rcdb_table * const t, struct mrm_rcdb_cursor * const cursor) {
   struct mrm_runconf_remap_entry *r;
-  const int headidx = mrm_rcsb_hash_macaddr(macaddr);
+  unsigned skip;
 
-  remap_for_each(r, headidx) {
-    if (ether_addr_equal(r->match_macaddr, macaddr))
-      return r; /* success */
+  for (; cursor->headidx < REMAP_HASH_COUNT; cursor->headidx++, cursor->pos = 0) {
+    skip = cursor->pos;
+    remap_for_each(r, t, cursor->headidx) {
+      if (skip-- == 0) return r;
+    }
   }
+  return NULL; /* no more */
+}
 
-  return NULL; /* lookup failed */
+struct mrm_runconf_remap_entry *
+mrm_rcdb_next_remap_entry(struct mrm_rcdb_table * const t, struct mrm_runconf_remap_entry * const r, struct mrm_rcdb_cursor * const cursor) {
+  struct hlist_node *next;
+
+  next = rcu_dereference_raw(hlist_next_rcu(&r->hlist));
+  if (next != NULL) {
+    ++cursor->pos;
+    return hlist_entry(next, struct mrm_runconf_remap_entry, hlist);
+  }
+
+  /* end of the chain... on to the next non-empty one */
+  ++cursor->headidx;
+  cursor->pos = 0;
+  return mrm_rcdb_remap_entry_at(t, cursor);
 }
 
 struct mrm_runconf_remap_entry *mrm_rcdb_lookup_remap_entry_by_index(unsigned index) {
   struct mrm_runconf_remap_entry *r;
+  struct mrm_rcdb_table * const t = mrm_rcdb_running();
   unsigned headidx;
 
   /* theres gotta be a better way of doing this */
 
   for (headidx = 0; headidx < REMAP_HASH_COUNT; headidx++) {
-    remap_for_each(r, headidx) {
+    remap_for_each(r, t, headidx) {
       if (index-- == 0)
         return r;
     }
@@ -264,47 +626,291 @@ struct mrm_runconf_remap_entry *mrm_rcdb_lookup_remap_entry_by_index(unsigned in
   return NULL; /*lookup failed */
 }
 
+/* frees a set of replacements, letting go of their interfaces... only once nobody can be looking at it */
+static void
+mrm_rcdb_free_replace_set(struct mrm_runconf_replace_set * const s) {
+  unsigned i;
+
+  if (s == NULL) return;
+  for (i = 0; i < s->replace_count; ++i) {
+    if (s->replace[i].dev) dev_put(s->replace[i].dev); /* this feels super dirty being here... */
+  }
+  free_percpu(s->replace_pcpu);
+  kfree(s->bucket);
+  kfree(rcu_dereference_raw(s->live));
+  kfree(s);
+}
+
+static void
+mrm_rcdb_rcu_free_replace_set(struct rcu_head *head) {
+  mrm_rcdb_free_replace_set(container_of(head, struct mrm_runconf_replace_set, rcu));
+}
+
+static void
+mrm_rcdb_free_classifier(struct mrm_runconf_classifier * const rc) {
+  if (rc == NULL) return;
+  free_percpu(rc->ref_pcpu);
+  kfree(rc);
+}
+
+static void
+mrm_rcdb_rcu_free_classifier(struct rcu_head *head) {
+  mrm_rcdb_free_classifier(container_of(head, struct mrm_runconf_classifier, rcu));
+}
+
+void
+mrm_rcdb_free_remap_entry(struct mrm_runconf_remap_entry * const r) {
+  struct mrm_runconf_remap_class *c;
+  unsigned i;
+
+  for (i = 0; i < r->class_count; ++i) {
+    c = &r->classes[i];
+    if (c->group != &c->own) continue; /* named groups live on their own */
+    mrm_rcdb_free_replace_set(rcu_dereference_raw(c->own.set));
+  }
+  mrm_rcdb_free_classifier(rcu_dereference_raw(r->classifier)); /* nobody else can see it anymore */
+  kfree(r->classes);
+  kmem_cache_free(_remap_cache, r);
+}
+
 static void
 mrm_rcdb_rcu_free_remap_entry(struct rcu_head *head) {
-  struct mrm_runconf_remap_entry *r;
+  mrm_rcdb_free_remap_entry(container_of(head, struct mrm_runconf_remap_entry, rcu));
+}
+
+
+static unsigned
+mrm_rcdb_gcd(unsigned a, unsigned b) {
+  unsigned t;
+  while (b != 0) {
+    t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+/* scratch space for laying out the slots, a replacement at a time */
+struct mrm_rcdb_slot_share {
+  unsigned                          weight;
+  int                               current;
+};
+
+static int
+mrm_rcdb_build_replace_slots(const struct mrm_runconf_replace_set * const r, struct mrm_runconf_replace_live * const live) {
+  /* lay the live replacements out over the slot table in proportion to their weights,
+     interleaved ("smooth" weighted round-robin) so a heavy replacement does not
+     get long back-to-back runs...
+
+     this runs once per update (or link change) so the critical path is a single table lookup */
+  struct mrm_rcdb_slot_share *share;
+  unsigned total, divisor, budget, live_count;
+  unsigned i, slot, best;
+
+  share = kcalloc(r->replace_count, sizeof(*share), GFP_ATOMIC); /* too big for the kernel stack with a large group */
+  if (share == NULL) {
+    return -ENOMEM;
+  }
+
+  /* reduce the weights as far as they go... 2:4 and 1:2 are the same split */
+  divisor = 0;
+  live_count = 0;
+  for (i = 0; i < r->replace_count; ++i) {
+    if (!test_bit(i, live->mask)) continue; /* dead replacements get no slots */
+    divisor = mrm_rcdb_gcd(r->replace[i].weight, divisor);
+    ++live_count;
+  }
+  total = 0;
+  for (i = 0; i < r->replace_count; ++i) {
+    if (!test_bit(i, live->mask)) continue;
+    share[i].weight = r->replace[i].weight / divisor;
+    total += share[i].weight;
+  }
+
+  /* still too many slots? scale down, but every live replacement keeps at least one
+     (there are never more live replacements than slots) */
+  if (total > MRM_MAX_REPLACE_SLOTS) {
+    budget = MRM_MAX_REPLACE_SLOTS - live_count;
+    for (i = 0, slot = 0; i < r->replace_count; ++i) {
+      if (share[i].weight == 0) continue;
+      share[i].weight = 1 + ((share[i].weight * budget) / total); /* cant overflow, weights are capped */
+      slot += share[i].weight;
+    }
+    total = slot;
+  }
+
+  for (slot = 0; slot < total; ++slot) {
+    best = 0;
+    for (i = 0; i < r->replace_count; ++i) {
+      share[i].current += share[i].weight;
+      if (share[i].current > share[best].current) best = i;
+    }
+    share[best].current -= total;
+    live->slot[slot] = best;
+  }
+  live->slot_count = total;
+
+  kfree(share);
+  return 0; /* success */
+}
+
+static inline int
+mrm_rcdb_replacement_is_live(const struct mrm_runconf_replace_set * const r, const unsigned i) {
+  if (r->replace[i].ifname[0] == '\0') return 1; /* no interface to watch... just a MAC address swap */
+  if (r->replace[i].dev == NULL) return 0; /* interface is gone */
+  return netif_running(r->replace[i].dev) && netif_carrier_ok(r->replace[i].dev);
+}
+
+static struct mrm_runconf_replace_live *
+mrm_rcdb_build_replace_live(const struct mrm_runconf_replace_set * const r) {
+  struct mrm_runconf_replace_live *live;
   unsigned i;
 
-  r = container_of(head, struct mrm_runconf_remap_entry, rcu);
+  live = kmalloc(sizeof(*live), GFP_ATOMIC);
+  if (live == NULL) {
+    return NULL; /* out of memory... */
+  }
+
+  bitmap_zero(live->mask, MRM_REPLACE_GROUP_LIMIT);
   for (i = 0; i < r->replace_count; ++i) {
-    if (r->replace[i].dev) dev_put(r->replace[i].dev); /* this feels super dirty being here... */
+    if (mrm_rcdb_replacement_is_live(r, i)) __set_bit(i, live->mask);
   }
-  if (r->filter != NULL) {
-    r->filter->refcnt--;
+  if (mrm_rcdb_build_replace_slots(r, live) != 0) {
+    kfree(live);
+    return NULL; /* out of memory... */
   }
-  kmem_cache_free(_remap_cache, r);
+  return live;
 }
 
+/* the rule match counters start over with every classifier built... */
+static struct mrm_runconf_classifier *
+mrm_rcdb_build_classifier(const struct mrm_runconf_remap_entry * const r) {
+  struct mrm_runconf_classifier *rc;
+  const struct mrm_filter_config_accelerator *acc[MRM_MAX_CLASSES];
+  unsigned ref_count;
+  unsigned cpu, i;
+
+  for (i = 0; i < r->class_count; ++i) {
+    acc[i] = &rcu_dereference_protected(r->classes[i].filter->rules, 1)->accelerator;
+  }
+  ref_count = mrm_classifier_size(acc, r->class_count);
+
+  rc = kmalloc(sizeof(*rc) + (ref_count * sizeof(rc->refs[0])), GFP_KERNEL);
+  if (rc == NULL) {
+    return NULL; /* out of memory... */
+  }
+  rc->ref_count = ref_count;
+  rc->ref_pcpu  = __alloc_percpu(max(ref_count, 1U) * sizeof(struct mrm_counter_pcpu), __alignof__(struct mrm_counter_pcpu));
+  if (rc->ref_pcpu == NULL) {
+    kfree(rc);
+    return NULL; /* out of memory... */
+  }
+  for_each_possible_cpu(cpu) {
+    for (i = 0; i < ref_count; ++i) {
+      mrm_counter_init(&per_cpu_ptr(rc->ref_pcpu, cpu)[i]);
+    }
+  }
+  mrm_generate_classifier(&rc->classifier, acc, r->class_count, rc->refs);
+  return rc;
+}
+
+/* a cpu takes a sixteenth of the burst from a replacement's bucket at a time, but no more than 64k...
+   that much may sit unused in the cache of a cpu the replacement's traffic moved away from */
+#define TOKEN_QUANTUM_SHARES 16
+#define TOKEN_QUANTUM_MAX    65536U
+
+/* a set of replacements sized to fit... it takes over the device references (replace_dev may be NULL),
+   but only on success */
+static struct mrm_runconf_replace_set *
+mrm_rcdb_build_replace_set(
+  const struct mrm_replacement * const  conf,
+  const unsigned                        replace_count,
+  struct net_device ** const            replace_dev
+) {
+  struct mrm_runconf_replace_set *s;
+  unsigned i;
+  unsigned cpu;
+
+  s = kzalloc(sizeof(*s) + (replace_count * sizeof(s->replace[0])), GFP_KERNEL);
+  if (s == NULL) {
+    return NULL; /* out of memory... */
+  }
+  s->replace_pcpu = __alloc_percpu(replace_count * sizeof(struct mrm_runconf_replace_pcpu), __alignof__(struct mrm_runconf_replace_pcpu));
+  if (s->replace_pcpu == NULL) {
+    kfree(s);
+    return NULL; /* out of memory... */
+  }
+  s->bucket = kcalloc(replace_count, sizeof(*s->bucket), GFP_KERNEL);
+  if (s->bucket == NULL) {
+    free_percpu(s->replace_pcpu);
+    kfree(s);
+    return NULL; /* out of memory... */
+  }
+  for_each_possible_cpu(cpu) {
+    for (i = 0; i < replace_count; ++i) {
+      mrm_counter_init(&per_cpu_ptr(s->replace_pcpu, cpu)[i].tx);
+      mrm_counter_init(&per_cpu_ptr(s->replace_pcpu, cpu)[i].shadow);
+      mrm_counter_init(&per_cpu_ptr(s->replace_pcpu, cpu)[i].spilled);
+      mrm_counter_init(&per_cpu_ptr(s->replace_pcpu, cpu)[i].dup);
+    }
+  }
+  s->replace_count = replace_count;
+  for (i = 0; i < replace_count; ++i) {
+    memcpy(s->replace[i].macaddr, conf[i].macaddr, sizeof(s->replace[i].macaddr));
+    strncpy(s->replace[i].ifname, conf[i].ifname, sizeof(s->replace[i].ifname));
+    if (replace_dev != NULL) s->replace[i].dev = replace_dev[i];
+    s->replace[i].weight = (conf[i].weight > 0) ? conf[i].weight : 1; /* default to an even split */
+
+    /* one bucket for all the cpus (whichever cpu a flow lands on can use all of the rate)...
+       each cpu takes tokens from it a quantum at a time so the critical path rarely touches it */
+    if (conf[i].rate > 0) {
+      s->replace[i].rate          = conf[i].rate;
+      s->replace[i].burst         = (conf[i].burst > 0) ? conf[i].burst : max(conf[i].rate / 10, 1U);
+      s->replace[i].token_quantum = clamp(s->replace[i].burst / TOKEN_QUANTUM_SHARES, 1U, TOKEN_QUANTUM_MAX);
+      atomic_long_set(&s->bucket[i].tokens, s->replace[i].burst);
+      atomic_long_set(&s->bucket[i].stamp, jiffies);
+    }
+  }
+  RCU_INIT_POINTER(s->live, mrm_rcdb_build_replace_live(s));
+  if (rcu_access_pointer(s->live) == NULL) {
+    free_percpu(s->replace_pcpu);
+    kfree(s->bucket);
+    kfree(s);
+    return NULL; /* out of memory... */
+  }
+  return s;
+}
 
 struct mrm_runconf_remap_entry *
 mrm_rcdb_update_remap_entry(
-  const unsigned char * const             match_macaddr,
-  struct mrm_runconf_filter_node * const  filter,
-  const unsigned                          replace_count,
-  const unsigned char ** const            replace_macaddr,
-  struct net_device ** const              replace_dev
+  struct mrm_rcdb_table * const             t,
+  const struct mrm_remap_entry * const      conf,
+  struct mrm_runconf_filter_node ** const   filters,
+  struct mrm_runconf_replace_group ** const groups,
+  struct net_device * (* const replace_dev)[MRM_MAX_REPLACE]
 ) {
   struct mrm_runconf_remap_entry *new_remap, *existing_remap;
-  unsigned i;
+  struct mrm_runconf_remap_class *c;
+  struct mrm_runconf_classifier *classifier;
+  struct mrm_runconf_replace_set *own;
+  unsigned i, j;
 
   /* mandatory parameter sanity checks... */
-  if (match_macaddr == NULL) return NULL;
-  if (filter == NULL) return NULL;
-  if (replace_macaddr == NULL) return NULL;
-  if ((replace_count < 1) || (replace_count > MRM_MAX_REPLACE)) return NULL; /* yeah i know... being super defensive */
-  for (i = 0; i < replace_count; ++i) {
-    if (replace_macaddr[i] == NULL) return NULL;
+  if (conf == NULL) return NULL;
+  if (filters == NULL) return NULL;
+  if (groups == NULL) return NULL;
+  if ((conf->class_count < 1) || (conf->class_count > MRM_MAX_CLASSES)) return NULL;
+  for (i = 0; i < conf->class_count; ++i) {
+    if (filters[i] == NULL) return NULL;
+    if (groups[i] != NULL) continue; /* the replacements come from a named group */
+    if ((conf->classes[i].replace_count < 1) || (conf->classes[i].replace_count > MRM_MAX_REPLACE)) return NULL; /* yeah i know... being super defensive */
   }
 
   /* find if we have an existing remap entry... */
-  existing_remap = mrm_rcdb_lookup_remap_entry_by_macaddr(match_macaddr);
+  existing_remap = mrm_rcdb_lookup_remap_entry_in(t, conf->match_macaddr);
 
   /* is our remap table full ? (if were inserting a new entry that is...) */
-  if ((existing_remap == NULL) && (mrm_rcdb_get_remap_count() == MRM_MAX_REMAPS)) {
+  if ((existing_remap == NULL) && (t->remap_count >= max_remaps)) {
     return NULL; /* were full... cant insert any more remaps */
   }
 
@@ -316,54 +922,573 @@ mrm_rcdb_update_remap_entry(
 
   /* initialize and populate the new remap entry struct instance... */
   memset(new_remap, 0, sizeof(*new_remap));
-  memcpy(new_remap->match_macaddr, match_macaddr, sizeof(new_remap->match_macaddr));
-  new_remap->filter = filter;
-  new_remap->replace_count = replace_count;
-  for (i = 0; i < replace_count; ++i) {
-    memcpy(new_remap->replace[i].macaddr, replace_macaddr[i], sizeof(new_remap->replace[i].macaddr));
-    if (replace_dev != NULL) new_remap->replace[i].dev = replace_dev[i];
+  new_remap->classes = kcalloc(conf->class_count, sizeof(*new_remap->classes), GFP_ATOMIC);
+  if (new_remap->classes == NULL) {
+    kmem_cache_free(_remap_cache, new_remap);
+    return NULL; /* out of memory... */
   }
+  memcpy(new_remap->match_macaddr, conf->match_macaddr, sizeof(new_remap->match_macaddr));
+  new_remap->shadow = (conf->shadow != 0);
+  new_remap->idle_timeout = conf->idle_timeout;
+  new_remap->last_hit     = jiffies; /* (re)setting a remap counts as a hit */
+  for (i = 0; i < conf->class_count; ++i) {
+    c = &new_remap->classes[i];
+    if (groups[i] != NULL) {
+      c->group = groups[i];
+    }
+    else {
+      own = mrm_rcdb_build_replace_set(conf->classes[i].replace, conf->classes[i].replace_count, (replace_dev != NULL) ? replace_dev[i] : NULL);
+      if (own == NULL) goto fail_nomem;
+      RCU_INIT_POINTER(c->own.set, own);
+      c->group = &c->own;
+    }
+    new_remap->class_count = i + 1; /* so a failure from here on cleans up this class too */
+    c->filter = filters[i];
+    c->policy = conf->classes[i].policy;
+    c->spill  = conf->classes[i].spill;
+    if (conf->classes[i].elephant_bytes > 0) {
+      c->elephant_bytes          = conf->classes[i].elephant_bytes;
+      c->elephant_window         = (conf->classes[i].elephant_window > 0) ? conf->classes[i].elephant_window : 1000;
+      c->elephant_window_jiffies = msecs_to_jiffies(c->elephant_window);
+      ++new_remap->elephant_classes;
+    }
+  }
+
+  classifier = mrm_rcdb_build_classifier(new_remap);
+  if (classifier == NULL) goto fail_nomem;
+  RCU_INIT_POINTER(new_remap->classifier, classifier);
 
-  /* update the filter reference count... */
-  new_remap->filter->refcnt++;
+  /* update the filter (and group) reference counts... */
+  for (i = 0; i < new_remap->class_count; ++i) {
+    atomic_inc(&new_remap->classes[i].filter->refcnt);
+    if (groups[i] != NULL) atomic_inc(&groups[i]->refcnt);
+  }
 
   /* insert it into the "live" collection... */
-  hlist_add_head_rcu(&new_remap->hlist, &_remap_hash[mrm_rcsb_hash_macaddr(new_remap->match_macaddr)]);
+  hlist_add_head_rcu(&new_remap->hlist, &t->remap_hash[mrm_rcsb_hash_macaddr(new_remap->match_macaddr)]);
 
-  /* pull the existing remap entry out of the "live" collection */
+  /* pull the existing remap entry out of the "live" collection...
+     it gets cleaned up once the "critical path" can no longer be using it */
   if (existing_remap != NULL) {
     hlist_del_rcu(&existing_remap->hlist);
+    mrm_rcdb_release_refs(existing_remap);
+    call_rcu(&existing_remap->rcu, &mrm_rcdb_rcu_free_remap_entry);
+  }
+  else {
+    ++t->remap_count;
   }
 
-  /* wait for the live flow to be updated */
-  synchronize_rcu();
+  return new_remap; /* all is good */
 
-  /* at this point all traffic should be diverted using only the new remap object...
-     cleanup the old instance... */
-  if (existing_remap != NULL) {
-    mrm_rcdb_rcu_free_remap_entry(&existing_remap->rcu);
+fail_nomem:
+  /* the caller still owns the device references on failure... */
+  for (i = 0; i < new_remap->class_count; ++i) {
+    c = &new_remap->classes[i];
+    if (c->group != &c->own) continue;
+    own = rcu_dereference_protected(c->own.set, 1);
+    for (j = 0; j < own->replace_count; ++j) {
+      own->replace[j].dev = NULL;
+    }
   }
+  mrm_rcdb_rcu_free_remap_entry(&new_remap->rcu);
+  return NULL; /* out of memory... */
+}
 
-  return new_remap; /* all is good */
+int
+mrm_rcdb_rebuild_classifiers(struct mrm_rcdb_table * const t, const struct mrm_runconf_filter_node * const filter) {
+  struct mrm_runconf_remap_entry *r;
+  struct mrm_runconf_classifier *old_classifier;
+  unsigned headidx;
+  unsigned i;
+  int rv;
+
+  /* build all the new classifiers first... only once every one of them fits do they get swapped in,
+     so a failure never leaves some of the remaps referencing rules about to go away */
+  rv = 0;
+  for (headidx = 0; (headidx < REMAP_HASH_COUNT) && (rv == 0); headidx++) {
+    hlist_for_each_entry(r, &t->remap_hash[headidx], hlist) {
+      for (i = 0; i < r->class_count; ++i) {
+        if (r->classes[i].filter == filter) break;
+      }
+      if (i >= r->class_count) continue; /* filter not used by this remap */
+
+      r->next_classifier = mrm_rcdb_build_classifier(r);
+      if (r->next_classifier == NULL) {
+        rv = -ENOMEM;
+        break;
+      }
+    }
+  }
+
+  for (headidx = 0; headidx < REMAP_HASH_COUNT; headidx++) {
+    hlist_for_each_entry(r, &t->remap_hash[headidx], hlist) {
+      if (r->next_classifier == NULL) continue;
+
+      if (rv != 0) {
+        mrm_rcdb_free_classifier(r->next_classifier); /* never seen by the "critical path" */
+      }
+      else {
+        old_classifier = rcu_dereference_protected(r->classifier, 1);
+        rcu_assign_pointer(r->classifier, r->next_classifier);
+        call_rcu(&old_classifier->rcu, &mrm_rcdb_rcu_free_classifier);
+      }
+      r->next_classifier = NULL;
+    }
+  }
+  return rv;
+}
+
+static void
+mrm_rcdb_refresh_replace_live(struct mrm_runconf_replace_set * const r) {
+  struct mrm_runconf_replace_live *live, *old_live;
+
+  live = mrm_rcdb_build_replace_live(r);
+  if (live == NULL) {
+    printk(KERN_WARNING "MRM Out of memory tracking replacement link state!\n");
+    return; /* carry on with the stale view... */
+  }
+  old_live = rcu_dereference_protected(r->live, 1);
+  rcu_assign_pointer(r->live, live);
+  kfree_rcu(old_live, rcu);
+}
+
+static unsigned
+mrm_rcdb_netdev_event_set(struct mrm_runconf_replace_set * const s, struct net_device * const dev, const unsigned long event) {
+  unsigned j;
+  unsigned released;
+  int changed;
+
+  released = 0;
+  changed = 0;
+  for (j = 0; j < s->replace_count; ++j) {
+    if (s->replace[j].dev == dev) {
+      changed = 1;
+      if ((event != NETDEV_UNREGISTER) &&
+          ((event != NETDEV_CHANGENAME) || (strncmp(s->replace[j].ifname, dev->name, sizeof(s->replace[j].ifname)) == 0))) {
+        continue; /* just a link state change */
+      }
+
+      /* gone, or renamed to something we were not told about... let go of the interface,
+         the reference is dropped once nobody can be looking at it */
+      WRITE_ONCE(s->replace[j].dev, NULL);
+      ++released;
+    }
+
+    if ((s->replace[j].dev == NULL) && ((event == NETDEV_REGISTER) || (event == NETDEV_CHANGENAME))) {
+      /* an interface (re)appeared under a name we were told about... pick it (back) up */
+      if (strncmp(s->replace[j].ifname, dev->name, sizeof(s->replace[j].ifname)) != 0) continue;
+      dev_hold(dev);
+      WRITE_ONCE(s->replace[j].dev, dev);
+      changed = 1;
+    }
+  }
+  if (changed) mrm_rcdb_refresh_replace_live(s);
+  return released; /* how many references to dev the caller has to drop */
+}
+
+static unsigned
+mrm_rcdb_netdev_event_table(struct mrm_rcdb_table * const t, struct net_device * const dev, const unsigned long event) {
+  struct mrm_runconf_remap_entry *r;
+  struct mrm_runconf_remap_class *c;
+  unsigned headidx;
+  unsigned i;
+  unsigned released;
+
+  /* only the replacements the classes carry themselves... the named groups get looked at once */
+  released = 0;
+  for (headidx = 0; headidx < REMAP_HASH_COUNT; headidx++) {
+    hlist_for_each_entry(r, &t->remap_hash[headidx], hlist) {
+      for (i = 0; i < r->class_count; ++i) {
+        c = &r->classes[i];
+        if (c->group != &c->own) continue;
+        released += mrm_rcdb_netdev_event_set(rcu_dereference_protected(c->own.set, 1), dev, event);
+      }
+    }
+  }
+  return released;
+}
+
+static void
+mrm_rcdb_netdev_event_mcast(struct mrm_runconf_mcast_group * const m, struct net_device * const dev, const unsigned long event) {
+  unsigned i;
+
+  for (i = 0; i < m->conf.member_count; ++i) {
+    if (m->ifindex[i] == dev->ifindex) {
+      /* the port went away, or got renamed to something we were not told about... */
+      if ((event == NETDEV_UNREGISTER) ||
+          ((event == NETDEV_CHANGENAME) && (strncmp(m->conf.members[i].ifname, dev->name, sizeof(m->conf.members[i].ifname)) != 0))) {
+        WRITE_ONCE(m->ifindex[i], 0);
+      }
+      continue;
+    }
+    if ((event == NETDEV_REGISTER) || (event == NETDEV_CHANGENAME)) {
+      /* an interface (re)appeared under the name of the port... pick it up */
+      if (strncmp(m->conf.members[i].ifname, dev->name, sizeof(m->conf.members[i].ifname)) != 0) continue;
+      WRITE_ONCE(m->ifindex[i], dev->ifindex);
+    }
+  }
 }
 
 void
-mrm_rcdb_delete_remap_entry(struct mrm_runconf_remap_entry * const remap_entry) {
+mrm_rcdb_netdev_event(struct net_device * const dev, const unsigned long event) {
+  struct mrm_runconf_replace_group *g;
+  struct mrm_runconf_mcast_group *m;
+  unsigned released;
+
+  /* staged remaps hold on to their interfaces too... */
+  released = mrm_rcdb_netdev_event_table(rcu_dereference_protected(_running, 1), dev, event);
+  if (_staged != NULL) {
+    released += mrm_rcdb_netdev_event_table(_staged, dev, event);
+  }
+  list_for_each_entry(g, &_group_list, list) {
+    released += mrm_rcdb_netdev_event_set(rcu_dereference_protected(g->set, 1), dev, event);
+  }
+  list_for_each_entry(m, &_mcast_list, list) {
+    mrm_rcdb_netdev_event_mcast(m, dev, event); /* no references held, just the interface index */
+  }
 
-  /* sanity check... */
-  if (remap_entry == NULL) return;
+  if (released > 0) {
+    synchronize_rcu(); /* the critical path may still have the pointer in hand */
+    while (released-- > 0) {
+      dev_put(dev);
+    }
+  }
+}
 
-  /* pull the existing remap entry out of the "live" collection... */
+/* pulls a remap entry out of the "live" collection... */
+static void
+mrm_rcdb_unlink_remap_entry(struct mrm_rcdb_table * const t, struct mrm_runconf_remap_entry * const remap_entry) {
   hlist_del_rcu(&remap_entry->hlist);
+  --t->remap_count;
+  mrm_rcdb_release_refs(remap_entry);
+}
+
+void
+mrm_rcdb_delete_remap_entry(struct mrm_rcdb_table * const t, struct mrm_runconf_remap_entry * const remap_entry) {
 
-  /* wait for the live flow to be updated */
-  synchronize_rcu();
+  /* sanity check... */
+  if (remap_entry == NULL) return;
 
-  /* cleanup... */
-  mrm_rcdb_rcu_free_remap_entry(&remap_entry->rcu);
+  mrm_rcdb_unlink_remap_entry(t, remap_entry);
 
-  /* note: this could be cleaned up in a non blocking fashing by doing a:
+  /* cleanup once the "critical path" is done with it... */
   call_rcu(&remap_entry->rcu, &mrm_rcdb_rcu_free_remap_entry);
-  */
 }
 
+unsigned
+mrm_rcdb_expire_idle_remaps(
+  struct mrm_rcdb_table * const t,
+  struct mrm_runconf_remap_entry ** const expired,
+  const unsigned room,
+  unsigned * const aging
+) {
+  struct mrm_runconf_remap_entry *r;
+  struct hlist_node *tmp;
+  const unsigned long now = jiffies;
+  unsigned headidx;
+  unsigned count;
+
+  count = 0;
+  *aging = 0;
+  for (headidx = 0; headidx < REMAP_HASH_COUNT; headidx++) {
+    hlist_for_each_entry_safe(r, tmp, &t->remap_hash[headidx], hlist) {
+      if (r->idle_timeout == 0) continue; /* never ages out */
+      if ((count >= room) || !time_after(now, READ_ONCE(r->last_hit) + (r->idle_timeout * HZ))) {
+        ++(*aging); /* still around for the next pass */
+        continue;
+      }
+      mrm_rcdb_unlink_remap_entry(t, r);
+      expired[count++] = r;
+    }
+  }
+  return count;
+}
+
+
+
+/* staged configuration functions... */
+
+int
+mrm_rcdb_stage_begin( void ) {
+  mrm_rcdb_stage_abort(); /* start over if something was already staged */
+  _staged = mrm_rcdb_alloc_table();
+  if (_staged == NULL) {
+    return -ENOMEM;
+  }
+  return 0; /* success */
+}
+
+void
+mrm_rcdb_stage_abort( void ) {
+  if (_staged == NULL) return;
+
+  /* the critical path never saw it... no need to wait on anything */
+  mrm_rcdb_release_groups(_staged);
+  mrm_rcdb_free_table(_staged);
+  _staged = NULL;
+}
+
+int
+mrm_rcdb_stage_commit( void ) {
+  struct mrm_rcdb_table *old;
+
+  if (_staged == NULL) return -EINVAL; /* nothing staged */
+
+  /* swap the whole generation in... the old one gets cleaned up in one go
+     once the "critical path" can no longer be using it */
+  old = rcu_dereference_protected(_running, 1);
+  rcu_assign_pointer(_running, _staged);
+  _staged = NULL;
+  mrm_rcdb_release_groups(old); /* so groups only the old generation used can be deleted right away */
+  call_rcu(&old->rcu, &mrm_rcdb_rcu_free_table);
+
+  return 0; /* success */
+}
+
+
+
+/* replacement group functions... */
+
+unsigned
+mrm_rcdb_get_group_count( void ) {
+  return READ_ONCE(_group_count);
+}
+
+struct mrm_runconf_replace_group *
+mrm_rcdb_lookup_group_by_name(const char * const name) {
+  struct mrm_runconf_replace_group *g;
+
+  group_for_each(g) {
+    if (strncmp(g->name, name, sizeof(g->name)) == 0)
+      return g;
+  }
+
+  return NULL; /* not found */
+}
+
+/* same as mrm_rcdb_filter_at() and mrm_rcdb_next_filter()... */
+struct mrm_runconf_replace_group *
+mrm_rcdb_group_at(struct mrm_rcdb_cursor * const cursor) {
+  struct mrm_runconf_replace_group *g;
+  unsigned skip;
+
+  skip = cursor->pos;
+  group_for_each(g) {
+    if (skip-- == 0) return g;
+  }
+  return NULL; /* no more */
+}
+
+struct mrm_runconf_replace_group *
+mrm_rcdb_next_group(struct mrm_runconf_replace_group * const g, struct mrm_rcdb_cursor * const cursor) {
+  ++cursor->pos;
+  return list_next_or_null_rcu(&_group_list, &g->list, struct mrm_runconf_replace_group, list);
+}
+
+static void
+mrm_rcdb_rcu_free_group(struct rcu_head *head) {
+  struct mrm_runconf_replace_group *g;
+
+  g = container_of(head, struct mrm_runconf_replace_group, rcu);
+  mrm_rcdb_free_replace_set(rcu_dereference_raw(g->set));
+  kfree(g);
+}
+
+/* sets the replacements of a group (inserting the group if need be)... every remap using it
+   switches over to the new replacements with the one pointer swap. the group takes over the
+   device references (replace_dev may be NULL), but only on success */
+struct mrm_runconf_replace_group *
+mrm_rcdb_update_group(
+  const char * const                    name,
+  const struct mrm_replacement * const  replace,
+  const unsigned                        replace_count,
+  struct net_device ** const            replace_dev
+) {
+  struct mrm_runconf_replace_group *g;
+  struct mrm_runconf_replace_set *s, *old_set;
+  unsigned i;
+
+  /* mandatory parameter sanity checks... */
+  if ((replace_count < 1) || (replace_count > MRM_REPLACE_GROUP_LIMIT)) return NULL;
+
+  /* find if we have an existing group... is our group list full ? (if were inserting a new group that is...) */
+  g = mrm_rcdb_lookup_group_by_name(name);
+  if ((g == NULL) && (_group_count >= MRM_MAX_REPLACE_GROUPS)) {
+    return NULL; /* were full... */
+  }
+
+  s = mrm_rcdb_build_replace_set(replace, replace_count, replace_dev);
+  if (s == NULL) {
+    return NULL; /* out of memory... */
+  }
+
+  if (g == NULL) {
+    g = kzalloc(sizeof(*g), GFP_KERNEL);
+    if (g == NULL) {
+      goto fail_nomem;
+    }
+    strncpy(g->name, name, sizeof(g->name));
+    RCU_INIT_POINTER(g->set, s);
+    list_add_rcu(&g->list, &_group_list);
+    ++_group_count;
+    return g; /* all is good */
+  }
+
+  /* swap the new replacements in... the old ones (and their counters) go once the "critical path" is done with them */
+  old_set = rcu_dereference_protected(g->set, 1);
+  rcu_assign_pointer(g->set, s);
+  call_rcu(&old_set->rcu, &mrm_rcdb_rcu_free_replace_set);
+  return g; /* all is good */
+
+fail_nomem:
+  /* the caller still owns the device references on failure... */
+  for (i = 0; i < s->replace_count; ++i) {
+    s->replace[i].dev = NULL;
+  }
+  mrm_rcdb_free_replace_set(s);
+  return NULL; /* out of memory... */
+}
+
+int
+mrm_rcdb_delete_group(struct mrm_runconf_replace_group * const group) {
+
+  if (atomic_read(&group->refcnt) > 0) {
+    return -EADDRINUSE;
+  }
+
+  list_del_rcu(&group->list);
+  --_group_count;
+  call_rcu(&group->rcu, &mrm_rcdb_rcu_free_group);
+
+  return 0; /* success */
+}
+
+
+
+/* multicast group functions... */
+
+unsigned
+mrm_rcdb_get_mcast_group_count( void ) {
+  struct mrm_runconf_mcast_group *m;
+  unsigned result;
+
+  result = 0;
+  mcast_for_each(m) {
+    ++result;
+  }
+  return result;
+}
+
+struct mrm_runconf_mcast_group *
+mrm_rcdb_lookup_mcast_group_by_macaddr(const unsigned char * const macaddr) {
+  struct mrm_runconf_mcast_group *m;
+
+  mcast_for_each(m) {
+    if (ether_addr_equal(m->conf.group_macaddr, macaddr))
+      return m; /* success */
+  }
+
+  return NULL; /* lookup failed */
+}
+
+struct mrm_runconf_mcast_group *
+mrm_rcdb_lookup_mcast_group_by_index(unsigned index) {
+  struct mrm_runconf_mcast_group *m;
+
+  mcast_for_each(m) {
+    if (index-- == 0)
+      return m;
+  }
+
+  return NULL; /* lookup failed */
+}
+
+/* same as mrm_rcdb_filter_at() and mrm_rcdb_next_filter()... */
+struct mrm_runconf_mcast_group *
+mrm_rcdb_mcast_group_at(struct mrm_rcdb_cursor * const cursor) {
+  struct mrm_runconf_mcast_group *m;
+  unsigned skip;
+
+  skip = cursor->pos;
+  mcast_for_each(m) {
+    if (skip-- == 0) return m;
+  }
+  return NULL; /* no more */
+}
+
+struct mrm_runconf_mcast_group *
+mrm_rcdb_next_mcast_group(struct mrm_runconf_mcast_group * const m, struct mrm_rcdb_cursor * const cursor) {
+  ++cursor->pos;
+  return list_next_or_null_rcu(&_mcast_list, &m->list, struct mrm_runconf_mcast_group, list);
+}
+
+static void
+mrm_rcdb_rcu_free_mcast_group(struct rcu_head *head) {
+  struct mrm_runconf_mcast_group *m;
+
+  m = container_of(head, struct mrm_runconf_mcast_group, rcu);
+  free_percpu(m->pcpu);
+  kmem_cache_free(_mcast_cache, m);
+}
+
+struct mrm_runconf_mcast_group *
+mrm_rcdb_update_mcast_group(const struct mrm_mcast_group * const conf) {
+  struct mrm_runconf_mcast_group *new_group, *existing_group;
+  struct net_device *dev;
+  unsigned cpu;
+  unsigned i;
+
+  /* find if we have an existing group... */
+  existing_group = mrm_rcdb_lookup_mcast_group_by_macaddr(conf->group_macaddr);
+
+  /* is our group list full ? (if were inserting a new group that is...) */
+  if ((existing_group == NULL) && (mrm_rcdb_get_mcast_group_count() == MRM_MAX_MCAST_GROUPS)) {
+    return NULL; /* were full... */
+  }
+
+  /* allocate a new group... */
+  new_group = kmem_cache_alloc(_mcast_cache, GFP_ATOMIC);
+  if (new_group == NULL) {
+    return NULL; /* out of memory... */
+  }
+  memset(new_group, 0, sizeof(*new_group));
+  new_group->pcpu = alloc_percpu(struct mrm_runconf_mcast_pcpu);
+  if (new_group->pcpu == NULL) {
+    kmem_cache_free(_mcast_cache, new_group);
+    return NULL; /* out of memory... */
+  }
+  for_each_possible_cpu(cpu) {
+    mrm_counter_init(&per_cpu_ptr(new_group->pcpu, cpu)->converted);
+    mrm_counter_init(&per_cpu_ptr(new_group->pcpu, cpu)->copies);
+  }
+  memcpy(&new_group->conf, conf, sizeof(new_group->conf));
+
+  /* the "critical path" goes by the interface index of each bridge port... mrm_rcdb_netdev_event() keeps them current */
+  for (i = 0; i < conf->member_count; ++i) {
+    dev = dev_get_by_name(&init_net, conf->members[i].ifname);
+    if (dev == NULL) continue; /* not registered (yet) */
+    new_group->ifindex[i] = dev->ifindex;
+    dev_put(dev);
+  }
+
+  /* swap it in for the existing one (if any)... */
+  if (existing_group != NULL) {
+    list_replace_rcu(&existing_group->list, &new_group->list);
+    call_rcu(&existing_group->rcu, &mrm_rcdb_rcu_free_mcast_group);
+  }
+  else {
+    list_add_rcu(&new_group->list, &_mcast_list);
+  }
+
+  return new_group; /* all is good */
+}
+
+void
+mrm_rcdb_delete_mcast_group(struct mrm_runconf_mcast_group * const group) {
+
+  /* sanity check... */
+  if (group == NULL) return;
+
+  list_del_rcu(&group->list);
+  call_rcu(&group->rcu, &mrm_rcdb_rcu_free_mcast_group);
+}
@@ -15,20 +15,65 @@ int mrm_rcdb_init( void );
 void mrm_rcdb_destroy( void );
 void mrm_rcdb_clear( void );
 
+/* a generation of the filter set and remap table... the running one is what the "critical path" uses */
+struct mrm_rcdb_table;
+struct mrm_rcdb_table *mrm_rcdb_running( void );
+struct mrm_rcdb_table *mrm_rcdb_staged( void ); /* NULL when nothing is being staged */
+
 /* filter functions... */
 unsigned mrm_rcdb_get_filter_count( void );
-struct mrm_runconf_filter_node *mrm_rcdb_lookup_filter_by_name(const char * const /* name */);
+struct mrm_runconf_filter_node *mrm_rcdb_lookup_filter_by_name(struct mrm_rcdb_table * const /* t */, const char * const /* name */);
 struct mrm_runconf_filter_node *mrm_rcdb_lookup_filter_by_index(unsigned /* index */);
-struct mrm_runconf_filter_node *mrm_rcdb_insert_filter( const char * const /* name */);
-int mrm_rcdb_delete_filter( struct mrm_runconf_filter_node * const /* filter */ );
+struct mrm_runconf_filter_node *mrm_rcdb_insert_filter( struct mrm_rcdb_table * const /* t */, const char * const /* name */);
+int mrm_rcdb_delete_filter( struct mrm_rcdb_table * const /* t */, struct mrm_runconf_filter_node * const /* filter */ );
+struct mrm_runconf_filter_rules *mrm_rcdb_alloc_filter_rules(const struct mrm_filter_rule * const /* rules */, const unsigned /* rule_count */);
+void mrm_rcdb_free_filter_rules(struct mrm_runconf_filter_rules * const /* rules */); /* only for rules that never got set */
+int mrm_rcdb_set_filter_rules(struct mrm_rcdb_table * const /* t */, struct mrm_runconf_filter_node * const /* filter */, struct mrm_runconf_filter_rules * const /* rules */);
+struct mrm_runconf_filter_node *mrm_rcdb_filter_at(struct mrm_rcdb_table * const /* t */, struct mrm_rcdb_cursor * const /* cursor */);
+struct mrm_runconf_filter_node *mrm_rcdb_next_filter(struct mrm_rcdb_table * const /* t */, struct mrm_runconf_filter_node * const /* f */, struct mrm_rcdb_cursor * const /* cursor */);
+int mrm_rcdb_walk_filters(struct mrm_rcdb_cursor * const /* cursor */, int (*)(struct mrm_runconf_filter_node * const, void * const) /* fn */, void * const /* ctx */);
 
 
 /* remap entry functions... */
 unsigned mrm_rcdb_get_remap_count( void );
 struct mrm_runconf_remap_entry *mrm_rcdb_lookup_remap_entry_by_macaddr(const unsigned char * const /* macaddr */);
 struct mrm_runconf_remap_entry *mrm_rcdb_lookup_remap_entry_by_index(unsigned /* index */);
-struct mrm_runconf_remap_entry *mrm_rcdb_update_remap_entry(const unsigned char * const /* match_macaddr */, struct mrm_runconf_filter_node * const /* filter */, const unsigned /* replace_count */, const unsigned char ** const /* replace_macaddr */, struct net_device ** const /* replace_dev */);
-void mrm_rcdb_delete_remap_entry(struct mrm_runconf_remap_entry * const /* remap_entry */);
+void mrm_rcdb_foreach_remap_entry(void (*)(struct mrm_runconf_remap_entry * const, void * const) /* fn */, void * const /* ctx */);
+struct mrm_runconf_remap_entry *mrm_rcdb_remap_entry_at(struct mrm_rcdb_table * const /* t */, struct mrm_rcdb_cursor * const /* cursor */);
+struct mrm_runconf_remap_entry *mrm_rcdb_next_remap_entry(struct mrm_rcdb_table * const /* t */, struct mrm_runconf_remap_entry * const /* r */, struct mrm_rcdb_cursor * const /* cursor */);
+int mrm_rcdb_walk_remaps(struct mrm_rcdb_cursor * const /* cursor */, int (*)(struct mrm_runconf_remap_entry * const, void * const) /* fn */, void * const /* ctx */);
+struct mrm_runconf_remap_entry *mrm_rcdb_update_remap_entry(struct mrm_rcdb_table * const /* t */, const struct mrm_remap_entry * const /* conf */, struct mrm_runconf_filter_node ** const /* filters */, struct mrm_runconf_replace_group ** const /* groups */, struct net_device * (* const /* replace_dev */)[MRM_MAX_REPLACE]);
+int mrm_rcdb_rebuild_classifiers(struct mrm_rcdb_table * const /* t */, const struct mrm_runconf_filter_node * const /* filter */);
+void mrm_rcdb_netdev_event(struct net_device * const /* dev */, const unsigned long /* event */);
+void mrm_rcdb_delete_remap_entry(struct mrm_rcdb_table * const /* t */, struct mrm_runconf_remap_entry * const /* remap_entry */);
+/* unlinks (up to room) remap entries that went idle for longer than their idle timeout, for the caller to
+   mrm_rcdb_free_remap_entry() once a grace period has passed... *aging tells how many entries with an idle timeout are left */
+unsigned mrm_rcdb_expire_idle_remaps(struct mrm_rcdb_table * const /* t */, struct mrm_runconf_remap_entry ** const /* expired */, const unsigned /* room */, unsigned * const /* aging */);
+void mrm_rcdb_free_remap_entry(struct mrm_runconf_remap_entry * const /* r */);
+
+
+/* staged configuration functions... */
+int mrm_rcdb_stage_begin( void );
+void mrm_rcdb_stage_abort( void );
+int mrm_rcdb_stage_commit( void );
+
+
+/* replacement group functions... */
+unsigned mrm_rcdb_get_group_count( void );
+struct mrm_runconf_replace_group *mrm_rcdb_lookup_group_by_name(const char * const /* name */);
+struct mrm_runconf_replace_group *mrm_rcdb_group_at(struct mrm_rcdb_cursor * const /* cursor */);
+struct mrm_runconf_replace_group *mrm_rcdb_next_group(struct mrm_runconf_replace_group * const /* g */, struct mrm_rcdb_cursor * const /* cursor */);
+struct mrm_runconf_replace_group *mrm_rcdb_update_group(const char * const /* name */, const struct mrm_replacement * const /* replace */, const unsigned /* replace_count */, struct net_device ** const /* replace_dev */);
+int mrm_rcdb_delete_group(struct mrm_runconf_replace_group * const /* group */);
+
 
+/* multicast group functions... */
+unsigned mrm_rcdb_get_mcast_group_count( void );
+struct mrm_runconf_mcast_group *mrm_rcdb_lookup_mcast_group_by_macaddr(const unsigned char * const /* macaddr */);
+struct mrm_runconf_mcast_group *mrm_rcdb_lookup_mcast_group_by_index(unsigned /* index */);
+struct mrm_runconf_mcast_group *mrm_rcdb_mcast_group_at(struct mrm_rcdb_cursor * const /* cursor */);
+struct mrm_runconf_mcast_group *mrm_rcdb_next_mcast_group(struct mrm_runconf_mcast_group * const /* m */, struct mrm_rcdb_cursor * const /* cursor */);
+struct mrm_runconf_mcast_group *mrm_rcdb_update_mcast_group(const struct mrm_mcast_group * const /* conf */);
+void mrm_rcdb_delete_mcast_group(struct mrm_runconf_mcast_group * const /* group */);
 
 #endif /* #ifndef MRM_RCDC_H_INCLUDED */
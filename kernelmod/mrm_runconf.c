@@ -11,7 +11,24 @@
 #include "./mrm_private.h"
 #include "./mrm_rcdb.h"
 #include "./filter_config_accelerator.h"
-
+#include "./mrm_flowtable.h"
+#include "./mrm_loadbal.h"
+#include "./mrm_elephant.h"
+#include "./mrm_genl.h"
+#include "./mrm_stats.h"
+#include "./mrm_latency.h"
+#include "./mrm_trace.h"
+#include "./mrm_decision.h"
+#include "./mrm_aging.h"
+#include "./mrm_ipset.h"
+
+#include <linux/version.h>
+#include <linux/etherdevice.h> /* ether_addr_equal() */
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/jhash.h>
+#include <linux/math64.h>
+#include <linux/jiffies.h>
 #include <linux/ip.h>
 #include <linux/ipv6.h>
 #include <linux/udp.h>
@@ -20,30 +37,21 @@
 
 
 
-static inline int
-mrm_perform_ipv4_remap(
-  const struct mrm_runconf_remap_entry * const remaprule,
-  unsigned char * const dst,
-  const unsigned transmission_length,
-  struct sk_buff * const skb
+static inline void
+mrm_build_ipv4_flow_key(
+  struct mrm_flow_key * const key,
+  const unsigned char * const dst,
+  const struct sk_buff * const skb
   ) {
 
-  const struct mrm_filter_rulerefset * ruleref;
-  const struct mrm_filter_rule *rule;
   const struct iphdr * iph;
   union {
     const struct udphdr * udph;
     const struct tcphdr * tcph;
     const void *          transportptr;
   } u;
-  unsigned i;
-  unsigned short src_port;
-  unsigned short dst_port;
-  __be32         src_subnet;
-  unsigned validate_port;
-  const struct mrm_filter_single_family_protocol_ruleset * const target_rules = &remaprule->filter->accelerator.ip4_targeted_rules;
 
-  validate_port = 0;
+  memset(key, 0, sizeof(*key)); /* the key gets hashed... no stray padding allowed */
   iph = ip_hdr(skb);
 
   /*
@@ -60,23 +68,60 @@ mrm_perform_ipv4_remap(
   */
   u.transportptr = ((unsigned char *)iph) + (iph->ihl * 4);
 
+  memcpy(key->macaddr, dst, sizeof(key->macaddr));
+  key->family    = AF_INET;
+  key->proto     = iph->protocol;
+  key->saddr.ip4 = iph->saddr;
+  key->daddr.ip4 = iph->daddr;
+
   switch (iph->protocol) {
+  case IPPROTO_TCP:
+    key->sport = ntohs(u.tcph->source);
+    key->dport = ntohs(u.tcph->dest);
+    break;
+  case IPPROTO_UDP:
+    key->sport = ntohs(u.udph->source);
+    key->dport = ntohs(u.udph->dest);
+    break;
+  default:
+    break; /* no ports... */
+  }
+}
+
+/* returns the (first) rule reference the frame matches, which tells the class it falls into...
+   or NULL if it matches none of them */
+static inline const struct mrm_classifier_ruleref *
+mrm_classify_ipv4_frame(
+  const struct mrm_classifier * const classifier,
+  const struct mrm_flow_key * const key,
+  const unsigned transmission_length,
+  const struct sk_buff * const skb
+  ) {
+
+  const struct mrm_classifier_rulerefset * ruleref;
+  const struct mrm_filter_rule *rule;
+  unsigned i;
+  unsigned short src_port;
+  unsigned short dst_port;
+  __be32         src_subnet;
+  unsigned validate_port;
+  const struct mrm_classifier_single_family_protocol_ruleset * const target_rules = &classifier->ip4_targeted_rules;
+
+  validate_port = 0;
+  src_port = key->sport;
+  dst_port = key->dport;
+
+  switch (key->proto) {
   case IPPROTO_TCP:
     validate_port = 1;
     ruleref = &target_rules->tcp_targeted_rules;
-    src_port = ntohs(u.tcph->source);
-    dst_port = ntohs(u.tcph->dest);
     break;
   case IPPROTO_UDP:
     validate_port = 1;
     ruleref = &target_rules->udp_targeted_rules;
-    src_port = ntohs(u.udph->source);
-    dst_port = ntohs(u.udph->dest);
     break;
   default:
     ruleref = &target_rules->other_targeted_rules;
-    src_port = 0;
-    dst_port = 0;
     break;
   }
 
@@ -86,9 +131,12 @@ mrm_perform_ipv4_remap(
      this means that at this point, the protocol and 
      family are already validated applicable for this
      packet
+
+     the rules of all the classes are in here, in class
+     order... so the first match is the frame's class
   */
   for (i = 0; i < ruleref->rules_active; i++) {
-    rule = ruleref->rules[i];
+    rule = ruleref->rules[i].rule;
 
     /* validate transmission length */
     if (transmission_length < rule->payload_size) continue;
@@ -98,27 +146,33 @@ mrm_perform_ipv4_remap(
     case MRMIPFILT_MATCHANY:
       break;
     case MRMIPFILT_MATCHSINGLE:
-      if (rule->src_ipaddr.ipaddr4.s_addr != iph->saddr) {
+      if (rule->src_ipaddr.ipaddr4.s_addr != key->saddr.ip4) {
         continue;
       }
       break;
     case MRMIPFILT_MATCHSUBNET:
-      src_subnet  = iph->saddr;
+      src_subnet  = key->saddr.ip4;
       src_subnet &= rule->src_ipaddr.ipaddr4_mask.s_addr;
       if (rule->src_ipaddr.ipaddr4.s_addr != src_subnet) {
         continue;
       }
       break;
     case MRMIPFILT_MATCHRANGE:
-      if (ntohl(iph->saddr) < ntohl(rule->src_ipaddr.ipaddr4_start.s_addr)) {
+      if (ntohl(key->saddr.ip4) < ntohl(rule->src_ipaddr.ipaddr4_start.s_addr)) {
+        continue;
+      }
+      if (ntohl(key->saddr.ip4) > ntohl(rule->src_ipaddr.ipaddr4_end.s_addr)) {
         continue;
       }
-      if (ntohl(iph->saddr) > ntohl(rule->src_ipaddr.ipaddr4_end.s_addr)) {
+      break;
+    case MRMIPFILT_MATCHIPSET:
+      if (!mrm_ipset_test(rule->src_ipaddr.ipset_index, AF_INET, skb)) {
         continue;
       }
+      break;
     }
 
-    if (!validate_port) return 1; /* rule matches... tell caller to perform remap */
+    if (!validate_port) return &ruleref->rules[i]; /* rule matches... tell caller to perform remap */
 
     switch (rule->src_port.match_type) {
     case MRMPORTFILT_MATCHANY:
@@ -150,53 +204,425 @@ mrm_perform_ipv4_remap(
       }
     }
 
-    return 1; /* rule matches... tell caller to perform remap */
+    return &ruleref->rules[i]; /* rule matches... tell caller to perform remap */
   }
 
-  return 0; /* no match... dont remap MAC address */
+  return NULL; /* no match... dont remap MAC address */
 }
 
-static inline int
-mrm_perform_ipv6_remap(
-  const struct mrm_runconf_remap_entry * const remaprule,
+static inline const struct mrm_classifier_ruleref *
+mrm_classify_ipv6_frame(
+  const struct mrm_classifier * const classifier,
   unsigned char * const dst,
   const unsigned transmission_length,
   struct sk_buff * const skb
   ) {
-  return 0; /* XXX NOT IMPLEMENTED!!! */
+  return NULL; /* XXX NOT IMPLEMENTED!!! */
+}
+
+/* takes up to "want" tokens from a replacement's bucket, topping it up first for the time that
+   passed since it was last topped up... returns how many it got */
+static long
+mrm_bucket_take(
+    const struct mrm_runconf_replacement * const r,
+    struct mrm_runconf_replace_bucket * const b,
+    const long want
+  ) {
+  const unsigned long now = jiffies;
+  unsigned long stamp, elapsed;
+  long tokens, refill, take;
+
+  /* the stamp only moves when whole bytes get added so slow rates dont lose their fractions...
+     and only the cpu that gets to move it adds them */
+  stamp = (unsigned long)atomic_long_read(&b->stamp);
+  elapsed = now - stamp;
+  if (elapsed > 0) {
+    if (elapsed > (unsigned long)HZ) elapsed = HZ; /* plenty to fill any bucket; keeps the math in range */
+    refill = (long)div_u64((u64)elapsed * r->rate, HZ);
+    if ((refill > 0) && (atomic_long_cmpxchg(&b->stamp, (long)stamp, (long)now) == (long)stamp)) {
+      do {
+        tokens = atomic_long_read(&b->tokens);
+      } while (atomic_long_cmpxchg(&b->tokens, tokens, min(tokens + refill, (long)r->burst)) != tokens);
+    }
+  }
+
+  do {
+    tokens = atomic_long_read(&b->tokens);
+    if (tokens <= 0) return 0; /* over the cap */
+    take = min(tokens, want);
+  } while (atomic_long_cmpxchg(&b->tokens, tokens, tokens - take) != tokens);
+  return take;
+}
+
+static inline int
+mrm_replacement_has_room(
+    const struct mrm_runconf_replace_set * const remaprule,
+    struct mrm_runconf_replace_pcpu * const pcpu,
+    const unsigned replace_idx,
+    const unsigned len
+  ) {
+  const struct mrm_runconf_replacement * const r = &remaprule->replace[replace_idx];
+  struct mrm_runconf_replace_pcpu * const c = &pcpu[replace_idx];
+
+  if (r->rate == 0) return 1; /* not rate limited */
+
+  /* this cpu's own tokens ran out... pay off whatever a large frame left owing and take a quantum more */
+  if (c->tokens <= 0) {
+    c->tokens += mrm_bucket_take(r, &remaprule->bucket[replace_idx], r->token_quantum - c->tokens);
+    if (c->tokens <= 0) return 0; /* over the cap */
+  }
+  c->tokens -= len;
+  return 1;
+}
+
+static inline int
+mrm_move_frame(
+    const struct mrm_runconf_replace_set * const remaprule,
+    const unsigned spill,
+    const unsigned long * const live_mask,
+    unsigned replace_idx,
+    const struct mrm_flow_key * const key,
+    unsigned char * const dst,
+    struct sk_buff * const skb
+  ) {
+  struct mrm_runconf_replace_pcpu * const pcpu = this_cpu_ptr(remaprule->replace_pcpu);
+  struct net_device *dev;
+  unsigned tries;
+
+  /* respect the rate limit of the chosen replacement... spilling over (to live replacements only) as configured
+     (the frame counts as spilled just once, by the replacement it was meant for) */
+  if (!mrm_replacement_has_room(remaprule, pcpu, replace_idx, skb->len)) {
+    mrm_counter_add(&pcpu[replace_idx].spilled, skb->len);
+    if (spill != MRMSPILL_NEXT) {
+      return 0; /* leave the frame be */
+    }
+    tries = 0;
+    do {
+      do {
+        if (++tries >= remaprule->replace_count) {
+          return 0; /* no room anywhere... leave the frame be */
+        }
+        if (++replace_idx >= remaprule->replace_count) replace_idx = 0;
+      } while (!test_bit(replace_idx, live_mask));
+    } while (!mrm_replacement_has_room(remaprule, pcpu, replace_idx, skb->len));
+  }
+
+  mrm_counter_add(&pcpu[replace_idx].tx, skb->len);
+
+  dev = READ_ONCE(remaprule->replace[replace_idx].dev); /* the netdevice notifier may be letting go of it */
+  trace_mrm_replace_chosen(dst, replace_idx, remaprule->replace[replace_idx].macaddr, dev, key, skb->len);
+  mrm_decision_sample(key, dst, remaprule->replace[replace_idx].macaddr, replace_idx, skb->len);
+  memcpy(dst, remaprule->replace[replace_idx].macaddr, 6);
+  if (dev != NULL) {
+    skb->dev = dev;
+  }
+  return 1; /* frame moved */
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,18,0)
+/* a copy holds on to a clone of the original for as long as it shares the original's data...
+   that keeps the original cloned, so whoever mangles it further down the hook chain unshares it first */
+static void
+mrm_copy_frame_release(struct sk_buff * const nskb) {
+  consume_skb(skb_shinfo(nskb)->destructor_arg);
+}
+#endif
+
+/* a copy of the frame with an ethernet header of its own, the rest stays shared with the original...
+   skb_zerocopy() hands the copy the original's linear area as a page fragment when it can (a page
+   backed head, as most drivers receive into). a kmalloc()ed head cant be shared that way and gets
+   copied, as does a frame small enough to fit in the slack of the copy's header allocation.
+   gso and checksum offloaded frames are cloned instead, their linear area is just the headers */
+static inline struct sk_buff *
+mrm_copy_frame(struct sk_buff * const skb) {
+  struct sk_buff *nskb;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,18,0)
+  struct sk_buff *hold;
+  const unsigned hlen = skb->data - skb_mac_header(skb);
+  unsigned zlen;
+
+  if ((skb->ip_summed != CHECKSUM_PARTIAL) && !skb_is_gso(skb)) {
+    hold = skb_clone(skb, GFP_ATOMIC);
+    if (hold == NULL) {
+      return NULL; /* out of memory... */
+    }
+
+    zlen = skb_zerocopy_headlen(skb); /* what has to be copied after all */
+    nskb = alloc_skb(LL_MAX_HEADER + hlen + zlen, GFP_ATOMIC);
+    if (nskb == NULL) {
+      kfree_skb(hold);
+      return NULL;
+    }
+    skb_reserve(nskb, LL_MAX_HEADER);
+    memcpy(skb_put(nskb, hlen), skb_mac_header(skb), hlen);
+
+    /* everything the bridge set up for the frame... the header offsets are relative to the new data though */
+    skb_copy_header(nskb, skb);
+    skb_reset_mac_header(nskb);
+    __skb_pull(nskb, hlen);
+    nskb->mac_len = skb->mac_len;
+    skb_set_network_header(nskb, skb_network_offset(skb));
+    if (skb_transport_header_was_set(skb)) skb_set_transport_header(nskb, skb_transport_offset(skb));
+
+    if (skb_zerocopy(nskb, skb, skb->len, zlen) != 0) {
+      kfree_skb(nskb);
+      kfree_skb(hold);
+      return NULL;
+    }
+    skb_shinfo(nskb)->destructor_arg = hold;
+    nskb->destructor = &mrm_copy_frame_release;
+    return nskb;
+  }
+#endif
+
+  nskb = skb_clone(skb, GFP_ATOMIC);
+  if (nskb == NULL) {
+    return NULL; /* out of memory... */
+  }
+
+  /* the clone shares the header with the original... give it one of its own before it gets rewritten
+     (pskb_expand_head() copies the whole linear area, which is where the above is not an option) */
+  if (skb_cow_head(nskb, 0) != 0) {
+    kfree_skb(nskb);
+    return NULL;
+  }
+  return nskb;
+}
+
+static inline void
+mrm_send_duplicate(
+    const struct mrm_runconf_replace_set * const remaprule,
+    struct mrm_runconf_replace_pcpu * const pcpu,
+    const unsigned replace_idx,
+    struct sk_buff * const skb,
+    struct sk_buff_head * const copies
+  ) {
+  struct sk_buff *nskb;
+  struct net_device *dev;
+
+  nskb = mrm_copy_frame(skb);
+  if (nskb == NULL) {
+    return; /* the original still goes out */
+  }
+
+  mrm_counter_add(&pcpu[replace_idx].tx, nskb->len);
+  mrm_counter_add(&pcpu[replace_idx].dup, nskb->len);
+
+  memcpy(skb_mac_header(nskb), remaprule->replace[replace_idx].macaddr, 6);
+  dev = READ_ONCE(remaprule->replace[replace_idx].dev);
+  if (dev != NULL) {
+    nskb->dev = dev;
+  }
+  __skb_queue_tail(copies, nskb);
+}
+
+static inline int
+mrm_replicate_frame(
+    const struct mrm_runconf_replace_set * const remaprule,
+    const unsigned long * const live_mask,
+    unsigned char * const dst,
+    struct sk_buff * const skb,
+    struct sk_buff_head * const copies
+  ) {
+  struct mrm_runconf_replace_pcpu * const pcpu = this_cpu_ptr(remaprule->replace_pcpu);
+  struct net_device *dev;
+  int original_idx;
+  unsigned i;
+
+  /* the first live replacement with room gets the original frame, the rest get copies...
+     a rate limited replacement without room simply goes without */
+  original_idx = -1;
+  for (i = 0; i < remaprule->replace_count; ++i) {
+    if (!test_bit(i, live_mask)) continue;
+    if (!mrm_replacement_has_room(remaprule, pcpu, i, skb->len)) {
+      mrm_counter_add(&pcpu[i].spilled, skb->len);
+      continue;
+    }
+    if (original_idx < 0) {
+      original_idx = i; /* rewritten last, once the copies have their own headers */
+      continue;
+    }
+    mrm_send_duplicate(remaprule, pcpu, i, skb, copies);
+  }
+  if (original_idx < 0) {
+    return 0; /* no room anywhere... leave the frame be */
+  }
+
+  mrm_counter_add(&pcpu[original_idx].tx, skb->len);
+
+  memcpy(dst, remaprule->replace[original_idx].macaddr, 6);
+  dev = READ_ONCE(remaprule->replace[original_idx].dev);
+  if (dev != NULL) {
+    skb->dev = dev;
+  }
+  return 1; /* frame moved */
 }
 
+/* shadow mode counterpart of mrm_replicate_frame()... every live replacement would have gotten a copy */
 static inline void
+mrm_shadow_replicate_frame(
+    const struct mrm_runconf_replace_set * const remaprule,
+    const unsigned long * const live_mask,
+    const struct sk_buff * const skb
+  ) {
+  struct mrm_runconf_replace_pcpu * const pcpu = this_cpu_ptr(remaprule->replace_pcpu);
+  unsigned i;
+
+  for (i = 0; i < remaprule->replace_count; ++i) {
+    if (test_bit(i, live_mask)) mrm_counter_add(&pcpu[i].shadow, skb->len);
+  }
+}
+
+static inline int
 mrm_apply_remap(
-    struct mrm_runconf_remap_entry * const remaprule,
+    struct mrm_runconf_remap_entry * const remapentry,
+    const unsigned class_idx,
+    const struct mrm_flow_key * const key,
     unsigned char * const dst,
-    struct sk_buff * const skb
+    struct sk_buff * const skb,
+    struct sk_buff_head * const copies
   ) {
   /* this is THE function that actually moves the frame elsewhere... */
+  const struct mrm_runconf_remap_class * const c = &remapentry->classes[class_idx];
+  struct mrm_runconf_replace_set * const remaprule = rcu_dereference(c->group->set); /* a named group may be swapping its replacements */
+  const struct mrm_runconf_replace_live * const live = rcu_dereference(remaprule->live);
+  unsigned slot;
+  unsigned replace_idx;
+
+  if (live->slot_count == 0) {
+    return 0; /* every replacement is down... leave the frame be */
+  }
+
+  if (c->policy == MRMREPLPOL_REPLICATE) {
+    if (remapentry->shadow) {
+      mrm_shadow_replicate_frame(remaprule, live->mask, skb);
+      return 0; /* shadow mode... frame left unmodified */
+    }
+    return mrm_replicate_frame(remaprule, live->mask, dst, skb, copies); /* nothing to choose... and nothing to pin */
+  }
 
-  /* implement a basic "round-robin" replacement policy... */
-  const unsigned replace_idx = remaprule->replace_idx;
-  if (++remaprule->replace_idx >= remaprule->replace_count) remaprule->replace_idx = 0;
+  switch (c->policy) {
+  case MRMREPLPOL_LEASTLOAD:
+    /* the load sampler already did the hard work... */
+    replace_idx = remaprule->replace_best;
+    if (test_bit(replace_idx, live->mask)) break;
+    goto round_robin; /* it went down since the last sample */
+  case MRMREPLPOL_FLOWHASH:
+    if (key != NULL) {
+      /* every frame of a flow lands on the same slot... */
+      slot = (unsigned)(((u64)jhash2((const u32 *)key, sizeof(*key) / sizeof(u32), 0) * live->slot_count) >> 32);
+      replace_idx = live->slot[slot];
+      break;
+    }
+    /* fall through - no flow to hash, so round-robin it */
+  default:
+  round_robin:
+    /* implement a basic (weighted) "round-robin" replacement policy... */
+    slot = remaprule->replace_idx;
+    if (slot >= live->slot_count) slot = 0; /* the live set shrank under us */
+    remaprule->replace_idx = slot + 1;
+    if (remaprule->replace_idx >= live->slot_count) remaprule->replace_idx = 0;
+    replace_idx = live->slot[slot];
+    break;
+  }
 
-  memcpy(dst, remaprule->replace[replace_idx].macaddr, 6);
-  if (remaprule->replace[replace_idx].dev != NULL) {
-    skb->dev = remaprule->replace[replace_idx].dev;
+  if (remapentry->shadow) {
+    /* nothing pinned and no rate limit... the frame is not going anywhere */
+    mrm_counter_add(&this_cpu_ptr(remaprule->replace_pcpu)[replace_idx].shadow, skb->len);
+    return 0; /* shadow mode... frame left unmodified */
+  }
+
+  /* remember the decision so the rest of the flow sticks to this class and replacement
+     (a rate limit spill is transient... the flow stays pinned to where it was meant to go) */
+  if ((key != NULL) && mrm_flowtable_enabled()) {
+    mrm_flowtable_pin(key, class_idx, remaprule->replace[replace_idx].macaddr, replace_idx);
+  }
+
+  return mrm_move_frame(remaprule, c->spill, live->mask, replace_idx, key, dst, skb);
+}
+
+static inline int
+mrm_lookup_pinned_replacement(
+    struct mrm_runconf_remap_entry * const remapentry,
+    const struct mrm_flow_key * const key,
+    const struct mrm_runconf_remap_class ** const pinned_class,
+    struct mrm_runconf_replace_set ** const replace_set,
+    const unsigned long ** const live_mask
+  ) {
+  const struct mrm_flow_entry *fe;
+  const struct mrm_runconf_remap_class *c;
+  struct mrm_runconf_replace_set *remaprule;
+  unsigned i;
+
+  if (!mrm_flowtable_enabled()) return -1;
+
+  fe = mrm_flowtable_lookup(key);
+  if (fe == NULL) return -1; /* flow not pinned (yet) */
+  if (fe->class_idx >= remapentry->class_count) return -1; /* the class is gone... re-evaluate the flow */
+  c = &remapentry->classes[fe->class_idx];
+  if (c->policy == MRMREPLPOL_REPLICATE) return -1; /* the class now goes everywhere */
+  remaprule = rcu_dereference(c->group->set);
+
+  /* the replacement is usually still where it was when the flow got pinned... */
+  i = fe->replace_idx;
+  if ((i >= remaprule->replace_count) || !ether_addr_equal(remaprule->replace[i].macaddr, fe->replace_macaddr)) {
+    /* ...but the remap entry (or its replacement group) has been updated since; see if the replacement survived */
+    for (i = 0; i < remaprule->replace_count; ++i) {
+      if (ether_addr_equal(remaprule->replace[i].macaddr, fe->replace_macaddr)) break;
+    }
+    if (i >= remaprule->replace_count) return -1; /* replacement is gone... re-evaluate the flow */
   }
+
+  *live_mask = rcu_dereference(remaprule->live)->mask;
+  if (!test_bit(i, *live_mask)) return -1; /* replacement is down... re-evaluate the flow */
+
+  *pinned_class = c;
+  *replace_set = remaprule;
+  return i;
+}
+
+/* keeps a remap with an idle timeout from aging out... the timestamp is only
+   ever written once a second or so, not for every frame from every cpu */
+static inline void
+mrm_remap_touch(struct mrm_runconf_remap_entry * const r) {
+  unsigned long now;
+
+  if (r->idle_timeout == 0) return;
+  now = jiffies;
+  if (time_after(now, READ_ONCE(r->last_hit) + HZ)) WRITE_ONCE(r->last_hit, now);
 }
 
 int
-mrm_perform_ethernet_remap(unsigned char * const dst, struct sk_buff * const skb) {
+mrm_perform_ethernet_remap(unsigned char * const dst, struct sk_buff * const skb, struct sk_buff_head * const copies) {
   struct mrm_runconf_remap_entry * remaprule;
+  const struct mrm_runconf_classifier * rc;
+  const struct mrm_runconf_remap_class * c;
+  const struct mrm_runconf_remap_class * pinned_class;
+  const struct mrm_classifier_ruleref * ref;
+  struct mrm_runconf_replace_set * pinned_set;
+  const unsigned long * pinned_live_mask;
   unsigned transmission_length;
+  struct mrm_flow_key key;
+  int pinned_idx;
+  int class_idx;
+  int rv;
+  u64 t;
 
   /* first and foremost, is the traffic targeted for us? */
+  t = mrm_latency_start();
   remaprule = mrm_rcdb_lookup_remap_entry_by_macaddr(dst);
+  mrm_latency_end(MRM_LAT_LOOKUP, t);
   if (remaprule == NULL) {
+    trace_mrm_lookup_miss(dst, skb);
+    mrm_stats_count(MRM_STAT_REMAP_MISS, skb->len);
     return 0; /* traffic not targeted for us */
   }
+  mrm_stats_count(MRM_STAT_REMAP_HIT, skb->len);
+  mrm_remap_touch(remaprule);
 
-  if (remaprule->filter == NULL) {
-    printk(KERN_WARNING "MRM No filter associated for matched remap\n");
+  rc = rcu_dereference(remaprule->classifier);
+  if (rc == NULL) {
+    printk_ratelimited(KERN_WARNING "MRM No classifier associated for matched remap\n");
     return 0; /* dont have a filter for this rule... */
   }
 
@@ -205,59 +631,262 @@ mrm_perform_ethernet_remap(unsigned char * const dst, struct sk_buff * const skb
   /* determine what kind of traffic this is... */
   switch (htons(skb->protocol)) {
   case ETH_P_IP:
-    if (mrm_perform_ipv4_remap(remaprule, dst, transmission_length, skb)) {
-      mrm_apply_remap(remaprule, dst, skb);
-      return 1; /* remap applied */
+    t = mrm_latency_start();
+    mrm_build_ipv4_flow_key(&key, dst, skb);
+    mrm_latency_end(MRM_LAT_PARSE, t);
+    /* a remap in shadow mode pins nothing... but flows pinned before it was put in shadow mode may still be around */
+    pinned_idx = remaprule->shadow ? -1 : mrm_lookup_pinned_replacement(remaprule, &key, &pinned_class, &pinned_set, &pinned_live_mask);
+    if (pinned_idx >= 0) {
+      t = mrm_latency_start();
+      rv = mrm_move_frame(pinned_set, pinned_class->spill, pinned_live_mask, pinned_idx, &key, dst, skb); /* no need to consult the filters */
+      mrm_latency_end(MRM_LAT_APPLY, t);
+      return rv;
     }
-    break;
+    if (remaprule->elephant_classes > 0) {
+      /* elephant flow mode... the filter only decides what counts towards becoming an elephant,
+         once the flow is one all of its frames go where its class sends them */
+      class_idx = mrm_elephant_check(&key);
+      if ((class_idx >= 0) && ((unsigned)class_idx < remaprule->class_count) && (remaprule->classes[class_idx].elephant_bytes > 0)) {
+        t = mrm_latency_start();
+        rv = mrm_apply_remap(remaprule, class_idx, &key, dst, skb, copies);
+        mrm_latency_end(MRM_LAT_APPLY, t);
+        return rv;
+      }
+    }
+    t = mrm_latency_start();
+    ref = mrm_classify_ipv4_frame(&rc->classifier, &key, transmission_length, skb);
+    mrm_latency_end(MRM_LAT_CLASSIFY, t);
+    if (ref == NULL) {
+      trace_mrm_filter_miss(remaprule, &key, transmission_length);
+      break;
+    }
+    trace_mrm_filter_match(remaprule, ref, &key, transmission_length);
+    mrm_counter_add(&this_cpu_ptr(rc->ref_pcpu)[ref - rc->refs], transmission_length);
+    class_idx = ref->class_idx;
+    c = &remaprule->classes[class_idx];
+    if ((c->elephant_bytes > 0) && !mrm_elephant_account(&key, class_idx, transmission_length, c->elephant_bytes, c->elephant_window_jiffies)) {
+      return 0; /* not an elephant (yet)... leave the frame be */
+    }
+    t = mrm_latency_start();
+    rv = mrm_apply_remap(remaprule, class_idx, &key, dst, skb, copies);
+    mrm_latency_end(MRM_LAT_APPLY, t);
+    return rv;
   case ETH_P_IPV6:
-    if (mrm_perform_ipv6_remap(remaprule, dst, transmission_length, skb)) {
-      mrm_apply_remap(remaprule, dst, skb);
-      return 1; /* remap applied */
+    t = mrm_latency_start();
+    ref = mrm_classify_ipv6_frame(&rc->classifier, dst, transmission_length, skb);
+    mrm_latency_end(MRM_LAT_CLASSIFY, t);
+    if (ref == NULL) {
+      trace_mrm_filter_miss(remaprule, NULL, transmission_length); /* no flow key for ip6 (yet) */
+      break;
     }
-    break;
+    trace_mrm_filter_match(remaprule, ref, NULL, transmission_length);
+    mrm_counter_add(&this_cpu_ptr(rc->ref_pcpu)[ref - rc->refs], transmission_length);
+    t = mrm_latency_start();
+    rv = mrm_apply_remap(remaprule, ref->class_idx, NULL, dst, skb, copies);
+    mrm_latency_end(MRM_LAT_APPLY, t);
+    return rv;
   default:
     break; /* not ip4 || ip6... traffic not targeted for us */
   }
 
+  mrm_stats_count(MRM_STAT_UNCLASSIFIED, transmission_length);
   return 0; /* remap not applied */
 }
 
+/* declare a mutex to enforce one transcation at a time
+   in the event multiple processes/tasks are changing
+   the configuration concurrently...
+*/
+static DEFINE_MUTEX(_runconf_mutex);
+
+/* bumped (under the mutex) by every change to the running filters/remaps/groups/multicast groups...
+   handed out with the netlink notifications so listeners can tell if they missed any */
+static u32 _runconf_generation;
+
+void
+mrm_runconf_lock( void ) {
+  mutex_lock(&_runconf_mutex);
+}
+
+void
+mrm_runconf_unlock( void ) {
+  mutex_unlock(&_runconf_mutex);
+}
+
+void
+mrm_handle_netdev_event( struct net_device * const dev, const unsigned long event ) {
+  mrm_runconf_lock();
+  mrm_rcdb_netdev_event(dev, event);
+  mrm_runconf_unlock();
+}
+
+int
+mrm_perform_multicast_to_unicast(unsigned char * const dst, struct sk_buff * const skb, struct sk_buff_head * const copies) {
+  const struct mrm_runconf_mcast_group *group;
+  struct sk_buff *nskb;
+  unsigned copy_count;
+  unsigned i;
+
+  /* is the group one we convert? */
+  group = mrm_rcdb_lookup_mcast_group_by_macaddr(dst);
+  if (group == NULL) {
+    return 0; /* leave it be */
+  }
+
+  /* the bridge floods a copy of the frame to every port... each member only gets its
+     unicast copy from the one going out of the port the member sits behind */
+  copy_count = 0;
+  for (i = 0; i < group->conf.member_count; ++i) {
+    if (READ_ONCE(group->ifindex[i]) != skb->dev->ifindex) {
+      continue; /* member is not behind this port */
+    }
+
+    nskb = mrm_copy_frame(skb);
+    if (nskb == NULL) {
+      continue; /* out of memory... */
+    }
+    memcpy(skb_mac_header(nskb), group->conf.members[i].macaddr, 6);
+
+    /* its now a frame like any other headed for the station... remap it as such */
+    mrm_perform_ethernet_remap(skb_mac_header(nskb), nskb, copies);
+
+    ++copy_count;
+    mrm_counter_add(&this_cpu_ptr(group->pcpu)->copies, nskb->len);
+    __skb_queue_tail(copies, nskb);
+  }
+
+  if (copy_count == 0) {
+    return 0; /* no members behind this port... leave the frame be */
+  }
+
+  mrm_counter_add(&this_cpu_ptr(group->pcpu)->converted, skb->len);
+
+  /* tell the caller whether the multicast frame itself should still go out */
+  return group->conf.original == MRMMCAST_DROP_ORIGINAL;
+}
+
+u32
+mrm_get_generation( void ) {
+  return READ_ONCE(_runconf_generation);
+}
+
+static u32
+mrm_runconf_changed( void ) {
+  WRITE_ONCE(_runconf_generation, _runconf_generation + 1);
+  return _runconf_generation;
+}
+
 unsigned
 mrm_get_filter_count( void ) {
   return mrm_rcdb_get_filter_count(); /* XXX redundant */
 }
 
 int
-mrm_get_filter( struct mrm_filter_config * const output ) {
+mrm_get_filter( struct mrm_filter_config_v2 * const output, const unsigned room ) {
   struct mrm_runconf_filter_node   *f;
+  const struct mrm_runconf_filter_rules *fr;
 
-  f = mrm_rcdb_lookup_filter_by_name(output->name);
+  f = mrm_rcdb_lookup_filter_by_name(mrm_rcdb_running(), output->name);
   if (f == NULL) return -EINVAL;
-  memcpy(output, &f->conf, sizeof(f->conf));
+  fr = rcu_dereference_protected(f->rules, 1);
+
+  output->version    = MRM_FILTER_CONFIG_V2;
+  output->rule_count = fr->rule_count;
+  if (fr->rule_count > room) return -ENOSPC; /* the caller now knows how much room it takes */
+  memcpy(output->rules, fr->rules, fr->rule_count * sizeof(fr->rules[0]));
 
   return 0; /* success */
 }
 
-int
-mrm_set_filter( const struct mrm_filter_config * const filt ) {
+static int
+mrm_store_filter( struct mrm_rcdb_table * const t, const struct mrm_filter_config_v2 * const filt ) {
   struct mrm_runconf_filter_node   *f;
+  struct mrm_runconf_filter_rules  *fr;
+  int rv;
+
+  if (filt->rule_count > MRM_FILTER_RULES_LIMIT) {
+    printk(KERN_WARNING "MRM Too many filter rules!\n");
+    return -E2BIG;
+  }
 
-  f = mrm_rcdb_insert_filter(filt->name);
-  if (f == NULL) return -ENOMEM;
+  fr = mrm_rcdb_alloc_filter_rules(filt->rules, filt->rule_count);
+  if (fr == NULL) return -ENOMEM;
 
-  memcpy(&f->conf, filt, sizeof(*filt));
-  mrm_generate_acceleration_tables(&f->accelerator, &f->conf);
-  return 0; /* success */
+  /* the ipsets the rules match on have to be there... and stay there as long as the rules do */
+  rv = mrm_ipset_get_rules(fr->rules, fr->rule_count);
+  if (rv < 0) {
+    kfree(fr);
+    return rv;
+  }
+  fr->ipset_count = rv;
+
+  f = mrm_rcdb_insert_filter(t, filt->name);
+  if (f == NULL) {
+    mrm_rcdb_free_filter_rules(fr);
+    return -ENOMEM;
+  }
+
+  /* the remaps using this filter have its rules merged into their classifiers... */
+  return mrm_rcdb_set_filter_rules(t, f, fr);
+}
+
+int
+mrm_set_filter( const struct mrm_filter_config_v2 * const filt ) {
+  int rv;
+
+  rv = mrm_store_filter(mrm_rcdb_running(), filt);
+  if (rv == 0) {
+    mrm_genl_notify_filter(MRM_GENL_CMD_SETFILTER, filt->name, filt, mrm_runconf_changed());
+  }
+  return rv;
 }
 
 int
-mrm_delete_filter( const struct mrm_filter_config * const filt ) {
+mrm_delete_filter( const char * const name ) {
   struct mrm_runconf_filter_node *f;
 
-  f = mrm_rcdb_lookup_filter_by_name(filt->name);
+  int rv;
+
+  f = mrm_rcdb_lookup_filter_by_name(mrm_rcdb_running(), name);
   if (f == NULL) return -EINVAL; /* filter not found */
-  return mrm_rcdb_delete_filter(f);
+  rv = mrm_rcdb_delete_filter(mrm_rcdb_running(), f);
+  if (rv == 0) {
+    mrm_genl_notify_filter(MRM_GENL_CMD_DELFILTER, name, NULL, mrm_runconf_changed());
+  }
+  return rv;
+}
+
+/* fn gets called for each running filter from the cursor on, with the rcu read lock held...
+   the walk stops (with the cursor on the filter) at the first non-zero return, which is passed back */
+struct mrm_walk_filters_ctx {
+  int (*fn)(const char * const, const struct mrm_filter_rule * const, const unsigned, void * const);
+  void *ctx;
+};
+
+static int
+mrm_walk_filters_one(struct mrm_runconf_filter_node * const f, void * const p) {
+  const struct mrm_walk_filters_ctx * const c = p;
+  const struct mrm_runconf_filter_rules * const fr = rcu_dereference(f->rules);
+
+  if (fr == NULL) return 0; /* just inserted, about to get its rules... skip it */
+  return c->fn(f->name, fr->rules, fr->rule_count, c->ctx);
+}
+
+int
+mrm_walk_filters(
+  struct mrm_rcdb_cursor * const cursor,
+  int (*fn)(const char * const, const struct mrm_filter_rule * const, const unsigned, void * const),
+  void * const ctx
+) {
+  struct mrm_walk_filters_ctx c;
+  int rv;
+
+  c.fn  = fn;
+  c.ctx = ctx;
+  rcu_read_lock();
+  rv = mrm_rcdb_walk_filters(cursor, &mrm_walk_filters_one, &c);
+  rcu_read_unlock();
+  return rv;
 }
 
 
@@ -268,62 +897,123 @@ mrm_get_remap_count( void ) {
   return mrm_rcdb_get_remap_count(); /* XXX redundant */
 }
 
+static void
+mrm_export_replacements( const struct mrm_runconf_replace_set * const s, struct mrm_replacement * const replace, const unsigned count ) {
+  unsigned j;
+
+  for (j = 0; j < count; ++j) {
+    memcpy(replace[j].macaddr, s->replace[j].macaddr, sizeof(s->replace[j].macaddr));
+    replace[j].weight = s->replace[j].weight;
+    replace[j].rate   = s->replace[j].rate;
+    replace[j].burst  = s->replace[j].burst;
+    strncpy(replace[j].ifname, s->replace[j].ifname, sizeof(replace[j].ifname));
+  }
+}
+
+static void
+mrm_export_remap_entry( const struct mrm_runconf_remap_entry * const r, struct mrm_remap_entry * const e) {
+  const struct mrm_runconf_remap_class *c;
+  const struct mrm_runconf_replace_set *s;
+  struct mrm_remap_class *ec;
+  unsigned i;
+
+  memcpy(e->match_macaddr, r->match_macaddr, sizeof(e->match_macaddr));
+  e->shadow       = r->shadow;
+  e->idle_timeout = r->idle_timeout;
+  e->class_count  = r->class_count;
+  for (i = 0; i < r->class_count; ++i) {
+    c  = &r->classes[i];
+    ec = &e->classes[i];
+    strncpy(ec->filter_name, c->filter->name, sizeof(ec->filter_name));
+    ec->policy = c->policy;
+    ec->spill  = c->spill;
+    ec->elephant_bytes  = c->elephant_bytes;
+    ec->elephant_window = c->elephant_window;
+
+    if (c->group != &c->own) {
+      /* just the name... the replacements are the group's */
+      strncpy(ec->group_name, c->group->name, sizeof(ec->group_name));
+      ec->replace_count = 0;
+      continue;
+    }
+    s = rcu_dereference_raw(c->own.set); /* never swapped... the class gets replaced as a whole */
+    ec->replace_count = s->replace_count;
+    mrm_export_replacements(s, ec->replace, s->replace_count);
+  }
+}
+
 int
 mrm_get_remap_entry( struct mrm_remap_entry * const e) {
   const struct mrm_runconf_remap_entry *r;
-  unsigned i;
 
   r = mrm_rcdb_lookup_remap_entry_by_macaddr(e->match_macaddr);
   if (r == NULL) return -EINVAL; /* remap entry not found */
 
-  strncpy(e->filter_name, r->filter->conf.name, sizeof(e->filter_name));
+  mrm_export_remap_entry(r, e);
+  return 0; /* success */
+}
+
+/* same as mrm_walk_filters()... fn gets handed a copy of each remap entry */
+struct mrm_walk_remaps_ctx {
+  int (*fn)(const struct mrm_remap_entry * const, void * const);
+  void *ctx;
+  struct mrm_remap_entry *e;
+};
 
-  for (i = 0; i < r-> replace_count; ++i) {
-    memcpy(e->replace[i].macaddr, r->replace[i].macaddr, sizeof(r->replace[i].macaddr));
+static int
+mrm_walk_remaps_one(struct mrm_runconf_remap_entry * const r, void * const p) {
+  const struct mrm_walk_remaps_ctx * const c = p;
 
-    /* XXX WARNING!
-       this is not currently populating the device name!!
-    */
-  }
-  return 0; /* success */
+  memset(c->e, 0, sizeof(*c->e));
+  mrm_export_remap_entry(r, c->e);
+  return c->fn(c->e, c->ctx);
 }
 
 int
-mrm_set_remap_entry( const struct mrm_remap_entry * const remap ) {
-  struct mrm_runconf_filter_node *f;
-  const unsigned char *replace_macaddrs[MRM_MAX_REPLACE];
-  struct net_device *dev[MRM_MAX_REPLACE];
-  unsigned i;
+mrm_walk_remaps(
+  struct mrm_rcdb_cursor * const cursor,
+  int (*fn)(const struct mrm_remap_entry * const, void * const),
+  void * const ctx
+) {
+  struct mrm_walk_remaps_ctx c;
   int rv;
 
-  /* initial values... */
-  memset(&dev, 0, sizeof(dev));
-  memset(&replace_macaddrs, 0, sizeof(replace_macaddrs));
-  rv = 0; /* sucess until proven otherwise */
-
-  /* validate the replacement targets... */
-  if ((remap->replace_count < 1) || (remap->replace_count > MRM_MAX_REPLACE)) {
-    printk(KERN_WARNING "MRM Bad remap replace count!\n");
-    rv = -EINVAL;
-    goto done;
+  c.fn  = fn;
+  c.ctx = ctx;
+  c.e   = kmalloc(sizeof(*c.e), GFP_KERNEL); /* too big for the kernel stack */
+  if (c.e == NULL) {
+    return -ENOMEM;
   }
 
-  /* find the specified filter by name... */
-  f = mrm_rcdb_lookup_filter_by_name(remap->filter_name);
-  if (f == NULL) {
-    /* given filter name does not exist! */
-    printk(KERN_WARNING "MRM Invalid Filter Name!\n");
-    rv = -EINVAL;
-    goto done;
-  }
+  rcu_read_lock();
+  rv = mrm_rcdb_walk_remaps(cursor, &mrm_walk_remaps_one, &c);
+  rcu_read_unlock();
+
+  kfree(c.e);
+  return rv;
+}
 
-  /* resolve the interface name & copy MAC address pointers for each given replacement... */
-  for (i = 0; i < remap->replace_count; ++i) {
-    if (remap->replace[i].ifname[0] != '\0') {
-      if (strnlen(remap->replace[i].ifname, sizeof(remap->replace[i].ifname)) == sizeof(remap->replace[i].ifname)) {
+/* validates a set of replacements and looks up their interfaces... the device references
+   taken end up in dev (the caller puts them back on failure) */
+static int
+mrm_resolve_replacements(
+  const struct mrm_replacement * const replace,
+  const unsigned count,
+  struct net_device ** const dev
+  ) {
+  unsigned i;
+
+  /* resolve the interface name for each given replacement... */
+  for (i = 0; i < count; ++i) {
+    if (replace[i].weight > MRM_MAX_REPLACE_WEIGHT) {
+      printk(KERN_WARNING "MRM Replace weight too large!\n");
+      return -EINVAL;
+    }
+
+    if (replace[i].ifname[0] != '\0') {
+      if (strnlen(replace[i].ifname, sizeof(replace[i].ifname)) == sizeof(replace[i].ifname)) {
         printk(KERN_WARNING "MRM Replace interface name too long!\n");
-        rv = -EINVAL;
-        goto done; /* sanity check to ensure the string is "\0" terminated */
+        return -EINVAL; /* sanity check to ensure the string is "\0" terminated */
       }
       /* XXX WARNING: using "&init_net" here makes it use the 
                       "main system" network namespace...
@@ -331,26 +1021,131 @@ mrm_set_remap_entry( const struct mrm_remap_entry * const remap ) {
                       a process within a container, this
                       may be a security issue... TBD...
       */
-      dev[i] = dev_get_by_name(&init_net, remap->replace[i].ifname);
+      dev[i] = dev_get_by_name(&init_net, replace[i].ifname);
       if (dev[i] == NULL) {
-        printk(KERN_WARNING "MRM Bad interface name: '%s'!\n", remap->replace[i].ifname);
-        rv = -EINVAL;
-        goto done; /* failed to lookup device by name */
+        printk(KERN_WARNING "MRM Bad interface name: '%s'!\n", replace[i].ifname);
+        return -EINVAL; /* failed to lookup device by name */
       }
     }
-    
-    replace_macaddrs[i] = remap->replace[i].macaddr;
   }
 
-  /* IMPORTANT: as of here, the reference count has been increased on dev */
+  return 0; /* success */
+}
+
+static int
+mrm_validate_remap_class(
+  struct mrm_rcdb_table * const t,
+  const struct mrm_remap_class * const cls,
+  struct mrm_runconf_filter_node ** const filter,
+  struct mrm_runconf_replace_group ** const group,
+  struct net_device ** const dev
+  ) {
+
+  /* validate the replacement targets... a named group or the class's own */
+  if (cls->group_name[0] != '\0') {
+    if (cls->replace_count != 0) {
+      printk(KERN_WARNING "MRM Remap class has both a replacement group and replacements!\n");
+      return -EINVAL;
+    }
+  }
+  else if ((cls->replace_count < 1) || (cls->replace_count > MRM_MAX_REPLACE)) {
+    printk(KERN_WARNING "MRM Bad remap replace count!\n");
+    return -EINVAL;
+  }
+
+  switch (cls->policy) {
+  case MRMREPLPOL_ROUNDROBIN:
+  case MRMREPLPOL_FLOWHASH:
+  case MRMREPLPOL_LEASTLOAD:
+  case MRMREPLPOL_REPLICATE:
+    break;
+  default:
+    printk(KERN_WARNING "MRM Bad remap replacement policy!\n");
+    return -EINVAL;
+  }
+
+  switch (cls->spill) {
+  case MRMSPILL_NEXT:
+  case MRMSPILL_UNMODIFIED:
+    break;
+  default:
+    printk(KERN_WARNING "MRM Bad remap spill action!\n");
+    return -EINVAL;
+  }
+
+  /* find the specified filter by name... */
+  *filter = mrm_rcdb_lookup_filter_by_name(t, cls->filter_name);
+  if (*filter == NULL) {
+    /* given filter name does not exist! */
+    printk(KERN_WARNING "MRM Invalid Filter Name!\n");
+    return -EINVAL;
+  }
+
+  /* the replacement group has to exist already (the staged remaps use the very same groups)... */
+  if (cls->group_name[0] != '\0') {
+    *group = mrm_rcdb_lookup_group_by_name(cls->group_name);
+    if (*group == NULL) {
+      printk(KERN_WARNING "MRM Invalid Replacement Group Name!\n");
+      return -EINVAL;
+    }
+    return 0; /* success */
+  }
+
+  return mrm_resolve_replacements(cls->replace, cls->replace_count, dev);
+}
+
+static int
+mrm_store_remap_entry( struct mrm_rcdb_table * const t, const struct mrm_remap_entry * const remap ) {
+  struct mrm_runconf_filter_node *f[MRM_MAX_CLASSES];
+  struct mrm_runconf_replace_group *g[MRM_MAX_CLASSES];
+  struct net_device *dev[MRM_MAX_CLASSES][MRM_MAX_REPLACE];
+  unsigned i, j;
+  int leastload;
+  int rv;
+
+  /* initial values... */
+  memset(&g, 0, sizeof(g));
+  memset(&dev, 0, sizeof(dev));
+  leastload = 0;
+  rv = 0; /* sucess until proven otherwise */
+
+  if ((remap->class_count < 1) || (remap->class_count > MRM_MAX_CLASSES)) {
+    printk(KERN_WARNING "MRM Bad remap class count!\n");
+    rv = -EINVAL;
+    goto done;
+  }
+
+  if (remap->idle_timeout > MRM_MAX_IDLE_TIMEOUT) {
+    printk(KERN_WARNING "MRM Bad remap idle timeout!\n");
+    rv = -EINVAL;
+    goto done;
+  }
+
+  for (i = 0; i < remap->class_count; ++i) {
+    rv = mrm_validate_remap_class(t, &remap->classes[i], &f[i], &g[i], dev[i]);
+    if (rv < 0) goto done;
+    if (remap->classes[i].policy == MRMREPLPOL_LEASTLOAD) leastload = 1;
+  }
+
+  /* IMPORTANT: as of here, the reference count has been increased on dev */
 
   /* insert/update remap entry... */
-  if (mrm_rcdb_update_remap_entry(remap->match_macaddr, f, remap->replace_count, replace_macaddrs, dev) == NULL) {
+  if (mrm_rcdb_update_remap_entry(t, remap, f, g, dev) == NULL) {
     /* failed for some reason... most likely were full */
     rv = -ENOMEM;
     goto done;
   }
 
+  /* least-load remaps need the load sampler running */
+  if (leastload) {
+    mrm_loadbal_kick();
+  }
+
+  /* ...and ones that can go idle need the aging worker running */
+  if (remap->idle_timeout > 0) {
+    mrm_aging_kick();
+  }
+
   /* note: once a remap entry is successfully inserted, it is now the 
            responsibility of "mrm_rcdb.c" to "dev_put()" the
            referenced net_device...
@@ -360,8 +1155,10 @@ mrm_set_remap_entry( const struct mrm_remap_entry * const remap ) {
 done:
   if (rv < 0) {
     /* something failed, need to cleanup any references... */
-    for (i = 0; i < (sizeof(dev) / sizeof(dev[0])); ++i) {
-      if (dev[i] != NULL) dev_put(dev[i]);
+    for (i = 0; i < MRM_MAX_CLASSES; ++i) {
+      for (j = 0; j < MRM_MAX_REPLACE; ++j) {
+        if (dev[i][j] != NULL) dev_put(dev[i][j]);
+      }
     }
   }
 
@@ -369,6 +1166,18 @@ done:
   return rv;
 }
 
+int
+mrm_set_remap_entry( const struct mrm_remap_entry * const remap ) {
+  int rv;
+
+  rv = mrm_store_remap_entry(mrm_rcdb_running(), remap);
+  if (rv == 0) {
+    mrm_elephant_forget(remap->match_macaddr); /* the classes the flows were counted for may be gone */
+    mrm_genl_notify_remap(MRM_GENL_CMD_SETREMAP, remap->match_macaddr, remap, mrm_runconf_changed());
+  }
+  return rv;
+}
+
 int
 mrm_delete_remap( const unsigned char * const macaddr ) {
   struct mrm_runconf_remap_entry *r;
@@ -379,14 +1188,463 @@ mrm_delete_remap( const unsigned char * const macaddr ) {
     return -EINVAL; /* remap entry not found */
 
   /* attempt to remove the remap entry... */
-  mrm_rcdb_delete_remap_entry(r);
+  mrm_rcdb_delete_remap_entry(mrm_rcdb_running(), r);
+  mrm_elephant_forget(macaddr);
+  mrm_genl_notify_remap(MRM_GENL_CMD_DELREMAP, macaddr, NULL, mrm_runconf_changed());
+
+  return 0; /* success */
+}
+
+/* pulls the remaps that went idle out of the running configuration, REMAP_AGING_BATCH at a time
+   with one grace period per batch... returns how many remaps with an idle timeout are left */
+#define REMAP_AGING_BATCH 64
+unsigned
+mrm_age_remaps( void ) {
+  struct mrm_runconf_remap_entry *expired[REMAP_AGING_BATCH];
+  unsigned count;
+  unsigned aging;
+  unsigned i;
+  u32 generation;
+
+  do {
+    mrm_runconf_lock();
+    count = mrm_rcdb_expire_idle_remaps(mrm_rcdb_running(), expired, REMAP_AGING_BATCH, &aging);
+    if (count > 0) {
+      generation = mrm_runconf_changed(); /* the whole batch is a single change */
+      for (i = 0; i < count; ++i) {
+        mrm_genl_notify_remap(MRM_GENL_CMD_DELREMAP, expired[i]->match_macaddr, NULL, generation);
+      }
+    }
+    mrm_runconf_unlock();
+
+    if (count == 0) break;
+
+    /* cleanup once the "critical path" is done with them... */
+    synchronize_rcu();
+    for (i = 0; i < count; ++i) {
+      mrm_rcdb_free_remap_entry(expired[i]);
+    }
+  } while (count >= REMAP_AGING_BATCH); /* the batch was full... there may be more */
+
+  return aging;
+}
+
+
+unsigned
+mrm_get_group_count( void ) {
+  return mrm_rcdb_get_group_count(); /* XXX redundant */
+}
+
+int
+mrm_get_group( struct mrm_replace_group * const output, const unsigned room ) {
+  const struct mrm_runconf_replace_group *g;
+  const struct mrm_runconf_replace_set *rs;
+
+  g = mrm_rcdb_lookup_group_by_name(output->name);
+  if (g == NULL) return -EINVAL; /* group not found */
+  rs = rcu_dereference_protected(g->set, 1);
+
+  output->replace_count = rs->replace_count;
+  if (rs->replace_count > room) return -ENOSPC; /* the caller now knows how much room it takes */
+  mrm_export_replacements(rs, output->replace, rs->replace_count);
+
+  return 0; /* success */
+}
+
+int
+mrm_set_group( const struct mrm_replace_group * const group ) {
+  struct net_device **dev;
+  unsigned i;
+  int rv;
+
+  if (group->name[0] == '\0') {
+    printk(KERN_WARNING "MRM Invalid Replacement Group Name!\n");
+    return -EINVAL;
+  }
+  if ((group->replace_count < 1) || (group->replace_count > MRM_REPLACE_GROUP_LIMIT)) {
+    printk(KERN_WARNING "MRM Bad replacement group replace count!\n");
+    return -EINVAL;
+  }
+
+  dev = kcalloc(group->replace_count, sizeof(*dev), GFP_KERNEL);
+  if (dev == NULL) {
+    return -ENOMEM;
+  }
+
+  rv = mrm_resolve_replacements(group->replace, group->replace_count, dev);
+  if (rv < 0) goto done;
+
+  /* IMPORTANT: as of here, the reference count has been increased on dev...
+                and once the group is set it is up to "mrm_rcdb.c" to "dev_put()" them */
+  if (mrm_rcdb_update_group(group->name, group->replace, group->replace_count, dev) == NULL) {
+    rv = -ENOMEM; /* most likely were full */
+    goto done;
+  }
+  mrm_loadbal_kick(); /* the least-load remaps using the group start sampling it over */
+
+  /* every remap using the group now sends its frames somewhere else... thats a change too */
+  mrm_genl_notify_group(MRM_GENL_CMD_SETGROUP, group->name, group, mrm_runconf_changed());
+
+done:
+  if (rv < 0) {
+    /* something failed, need to cleanup any references... */
+    for (i = 0; i < group->replace_count; ++i) {
+      if (dev[i] != NULL) dev_put(dev[i]);
+    }
+  }
+  kfree(dev);
+  return rv;
+}
+
+int
+mrm_delete_group( const char * const name ) {
+  struct mrm_runconf_replace_group *g;
+  int rv;
+
+  g = mrm_rcdb_lookup_group_by_name(name);
+  if (g == NULL) return -EINVAL; /* group not found */
+  rv = mrm_rcdb_delete_group(g); /* fails while remaps still use it */
+  if (rv == 0) {
+    mrm_genl_notify_group(MRM_GENL_CMD_DELGROUP, name, NULL, mrm_runconf_changed());
+  }
+  return rv;
+}
+
+/* same as mrm_walk_remaps()... fn gets handed a copy of each replacement group */
+int
+mrm_walk_groups(
+  struct mrm_rcdb_cursor * const cursor,
+  int (*fn)(const struct mrm_replace_group * const, void * const),
+  void * const ctx
+) {
+  const struct mrm_runconf_replace_set *rs;
+  struct mrm_runconf_replace_group *g;
+  struct mrm_replace_group *out;
+  int rv;
+
+  out = kmalloc(MRM_REPLACE_GROUP_SIZE(MRM_REPLACE_GROUP_LIMIT), GFP_KERNEL); /* too big for the kernel stack */
+  if (out == NULL) {
+    return -ENOMEM;
+  }
+
+  rv = 0;
+  rcu_read_lock();
+  for (g = mrm_rcdb_group_at(cursor); g != NULL; g = mrm_rcdb_next_group(g, cursor)) {
+    rs = rcu_dereference(g->set);
+    memset(out, 0, sizeof(*out));
+    strncpy(out->name, g->name, sizeof(out->name));
+    out->replace_count = rs->replace_count;
+    mrm_export_replacements(rs, out->replace, rs->replace_count);
+    rv = fn(out, ctx);
+    if (rv != 0) break;
+  }
+  rcu_read_unlock();
+
+  kfree(out);
+  return rv;
+}
+
+
+unsigned
+mrm_get_mcast_group_count( void ) {
+  return mrm_rcdb_get_mcast_group_count(); /* XXX redundant */
+}
+
+int
+mrm_get_mcast_group( struct mrm_mcast_group * const g ) {
+  const struct mrm_runconf_mcast_group *m;
+
+  m = mrm_rcdb_lookup_mcast_group_by_macaddr(g->group_macaddr);
+  if (m == NULL) return -EINVAL; /* group not found */
+  memcpy(g, &m->conf, sizeof(m->conf));
 
   return 0; /* success */
 }
 
+int
+mrm_set_mcast_group( const struct mrm_mcast_group * const g ) {
+  unsigned i;
+
+  if (!is_multicast_ether_addr(g->group_macaddr) || is_broadcast_ether_addr(g->group_macaddr)) {
+    printk(KERN_WARNING "MRM Not a multicast group MAC address!\n");
+    return -EINVAL;
+  }
+
+  switch (g->original) {
+  case MRMMCAST_DROP_ORIGINAL:
+  case MRMMCAST_KEEP_ORIGINAL:
+    break;
+  default:
+    printk(KERN_WARNING "MRM Bad multicast original frame action!\n");
+    return -EINVAL;
+  }
+
+  if ((g->member_count < 1) || (g->member_count > MRM_MAX_MCAST_MEMBERS)) {
+    printk(KERN_WARNING "MRM Bad multicast member count!\n");
+    return -EINVAL;
+  }
+
+  for (i = 0; i < g->member_count; ++i) {
+    if (is_multicast_ether_addr(g->members[i].macaddr)) {
+      printk(KERN_WARNING "MRM Multicast member MAC address must be unicast!\n");
+      return -EINVAL;
+    }
+    if (strnlen(g->members[i].ifname, sizeof(g->members[i].ifname)) == sizeof(g->members[i].ifname)) {
+      printk(KERN_WARNING "MRM Multicast member interface name too long!\n");
+      return -EINVAL; /* sanity check to ensure the string is "\0" terminated */
+    }
+    if (g->members[i].ifname[0] == '\0') {
+      /* the frame gets flooded to every port... without knowing which one the station
+         sits behind, it would get a copy from each of them */
+      printk(KERN_WARNING "MRM Multicast member bridge port is required!\n");
+      return -EINVAL;
+    }
+  }
+
+  if (mrm_rcdb_update_mcast_group(g) == NULL) {
+    return -ENOMEM; /* most likely were full */
+  }
+  mrm_genl_notify_mcast(MRM_GENL_CMD_SETMCAST, g->group_macaddr, g, mrm_runconf_changed());
+  return 0; /* success */
+}
+
+int
+mrm_delete_mcast_group( const unsigned char * const macaddr ) {
+  struct mrm_runconf_mcast_group *m;
+
+  m = mrm_rcdb_lookup_mcast_group_by_macaddr(macaddr);
+  if (m == NULL) return -EINVAL; /* group not found */
+  mrm_rcdb_delete_mcast_group(m);
+  mrm_genl_notify_mcast(MRM_GENL_CMD_DELMCAST, macaddr, NULL, mrm_runconf_changed());
+
+  return 0; /* success */
+}
+
+/* same as mrm_walk_filters()... */
+int
+mrm_walk_mcast_groups(
+  struct mrm_rcdb_cursor * const cursor,
+  int (*fn)(const struct mrm_mcast_group * const, void * const),
+  void * const ctx
+) {
+  struct mrm_runconf_mcast_group *m;
+  int rv;
+
+  rv = 0;
+  rcu_read_lock();
+  for (m = mrm_rcdb_mcast_group_at(cursor); m != NULL; m = mrm_rcdb_next_mcast_group(m, cursor)) {
+    rv = fn(&m->conf, ctx);
+    if (rv != 0) break;
+  }
+  rcu_read_unlock();
+
+  return rv;
+}
+
+
+int
+mrm_stage_begin( void ) {
+  return mrm_rcdb_stage_begin();
+}
+
+int
+mrm_stage_filter( const struct mrm_filter_config_v2 * const filt ) {
+  struct mrm_rcdb_table * const t = mrm_rcdb_staged();
+
+  if (t == NULL) return -EINVAL; /* mrm_stage_begin() first */
+  return mrm_store_filter(t, filt);
+}
+
+int
+mrm_stage_remap_entry( const struct mrm_remap_entry * const remap ) {
+  struct mrm_rcdb_table * const t = mrm_rcdb_staged();
+
+  if (t == NULL) return -EINVAL; /* mrm_stage_begin() first */
+  return mrm_store_remap_entry(t, remap); /* note: the filters it refers to must be staged first */
+}
+
+int
+mrm_stage_commit( void ) {
+  int rv;
+
+  rv = mrm_rcdb_stage_commit();
+  if (rv == 0) {
+    mrm_loadbal_kick(); /* in case any of the new remaps are least-load... it goes idle again if not */
+    mrm_aging_kick();   /* ...or can go idle */
+    mrm_elephant_flush(); /* every remap may have different classes now */
+    mrm_genl_notify_resync(mrm_runconf_changed());
+  }
+  return rv;
+}
+
+void
+mrm_stage_abort( void ) {
+  mrm_rcdb_stage_abort();
+}
+
+
+void
+mrm_get_stats( struct mrm_stats * const output ) {
+  mrm_stats_get(output); /* XXX redundant */
+}
+
+int
+mrm_get_remap_stats( struct mrm_remap_stats * const output, const unsigned room ) {
+  const struct mrm_runconf_remap_entry *r;
+  const struct mrm_runconf_filter_rules *fr[MRM_MAX_CLASSES];
+  const struct mrm_runconf_replace_set *rs[MRM_MAX_CLASSES];
+  const struct mrm_runconf_classifier *rc;
+  const struct mrm_classifier_ruleref *ref;
+  unsigned first[MRM_MAX_CLASSES]; /* where the counters of each class start */
+  unsigned rate_first;
+  unsigned rule_idx;
+  unsigned cpu, i, j;
+  int rv;
+
+  /* no runconf mutex here... the rules and replacements of each class are looked at just once,
+     so the counts given back and the counters filled in go together even if they change meanwhile */
+  rcu_read_lock();
+  r = mrm_rcdb_lookup_remap_entry_by_macaddr(output->match_macaddr);
+  if (r == NULL) {
+    rv = -EINVAL; /* remap entry not found */
+    goto out;
+  }
+  rc = rcu_dereference(r->classifier);
+
+  output->shadow        = r->shadow;
+  output->class_count   = r->class_count;
+  output->counter_count = 0;
+  for (i = 0; i < r->class_count; ++i) {
+    fr[i] = rcu_dereference(r->classes[i].filter->rules);
+    rs[i] = rcu_dereference(r->classes[i].group->set);
+    output->classes[i].rule_count    = fr[i]->rule_count;
+    output->classes[i].replace_count = rs[i]->replace_count;
+    first[i] = output->counter_count;
+    output->counter_count += output->classes[i].rule_count + output->classes[i].replace_count;
+  }
+  rate_first = output->counter_count; /* the spilled/duplicated counters come after all the classes */
+  for (i = 0; i < r->class_count; ++i) {
+    output->counter_count += 2 * output->classes[i].replace_count;
+  }
+  if (output->counter_count > room) {
+    rv = -ENOSPC; /* the caller now knows how much room it takes */
+    goto out;
+  }
+  memset(output->counters, 0, output->counter_count * sizeof(output->counters[0]));
+
+  /* the matches are counted per rule reference of the merged classifier... a rule may have a few of them */
+  for (i = 0; i < rc->ref_count; ++i) {
+    ref = &rc->refs[i];
+    rule_idx = ref->rule - fr[ref->class_idx]->rules;
+    if (rule_idx >= fr[ref->class_idx]->rule_count) continue; /* the rules just changed, the classifier is about to follow */
+    for_each_possible_cpu(cpu) {
+      mrm_counter_read(&per_cpu_ptr(rc->ref_pcpu, cpu)[i], &output->counters[first[ref->class_idx] + rule_idx]);
+    }
+  }
+
+  for (i = 0; i < r->class_count; ++i) {
+    for (j = 0; j < rs[i]->replace_count; ++j) {
+      for_each_possible_cpu(cpu) {
+        mrm_counter_read(r->shadow ? &per_cpu_ptr(rs[i]->replace_pcpu, cpu)[j].shadow : &per_cpu_ptr(rs[i]->replace_pcpu, cpu)[j].tx,
+                         &output->counters[first[i] + output->classes[i].rule_count + j]);
+        mrm_counter_read(&per_cpu_ptr(rs[i]->replace_pcpu, cpu)[j].spilled, &output->counters[rate_first + (2 * j)]);
+        mrm_counter_read(&per_cpu_ptr(rs[i]->replace_pcpu, cpu)[j].dup, &output->counters[rate_first + (2 * j) + 1]);
+      }
+    }
+    rate_first += 2 * rs[i]->replace_count;
+  }
+  rv = 0; /* success */
+
+out:
+  rcu_read_unlock();
+  return rv;
+}
+
+static void
+mrm_reset_replace_set_stats( struct mrm_runconf_replace_set * const rs ) {
+  unsigned cpu, j;
+
+  for_each_possible_cpu(cpu) {
+    for (j = 0; j < rs->replace_count; ++j) {
+      mrm_counter_reset(&per_cpu_ptr(rs->replace_pcpu, cpu)[j].tx);
+      mrm_counter_reset(&per_cpu_ptr(rs->replace_pcpu, cpu)[j].shadow);
+      mrm_counter_reset(&per_cpu_ptr(rs->replace_pcpu, cpu)[j].spilled);
+      mrm_counter_reset(&per_cpu_ptr(rs->replace_pcpu, cpu)[j].dup);
+    }
+  }
+}
+
+static void
+mrm_reset_remap_stats( struct mrm_runconf_remap_entry * const r, void * const ctx ) {
+  struct mrm_runconf_classifier * const rc = rcu_dereference_protected(r->classifier, 1);
+  struct mrm_runconf_remap_class *c;
+  unsigned cpu, i;
+
+  for_each_possible_cpu(cpu) {
+    for (i = 0; i < rc->ref_count; ++i) {
+      mrm_counter_reset(&per_cpu_ptr(rc->ref_pcpu, cpu)[i]);
+    }
+  }
+  for (i = 0; i < r->class_count; ++i) {
+    c = &r->classes[i];
+    if (c->group != &c->own) continue; /* the named groups get theirs reset on their own */
+    mrm_reset_replace_set_stats(rcu_dereference_protected(c->own.set, 1));
+  }
+}
+
+int
+mrm_get_mcast_stats( struct mrm_mcast_stats * const output ) {
+  const struct mrm_runconf_mcast_group *m;
+  unsigned cpu;
+
+  rcu_read_lock();
+  m = mrm_rcdb_lookup_mcast_group_by_macaddr(output->group_macaddr);
+  if (m == NULL) {
+    rcu_read_unlock();
+    return -EINVAL; /* group not found */
+  }
+
+  memset(&output->converted, 0, sizeof(output->converted));
+  memset(&output->copies, 0, sizeof(output->copies));
+  for_each_possible_cpu(cpu) {
+    mrm_counter_read(&per_cpu_ptr(m->pcpu, cpu)->converted, &output->converted);
+    mrm_counter_read(&per_cpu_ptr(m->pcpu, cpu)->copies, &output->copies);
+  }
+  rcu_read_unlock();
+  return 0; /* success */
+}
+
+void
+mrm_reset_stats( void ) {
+  struct mrm_runconf_replace_group *g;
+  struct mrm_runconf_mcast_group *m;
+  struct mrm_rcdb_cursor cursor;
+  unsigned cpu;
+
+  mrm_stats_reset();
+
+  rcu_read_lock();
+  mrm_rcdb_foreach_remap_entry(&mrm_reset_remap_stats, NULL);
+  memset(&cursor, 0, sizeof(cursor));
+  for (g = mrm_rcdb_group_at(&cursor); g != NULL; g = mrm_rcdb_next_group(g, &cursor)) {
+    mrm_reset_replace_set_stats(rcu_dereference(g->set));
+  }
+  memset(&cursor, 0, sizeof(cursor));
+  for (m = mrm_rcdb_mcast_group_at(&cursor); m != NULL; m = mrm_rcdb_next_mcast_group(m, &cursor)) {
+    for_each_possible_cpu(cpu) {
+      mrm_counter_reset(&per_cpu_ptr(m->pcpu, cpu)->converted);
+      mrm_counter_reset(&per_cpu_ptr(m->pcpu, cpu)->copies);
+    }
+  }
+  rcu_read_unlock();
+}
+
 
 void mrm_destroy_remapper_config( void ) {
   mrm_rcdb_clear(); /* XXX redundant */
+  mrm_flowtable_flush(); /* pinned flows dont survive a wipe */
+  mrm_elephant_flush(); /* ...nor do elephants */
+  mrm_genl_notify_resync(mrm_runconf_changed());
 }
 
 
@@ -394,12 +1652,12 @@ void mrm_destroy_remapper_config( void ) {
 
 
 
-#include "./bufprintf.h"
+#include <linux/seq_file.h>
 
 
 static void
-dump_single_mac_address(struct bufprintf_buf * const tb, const unsigned char * const macaddr) {
-  bufprintf(tb, "%02X:%02X:%02X:%02X:%02X:%02X\n",
+dump_single_mac_address(struct seq_file * const sf, const unsigned char * const macaddr) {
+  seq_printf(sf, "%02X:%02X:%02X:%02X:%02X:%02X\n",
             (unsigned)macaddr[0],
             (unsigned)macaddr[1],
             (unsigned)macaddr[2],
@@ -410,11 +1668,11 @@ dump_single_mac_address(struct bufprintf_buf * const tb, const unsigned char * c
 }
 
 static void
-dump_single_ip(struct bufprintf_buf * const tb, const int family, const unsigned char * const ip) {
+dump_single_ip(struct seq_file * const sf, const int family, const unsigned char * const ip) {
 
   switch (family) {
   case AF_INET:
-    bufprintf(tb, "%u.%u.%u.%u",
+    seq_printf(sf, "%u.%u.%u.%u",
               (unsigned) ip[0],
               (unsigned) ip[1],
               (unsigned) ip[2],
@@ -422,7 +1680,7 @@ dump_single_ip(struct bufprintf_buf * const tb, const int family, const unsigned
     );
     break;
   case AF_INET6:
-    bufprintf(tb, "[%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X]",
+    seq_printf(sf, "[%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X]",
               (unsigned) ip[0],
               (unsigned) ip[1],
               (unsigned) ip[2],
@@ -442,149 +1700,436 @@ dump_single_ip(struct bufprintf_buf * const tb, const int family, const unsigned
     );
     break;
   default:
-    bufprintf(tb, "bad_family");
+    seq_printf(sf, "bad_family");
     break;
   }
 }
 
 static void
-dump_single_port_filter(struct bufprintf_buf * const tb, const struct mrm_port_filter * const pf) {
+dump_single_port_filter(struct seq_file * const sf, const struct mrm_port_filter * const pf) {
   switch (pf->match_type) {
   case MRMPORTFILT_MATCHANY:
-    bufprintf(tb, "any");
+    seq_printf(sf, "any");
     break;
   case MRMPORTFILT_MATCHSINGLE:
-    bufprintf(tb, "%hu", pf->portno);
+    seq_printf(sf, "%hu", pf->portno);
     break;
   case MRMPORTFILT_MATCHRANGE:
-    bufprintf(tb, "%hu-%hu", pf->low_portno, pf->high_portno);
+    seq_printf(sf, "%hu-%hu", pf->low_portno, pf->high_portno);
     break;
   default:
-    bufprintf(tb, "unknown");
+    seq_printf(sf, "unknown");
     break;
   }
 }
 
 static void
-dump_single_ruleset(struct bufprintf_buf * const tb, const char * const text, const struct mrm_filter_rulerefset * const ruleset) {
+dump_single_rule(struct seq_file * const sf, const struct mrm_filter_rule * const rule) {
+  seq_printf(sf, "      ");
+  seq_printf(sf, "payload_size=%u", rule->payload_size);
+  seq_printf(sf, " family=");
+  switch(rule->family) {
+  case AF_UNSPEC: seq_printf(sf, "AF_UNSPEC"); break;
+  case AF_INET:   seq_printf(sf, "AF_INET"); break;
+  case AF_INET6:  seq_printf(sf, "AF_INET6"); break;
+  default:        seq_printf(sf, "Unknown(%d)", rule->family); break;
+  }
+
+  seq_printf(sf, " proto=");
+  if ((rule->proto.match_type & MRMIPPFILT_MATCHUDP) == MRMIPPFILT_MATCHUDP) {
+    seq_printf(sf, "udp");
+  }
+  else if ((rule->proto.match_type & MRMIPPFILT_MATCHTCP) == MRMIPPFILT_MATCHTCP) {
+    seq_printf(sf, "tcp");
+  }
+  else if ((rule->proto.match_type & (~MRMIPPFILT_MATCHFAMILY)) == MRMIPPFILT_MATCHANY) {
+    seq_printf(sf, "any");
+  }
+  else {
+    seq_printf(sf, "unknown");
+  }
+  if ((rule->proto.match_type & MRMIPPFILT_MATCHFAMILY) == MRMIPPFILT_MATCHFAMILY) {
+    seq_printf(sf, "%d", (rule->family == AF_INET) ? 4 : 6);
+  }
+
+  seq_printf(sf, " srcip=");
+  switch(rule->src_ipaddr.match_type) {
+  case MRMIPFILT_MATCHANY: seq_printf(sf, "any"); break;
+  case MRMIPFILT_MATCHSINGLE: 
+    dump_single_ip(sf, rule->family, (rule->family == AF_INET) ? (const void*)&rule->src_ipaddr.ipaddr4       : (const void*)&rule->src_ipaddr.ipaddr6);
+    break;
+  case MRMIPFILT_MATCHSUBNET: 
+    dump_single_ip(sf, rule->family, (rule->family == AF_INET) ? (const void*)&rule->src_ipaddr.ipaddr4       : (const void*)&rule->src_ipaddr.ipaddr6);
+    seq_printf(sf, "/");
+    dump_single_ip(sf, rule->family, (rule->family == AF_INET) ? (const void*)&rule->src_ipaddr.ipaddr4_mask  : (const void*)&rule->src_ipaddr.ipaddr6_mask);
+    break;
+  case MRMIPFILT_MATCHRANGE: 
+    dump_single_ip(sf, rule->family, (rule->family == AF_INET) ? (const void*)&rule->src_ipaddr.ipaddr4_start : (const void*)&rule->src_ipaddr.ipaddr6_start);
+    seq_printf(sf, "-");
+    dump_single_ip(sf, rule->family, (rule->family == AF_INET) ? (const void*)&rule->src_ipaddr.ipaddr4_end   : (const void*)&rule->src_ipaddr.ipaddr6_end);
+    break;
+  case MRMIPFILT_MATCHIPSET:
+    seq_printf(sf, "ipset:%.*s", (int)sizeof(rule->src_ipaddr.ipset_name), rule->src_ipaddr.ipset_name);
+    break;
+  }
+
+  seq_printf(sf, " srcport=");
+  dump_single_port_filter(sf, &rule->src_port);
+
+  seq_printf(sf, " dstport=");
+  dump_single_port_filter(sf, &rule->dst_port);
+
+  seq_printf(sf, "\n");
+}
+
+static void
+dump_single_ruleset(struct seq_file * const sf, const char * const text, const struct mrm_filter_rulerefset * const ruleset) {
 
   unsigned i;
-  const struct mrm_filter_rule *rule;
 
-  bufprintf(tb, "    \"%s Rules\" (Total Count %u):\n", text, ruleset->rules_active);
+  seq_printf(sf, "    \"%s Rules\" (Total Count %u):\n", text, ruleset->rules_active);
 
   for ( i = 0; i < ruleset->rules_active; i++) {
-    rule = ruleset->rules[i];
-    bufprintf(tb, "      ");
-    bufprintf(tb, "payload_size=%u", rule->payload_size);
-    bufprintf(tb, " family=");
-    switch(rule->family) {
-    case AF_UNSPEC: bufprintf(tb, "AF_UNSPEC"); break;
-    case AF_INET:   bufprintf(tb, "AF_INET"); break;
-    case AF_INET6:  bufprintf(tb, "AF_INET6"); break;
-    default:        bufprintf(tb, "Unknown(%d)", rule->family); break;
-    }
+    dump_single_rule(sf, ruleset->rules[i]);
+  }
+}
 
-    bufprintf(tb, " proto=");
-    if ((rule->proto.match_type & MRMIPPFILT_MATCHUDP) == MRMIPPFILT_MATCHUDP) {
-      bufprintf(tb, "udp");
+static void
+dump_single_filter(struct seq_file * const sf, const struct mrm_runconf_filter_node * const f) {
+  const struct mrm_runconf_filter_rules * const fr = rcu_dereference(f->rules);
+  unsigned i;
+
+  seq_printf(sf, "    Name: %.*s\n", (int)sizeof(f->name), f->name);
+  seq_printf(sf, "    Remap Reference Count: %d\n", atomic_read(&f->refcnt));
+  if (fr == NULL) {
+    seq_printf(sf, "\n");
+    return; /* just inserted, about to get its rules */
+  }
+  seq_printf(sf, "    Total Rule Count: %u\n", fr->rule_count);
+  seq_printf(sf, "    \"All Configured Rules\" (Total Count %u):\n", fr->rule_count);
+  for (i = 0; i < fr->rule_count; i++) {
+    dump_single_rule(sf, &fr->rules[i]);
+  }
+  dump_single_ruleset(sf, "TCP/IP4-Only", &fr->accelerator.ip4_targeted_rules.tcp_targeted_rules);
+  dump_single_ruleset(sf, "UDP/IP4-Only", &fr->accelerator.ip4_targeted_rules.udp_targeted_rules);
+  dump_single_ruleset(sf, "Other/IP4-Only", &fr->accelerator.ip4_targeted_rules.other_targeted_rules);
+  dump_single_ruleset(sf, "TCP/IP6-Only", &fr->accelerator.ip6_targeted_rules.tcp_targeted_rules);
+  dump_single_ruleset(sf, "UDP/IP6-Only", &fr->accelerator.ip6_targeted_rules.udp_targeted_rules);
+  dump_single_ruleset(sf, "Other/IP6-Only", &fr->accelerator.ip6_targeted_rules.other_targeted_rules);
+  seq_printf(sf, "\n");
+}
+
+static void
+dump_single_replace_set(struct seq_file * const sf, const struct mrm_runconf_replace_set * const rs, const int with_duplicated, const int with_load, const int with_shadow) {
+  const struct mrm_runconf_replace_live *live;
+  const struct net_device               *dev;
+  struct mrm_counter                     sent;
+  unsigned                               cpu;
+  unsigned                               j;
+
+  live = rcu_dereference(rs->live);
+  seq_printf(sf, "      Replacements: (Total Count %u)\n", rs->replace_count);
+  for (j = 0; j <  rs->replace_count; ++j) {
+    seq_printf(sf, "        MAC Address %u: ", j);
+    dump_single_mac_address(sf, rs->replace[j].macaddr);
+    seq_printf(sf, "        Weight %u: %u\n", j, rs->replace[j].weight);
+    memset(&sent, 0, sizeof(sent));
+    for_each_possible_cpu(cpu) {
+      mrm_counter_read(&per_cpu_ptr(rs->replace_pcpu, cpu)[j].tx, &sent);
+    }
+    seq_printf(sf, "        Sent %u: %llu frames, %llu bytes\n", j, (unsigned long long)sent.frames, (unsigned long long)sent.bytes);
+    if (with_shadow) {
+      memset(&sent, 0, sizeof(sent));
+      for_each_possible_cpu(cpu) {
+        mrm_counter_read(&per_cpu_ptr(rs->replace_pcpu, cpu)[j].shadow, &sent);
+      }
+      seq_printf(sf, "        Would Send %u: %llu frames, %llu bytes\n", j, (unsigned long long)sent.frames, (unsigned long long)sent.bytes);
+    }
+    if (rs->replace[j].rate > 0) {
+      memset(&sent, 0, sizeof(sent));
+      for_each_possible_cpu(cpu) {
+        mrm_counter_read(&per_cpu_ptr(rs->replace_pcpu, cpu)[j].spilled, &sent);
+      }
+      seq_printf(sf, "        Rate Limit %u: %u bytes/s (burst %u bytes), %llu frames, %llu bytes spilled\n", j, rs->replace[j].rate, rs->replace[j].burst,
+                 (unsigned long long)sent.frames, (unsigned long long)sent.bytes);
+    }
+    if (with_duplicated) {
+      memset(&sent, 0, sizeof(sent));
+      for_each_possible_cpu(cpu) {
+        mrm_counter_read(&per_cpu_ptr(rs->replace_pcpu, cpu)[j].dup, &sent);
+      }
+      seq_printf(sf, "        Duplicated %u: %llu frames, %llu bytes\n", j, (unsigned long long)sent.frames, (unsigned long long)sent.bytes);
     }
-    else if ((rule->proto.match_type & MRMIPPFILT_MATCHTCP) == MRMIPPFILT_MATCHTCP) {
-      bufprintf(tb, "tcp");
+    if (with_load) {
+      seq_printf(sf, "        Recent Load %u: %lu bytes/s\n", j, (rs->replace[j].load_ewma * 1000) / max(mrm_load_sample_interval, 1U));
     }
-    else if ((rule->proto.match_type & (~MRMIPPFILT_MATCHFAMILY)) == MRMIPPFILT_MATCHANY) {
-      bufprintf(tb, "any");
+    seq_printf(sf, "        Interface %u: ", j);
+    dev = READ_ONCE(rs->replace[j].dev); /* the netdevice notifier may be letting go of it... not until after a grace period though */
+    if (rs->replace[j].ifname[0] == '\0') {
+      seq_printf(sf, "(None)\n");
+    }
+    else if (dev == NULL) {
+      seq_printf(sf, "%.*s (not registered)\n", (int)sizeof(rs->replace[j].ifname), rs->replace[j].ifname);
     }
     else {
-      bufprintf(tb, "unknown");
+      seq_printf(sf, "%.*s\n", (int)sizeof(dev->name), dev->name);
+    }
+    seq_printf(sf, "        Live %u: %s\n", j, test_bit(j, live->mask) ? "yes" : "no");
+  }
+}
+
+static void
+dump_single_remap_entry(struct seq_file * const sf, const struct mrm_runconf_remap_entry * const r) {
+  unsigned k;
+  const struct mrm_runconf_remap_class  *c;
+  const struct mrm_runconf_replace_set  *rs;
+  const struct mrm_runconf_classifier   *rc;
+
+  rc = rcu_dereference(r->classifier);
+
+  seq_printf(sf, "    Match MAC Address: ");
+  dump_single_mac_address(sf, r->match_macaddr);
+  if (r->shadow) {
+    seq_printf(sf, "    Shadow Mode: yes (frames left unmodified)\n");
+  }
+  if (r->idle_timeout > 0) {
+    seq_printf(sf, "    Idle Timeout: %u s (idle for %u s)\n", r->idle_timeout,
+               jiffies_to_msecs(jiffies - READ_ONCE(r->last_hit)) / 1000);
+  }
+  if (rc != NULL) {
+    seq_printf(sf, "    Classifier Rules: TCP/IP4 %u, UDP/IP4 %u, Other/IP4 %u, TCP/IP6 %u, UDP/IP6 %u, Other/IP6 %u\n",
+               rc->classifier.ip4_targeted_rules.tcp_targeted_rules.rules_active,
+               rc->classifier.ip4_targeted_rules.udp_targeted_rules.rules_active,
+               rc->classifier.ip4_targeted_rules.other_targeted_rules.rules_active,
+               rc->classifier.ip6_targeted_rules.tcp_targeted_rules.rules_active,
+               rc->classifier.ip6_targeted_rules.udp_targeted_rules.rules_active,
+               rc->classifier.ip6_targeted_rules.other_targeted_rules.rules_active
+    );
+  }
+  seq_printf(sf, "    Classes: (Total Count %u)\n", r->class_count);
+  for (k = 0; k < r->class_count; ++k) {
+    c = &r->classes[k];
+    rs = rcu_dereference(c->group->set);
+
+    seq_printf(sf, "    Class %u:\n", k);
+    seq_printf(sf, "      Filter: %.*s\n", (int)sizeof(c->filter->name), c->filter->name);
+    seq_printf(sf, "      Replacement Policy: ");
+    switch (c->policy) {
+    case MRMREPLPOL_ROUNDROBIN: seq_printf(sf, "roundrobin\n"); break;
+    case MRMREPLPOL_FLOWHASH:   seq_printf(sf, "flowhash\n"); break;
+    case MRMREPLPOL_LEASTLOAD:  seq_printf(sf, "leastload (currently %u)\n", rs->replace_best); break;
+    case MRMREPLPOL_REPLICATE:  seq_printf(sf, "replicate\n"); break;
+    default:                    seq_printf(sf, "unknown\n"); break;
     }
-    if ((rule->proto.match_type & MRMIPPFILT_MATCHFAMILY) == MRMIPPFILT_MATCHFAMILY) {
-      bufprintf(tb, "%d", (rule->family == AF_INET) ? 4 : 6);
+    seq_printf(sf, "      Rate Limit Spill: %s\n", (c->spill == MRMSPILL_NEXT) ? "next" : "unmodified");
+    if (c->elephant_bytes > 0) {
+      seq_printf(sf, "      Elephant Flows Only: %u bytes within %u ms\n", c->elephant_bytes, c->elephant_window);
     }
+    if (c->group != &c->own) {
+      /* listed once with the group itself... */
+      seq_printf(sf, "      Replacement Group: %.*s (Total Count %u)\n", (int)sizeof(c->group->name), c->group->name, rs->replace_count);
+      continue;
+    }
+    dump_single_replace_set(sf, rs, c->policy == MRMREPLPOL_REPLICATE, c->policy == MRMREPLPOL_LEASTLOAD, r->shadow);
+  }
+
+  seq_printf(sf, "\n");
+}
+
+static void
+dump_single_group(struct seq_file * const sf, const struct mrm_runconf_replace_group * const g) {
+  seq_printf(sf, "    Name: %.*s\n", (int)sizeof(g->name), g->name);
+  seq_printf(sf, "    Remap Reference Count: %d\n", atomic_read(&g->refcnt));
+  dump_single_replace_set(sf, rcu_dereference(g->set), 1, 1, 1); /* shared... whatever the policies (and modes) of the classes using it */
+  seq_printf(sf, "\n");
+}
+
+static void
+dump_single_mcast_group(struct seq_file * const sf, const struct mrm_runconf_mcast_group * const m) {
+  struct mrm_counter converted, copies;
+  unsigned cpu;
+  unsigned j;
+
+  memset(&converted, 0, sizeof(converted));
+  memset(&copies, 0, sizeof(copies));
+  for_each_possible_cpu(cpu) {
+    mrm_counter_read(&per_cpu_ptr(m->pcpu, cpu)->converted, &converted);
+    mrm_counter_read(&per_cpu_ptr(m->pcpu, cpu)->copies, &copies);
+  }
 
-    bufprintf(tb, " srcip=");
-    switch(rule->src_ipaddr.match_type) {
-    case MRMIPFILT_MATCHANY: bufprintf(tb, "any"); break;
-    case MRMIPFILT_MATCHSINGLE: 
-      dump_single_ip(tb, rule->family, (rule->family == AF_INET) ? (const void*)&rule->src_ipaddr.ipaddr4       : (const void*)&rule->src_ipaddr.ipaddr6);
+  seq_printf(sf, "    Group MAC Address: ");
+  dump_single_mac_address(sf, m->conf.group_macaddr);
+  seq_printf(sf, "    Original Frame: %s\n", (m->conf.original == MRMMCAST_KEEP_ORIGINAL) ? "kept" : "dropped");
+  seq_printf(sf, "    Converted: %llu frames into %llu copies (%llu bytes)\n",
+             (unsigned long long)converted.frames, (unsigned long long)copies.frames, (unsigned long long)copies.bytes);
+  seq_printf(sf, "    Members: (Total Count %u)\n", m->conf.member_count);
+  for (j = 0; j < m->conf.member_count; ++j) {
+    seq_printf(sf, "      MAC Address %u: ", j);
+    dump_single_mac_address(sf, m->conf.members[j].macaddr);
+    seq_printf(sf, "      Port %u: %.*s%s\n", j, (int)sizeof(m->conf.members[j].ifname), m->conf.members[j].ifname,
+               (READ_ONCE(m->ifindex[j]) != 0) ? "" : " (not registered)");
+  }
+  seq_printf(sf, "\n");
+}
+
+
+/* the running configuration dump is a seq_file with a record per filter, remap entry, replacement group and multicast group
+   (plus the section headings)... it is walked under the rcu read lock only, so reading it never holds
+   up configuration changes, and the cursor lets each read() pick up where the last one left off */
+enum {
+  MRM_SHOW_HEADER = 0,
+  MRM_SHOW_FILTERS,
+  MRM_SHOW_REMAPS_HEADER,
+  MRM_SHOW_REMAPS,
+  MRM_SHOW_GROUPS_HEADER,
+  MRM_SHOW_GROUPS,
+  MRM_SHOW_MCASTS_HEADER,
+  MRM_SHOW_MCASTS,
+  MRM_SHOW_END,
+};
+
+struct mrm_show_iter {
+  loff_t                     pos;      /* the position of the record the cursor is on */
+  unsigned                   section;  /* MRM_SHOW_* */
+  struct mrm_rcdb_cursor     cursor;   /* within the section */
+  struct mrm_rcdb_table     *t;        /* these two are only good between start() and stop() */
+  void                      *entry;
+};
+
+/* finds the record the cursor is on... moving on to the following sections if this one has run out */
+static void *
+mrm_show_locate(struct mrm_show_iter * const it) {
+  for (;;) {
+    switch (it->section) {
+    case MRM_SHOW_HEADER:
+    case MRM_SHOW_REMAPS_HEADER:
+      it->entry = NULL;
+      return it;
+    case MRM_SHOW_FILTERS:
+      it->entry = mrm_rcdb_filter_at(it->t, &it->cursor);
+      break;
+    case MRM_SHOW_REMAPS:
+      it->entry = mrm_rcdb_remap_entry_at(it->t, &it->cursor);
       break;
-    case MRMIPFILT_MATCHSUBNET: 
-      dump_single_ip(tb, rule->family, (rule->family == AF_INET) ? (const void*)&rule->src_ipaddr.ipaddr4       : (const void*)&rule->src_ipaddr.ipaddr6);
-      bufprintf(tb, "/");
-      dump_single_ip(tb, rule->family, (rule->family == AF_INET) ? (const void*)&rule->src_ipaddr.ipaddr4_mask  : (const void*)&rule->src_ipaddr.ipaddr6_mask);
+    case MRM_SHOW_GROUPS_HEADER:
+    case MRM_SHOW_GROUPS:
+      it->entry = mrm_rcdb_group_at(&it->cursor); /* the heading only shows up if there are any */
       break;
-    case MRMIPFILT_MATCHRANGE: 
-      dump_single_ip(tb, rule->family, (rule->family == AF_INET) ? (const void*)&rule->src_ipaddr.ipaddr4_start : (const void*)&rule->src_ipaddr.ipaddr6_start);
-      bufprintf(tb, "-");
-      dump_single_ip(tb, rule->family, (rule->family == AF_INET) ? (const void*)&rule->src_ipaddr.ipaddr4_end   : (const void*)&rule->src_ipaddr.ipaddr6_end);
+    case MRM_SHOW_MCASTS_HEADER:
+    case MRM_SHOW_MCASTS:
+      it->entry = mrm_rcdb_mcast_group_at(&it->cursor); /* the heading only shows up if there are any */
       break;
+    default:
+      return NULL; /* all done */
     }
+    if (it->entry != NULL) return it;
 
-    bufprintf(tb, " srcport=");
-    dump_single_port_filter(tb, &rule->src_port);
+    ++it->section;
+    memset(&it->cursor, 0, sizeof(it->cursor));
+  }
+}
 
-    bufprintf(tb, " dstport=");
-    dump_single_port_filter(tb, &rule->dst_port);
+static void *
+mrm_show_next(struct seq_file *sf, void *v, loff_t *pos) {
+  struct mrm_show_iter * const it = sf->private;
 
-    bufprintf(tb, "\n");
+  it->pos = ++(*pos);
+  switch (it->section) {
+  case MRM_SHOW_FILTERS:
+    it->entry = mrm_rcdb_next_filter(it->t, it->entry, &it->cursor);
+    break;
+  case MRM_SHOW_REMAPS:
+    it->entry = mrm_rcdb_next_remap_entry(it->t, it->entry, &it->cursor);
+    break;
+  case MRM_SHOW_GROUPS:
+    it->entry = mrm_rcdb_next_group(it->entry, &it->cursor);
+    break;
+  case MRM_SHOW_MCASTS:
+    it->entry = mrm_rcdb_next_mcast_group(it->entry, &it->cursor);
+    break;
+  default:
+    it->entry = NULL; /* headings are a single record */
+    break;
   }
+  if (it->entry != NULL) return it;
+
+  ++it->section;
+  memset(&it->cursor, 0, sizeof(it->cursor));
+  return mrm_show_locate(it);
 }
 
-void
-mrm_bufprintf_running_configuration(struct bufprintf_buf * const tb) {
-  unsigned i,j;
-  unsigned filter_count;
-  unsigned remap_count;
-  const struct mrm_runconf_filter_node  *f;
-  const struct mrm_runconf_remap_entry  *r;
-  struct mrm_filter_rulerefset           all_rrs;
-
-  bufprintf(tb, "MAC Address Re-Mapper Running Configuration:\n");
-
-  filter_count = mrm_get_filter_count();
-  bufprintf(tb, "  Filters: (Total Count %u)\n", filter_count);
-  for (i = 0; i < filter_count; i++) {
-    f = mrm_rcdb_lookup_filter_by_index(i);
-
-    all_rrs.rules_active = f->conf.rules_active;
-    for (j = 0; j < all_rrs.rules_active; j++) {
-      all_rrs.rules[j] = &f->conf.rules[j];
-    }
-
-    bufprintf(tb, "    Name: %.*s\n", (int)sizeof(f->conf.name), f->conf.name);
-    bufprintf(tb, "    Remap Reference Count: %u\n", f->refcnt);
-    bufprintf(tb, "    Total Rule Count: %u\n", f->conf.rules_active);
-    dump_single_ruleset(tb, "All Configured", &all_rrs);
-    dump_single_ruleset(tb, "TCP/IP4-Only", &f->accelerator.ip4_targeted_rules.tcp_targeted_rules);
-    dump_single_ruleset(tb, "UDP/IP4-Only", &f->accelerator.ip4_targeted_rules.udp_targeted_rules);
-    dump_single_ruleset(tb, "Other/IP4-Only", &f->accelerator.ip4_targeted_rules.other_targeted_rules);
-    dump_single_ruleset(tb, "TCP/IP6-Only", &f->accelerator.ip6_targeted_rules.tcp_targeted_rules);
-    dump_single_ruleset(tb, "UDP/IP6-Only", &f->accelerator.ip6_targeted_rules.udp_targeted_rules);
-    dump_single_ruleset(tb, "Other/IP6-Only", &f->accelerator.ip6_targeted_rules.other_targeted_rules);
-    bufprintf(tb, "\n");
-  }
-  remap_count = mrm_get_remap_count();
-  bufprintf(tb, "  Remap Entries: (Total Count %u)\n", remap_count);
-  for(i = 0; i < remap_count; i++) {
-    r = mrm_rcdb_lookup_remap_entry_by_index(i);
-
-    bufprintf(tb, "    Match MAC Address: ");
-    dump_single_mac_address(tb, r->match_macaddr);
-    bufprintf(tb, "    Replacements: (Total Count %u)\n", r->replace_count);
-    for (j = 0; j <  r->replace_count; ++j) {
-      bufprintf(tb, "      MAC Address %u: ", j);
-      dump_single_mac_address(tb, r->replace[j].macaddr);
-      bufprintf(tb, "      Interface %u: ", j);
-      if (r->replace[j].dev == NULL) {
-        bufprintf(tb, "(None)\n");
-      }
-      else {
-        bufprintf(tb, "%.*s\n", (int)sizeof(r->replace[j].dev->name), r->replace[j].dev->name);
-      }
-    }
+static void *
+mrm_show_start(struct seq_file *sf, loff_t *pos) {
+  struct mrm_show_iter * const it = sf->private;
+
+  rcu_read_lock();
+  it->t = mrm_rcdb_running();
+
+  if ((*pos != 0) && (*pos == it->pos)) {
+    return mrm_show_locate(it); /* pick up where the last read() left off */
+  }
+
+  /* from the top (lseek() or a fresh open)... */
+  it->pos = 0;
+  it->section = MRM_SHOW_HEADER;
+  memset(&it->cursor, 0, sizeof(it->cursor));
+  if (mrm_show_locate(it) == NULL) return NULL;
+  while (it->pos < *pos) {
+    if (mrm_show_next(sf, it, &it->pos) == NULL) return NULL;
+  }
+  return it;
+}
+
+static void
+mrm_show_stop(struct seq_file *sf, void *v) {
+  rcu_read_unlock();
+}
+
+static int
+mrm_show_record(struct seq_file *sf, void *v) {
+  const struct mrm_show_iter * const it = v;
 
-    bufprintf(tb, "    Filter: %.*s\n", (int)sizeof(r->filter->conf.name), r->filter->conf.name);
-    bufprintf(tb, "\n");
+  switch (it->section) {
+  case MRM_SHOW_HEADER:
+    seq_printf(sf, "MAC Address Re-Mapper Running Configuration:\n");
+    if (mrm_flowtable_enabled()) {
+      seq_printf(sf, "  Sticky Flows: %u pinned (idle timeout %us)\n\n", mrm_flowtable_get_count(), mrm_sticky_flow_timeout);
+    }
+    seq_printf(sf, "  Filters: (Total Count %u)\n", mrm_get_filter_count());
+    break;
+  case MRM_SHOW_FILTERS:
+    dump_single_filter(sf, it->entry);
+    break;
+  case MRM_SHOW_REMAPS_HEADER:
+    seq_printf(sf, "  Remap Entries: (Total Count %u)\n", mrm_get_remap_count());
+    break;
+  case MRM_SHOW_REMAPS:
+    dump_single_remap_entry(sf, it->entry);
+    break;
+  case MRM_SHOW_GROUPS_HEADER:
+    seq_printf(sf, "  Replacement Groups: (Total Count %u)\n", mrm_get_group_count());
+    break;
+  case MRM_SHOW_GROUPS:
+    dump_single_group(sf, it->entry);
+    break;
+  case MRM_SHOW_MCASTS_HEADER:
+    seq_printf(sf, "  Multicast To Unicast Groups: (Total Count %u)\n", mrm_get_mcast_group_count());
+    break;
+  case MRM_SHOW_MCASTS:
+    dump_single_mcast_group(sf, it->entry);
+    break;
   }
+  return 0;
 }
 
+static const struct seq_operations _show_seq_ops = {
+  start:  &mrm_show_start,
+  next:   &mrm_show_next,
+  stop:   &mrm_show_stop,
+  show:   &mrm_show_record,
+};
+
+int
+mrm_open_running_configuration(struct file * const f) {
+  return seq_open_private(f, &_show_seq_ops, sizeof(struct mrm_show_iter));
+}
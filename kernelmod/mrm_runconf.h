@@ -13,22 +13,70 @@
 
 #include <linux/skbuff.h>
 
-int mrm_perform_ethernet_remap( unsigned char * const /* dst */, struct sk_buff * const /* skb */);
+/* any copies of the frame made (replicate policy, multicast to unicast) get queued on copies...
+   its up to the caller to hand them to the bridge to go out */
+int mrm_perform_ethernet_remap( unsigned char * const /* dst */, struct sk_buff * const /* skb */, struct sk_buff_head * const /* copies */);
+int mrm_perform_multicast_to_unicast( unsigned char * const /* dst */, struct sk_buff * const /* skb */, struct sk_buff_head * const /* copies */);
+
+/* one configuration change at a time... whoever is making it (control file, netdevice notifier) */
+void mrm_runconf_lock( void );
+void mrm_runconf_unlock( void );
+
+void mrm_handle_netdev_event( struct net_device * const /* dev */, const unsigned long /* event */ );
+
+/* the running filters/remaps/groups/multicast groups configuration generation... bumped by every change to them */
+u32 mrm_get_generation( void );
+
+/* walking the running filters/remaps a chunk at a time... */
+struct mrm_rcdb_cursor;
+int mrm_walk_filters( struct mrm_rcdb_cursor * const /* cursor */, int (*)(const char * const /* name */, const struct mrm_filter_rule * const /* rules */, const unsigned /* rule_count */, void * const) /* fn */, void * const /* ctx */ );
+int mrm_walk_remaps( struct mrm_rcdb_cursor * const /* cursor */, int (*)(const struct mrm_remap_entry * const, void * const) /* fn */, void * const /* ctx */ );
 
 unsigned mrm_get_filter_count( void );
-int mrm_get_filter( struct mrm_filter_config * const /* output */ );
-int mrm_set_filter( const struct mrm_filter_config * const /* filt */ );
-int mrm_delete_filter( const struct mrm_filter_config * const /* filt */ );
+int mrm_get_filter( struct mrm_filter_config_v2 * const /* output */, const unsigned /* room */ ); /* fails with ENOSPC when there is not room for all the rules */
+int mrm_set_filter( const struct mrm_filter_config_v2 * const /* filt */ );
+int mrm_delete_filter( const char * const /* name */ );
 
 unsigned mrm_get_remap_count( void );
 int mrm_get_remap_entry( struct mrm_remap_entry * const /* e */);
 int mrm_set_remap_entry( const struct mrm_remap_entry * const /* remap */ );
 int mrm_delete_remap( const unsigned char * const /* macaddr */ );
+unsigned mrm_age_remaps( void ); /* takes the runconf lock itself... returns how many remaps can still age out */
+
+unsigned mrm_get_group_count( void );
+int mrm_get_group( struct mrm_replace_group * const /* output */, const unsigned /* room */ ); /* fails with ENOSPC when there is not room for all the replacements */
+int mrm_set_group( const struct mrm_replace_group * const /* group */ );
+int mrm_delete_group( const char * const /* name */ );
+int mrm_walk_groups( struct mrm_rcdb_cursor * const /* cursor */, int (*)(const struct mrm_replace_group * const, void * const) /* fn */, void * const /* ctx */ );
+
+unsigned mrm_get_mcast_group_count( void );
+int mrm_get_mcast_group( struct mrm_mcast_group * const /* g */ );
+int mrm_set_mcast_group( const struct mrm_mcast_group * const /* g */ );
+int mrm_delete_mcast_group( const unsigned char * const /* macaddr */ );
+int mrm_walk_mcast_groups( struct mrm_rcdb_cursor * const /* cursor */, int (*)(const struct mrm_mcast_group * const, void * const) /* fn */, void * const /* ctx */ );
+
+/* the filters and remaps can also be built up off to the side (staged)
+   and then swapped in for the running ones all at once (committed)... */
+int mrm_stage_begin( void );
+int mrm_stage_filter( const struct mrm_filter_config_v2 * const /* filt */ );
+int mrm_stage_remap_entry( const struct mrm_remap_entry * const /* remap */ );
+int mrm_stage_commit( void );
+void mrm_stage_abort( void );
+
+/* the data plane counters (see mrm_stats.h)... the getters take care of their own rcu read locking, no runconf mutex needed */
+struct mrm_stats;
+struct mrm_remap_stats;
+void mrm_get_stats( struct mrm_stats * const /* output */ );
+int mrm_get_remap_stats( struct mrm_remap_stats * const /* output */, const unsigned /* room */ ); /* fails with ENOSPC when there is not room for all the counters */
+struct mrm_mcast_stats;
+int mrm_get_mcast_stats( struct mrm_mcast_stats * const /* output */ );
+void mrm_reset_stats( void );
 
 void mrm_destroy_remapper_config( void );
 
 
-struct bufprintf_buf;
-void mrm_bufprintf_running_configuration(struct bufprintf_buf * const /* tb */);
+/* sets up a read()s of the file to stream the running configuration out (a seq_file)... */
+struct file;
+int mrm_open_running_configuration(struct file * const /* f */);
 
 #endif /* #ifndef MRM_RUNCONF_H_INCLUDED */
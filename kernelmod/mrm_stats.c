@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+* Copyright (c) 2018 Cable Television Laboratories, Inc. ("CableLabs")
+*                    and others.  All rights reserved.
+*
+* Created by Jon Dennis (j.dennis@cablelabs.com)
+*/
+
+#include "./mrm_stats.h"
+
+#include <linux/percpu.h>
+#include <linux/string.h>
+
+
+struct mrm_stats_pcpu __percpu *mrm_stats_pcpu;
+
+
+
+void
+mrm_counter_init( struct mrm_counter_pcpu * const c ) {
+  u64_stats_init(&c->syncp);
+}
+
+void
+mrm_counter_read( const struct mrm_counter_pcpu * const c, struct mrm_counter * const sum ) {
+  u64 frames, bytes;
+
+  mrm_counter_fetch(c, &frames, &bytes);
+  sum->frames += frames - c->reset_frames;
+  sum->bytes  += bytes  - c->reset_bytes;
+}
+
+/* the cpu owning the counter never has to stop for a reset... it starts over from wherever it is at */
+void
+mrm_counter_reset( struct mrm_counter_pcpu * const c ) {
+  mrm_counter_fetch(c, &c->reset_frames, &c->reset_bytes);
+}
+
+
+
+int
+mrm_stats_init( void ) {
+  unsigned cpu, i;
+
+  mrm_stats_pcpu = alloc_percpu(struct mrm_stats_pcpu);
+  if (mrm_stats_pcpu == NULL) {
+    return -ENOMEM;
+  }
+  for_each_possible_cpu(cpu) {
+    for (i = 0; i < MRM_STAT_COUNT; ++i) {
+      mrm_counter_init(&per_cpu_ptr(mrm_stats_pcpu, cpu)->counter[i]);
+    }
+  }
+
+  return 0; /* success */
+}
+
+void
+mrm_stats_destroy( void ) {
+  free_percpu(mrm_stats_pcpu);
+}
+
+void
+mrm_stats_get( struct mrm_stats * const output ) {
+  const struct mrm_stats_pcpu *s;
+  unsigned cpu;
+
+  memset(output, 0, sizeof(*output));
+  for_each_possible_cpu(cpu) {
+    s = per_cpu_ptr(mrm_stats_pcpu, cpu);
+    mrm_counter_read(&s->counter[MRM_STAT_HOOK],         &output->hook);
+    mrm_counter_read(&s->counter[MRM_STAT_REMAP_HIT],    &output->remap_hit);
+    mrm_counter_read(&s->counter[MRM_STAT_REMAP_MISS],   &output->remap_miss);
+    mrm_counter_read(&s->counter[MRM_STAT_UNCLASSIFIED], &output->unclassified);
+  }
+}
+
+void
+mrm_stats_reset( void ) {
+  unsigned cpu, i;
+
+  for_each_possible_cpu(cpu) {
+    for (i = 0; i < MRM_STAT_COUNT; ++i) {
+      mrm_counter_reset(&per_cpu_ptr(mrm_stats_pcpu, cpu)->counter[i]);
+    }
+  }
+}
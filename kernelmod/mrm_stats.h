@@ -0,0 +1,88 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+* Copyright (c) 2018 Cable Television Laboratories, Inc. ("CableLabs")
+*                    and others.  All rights reserved.
+*
+* Created by Jon Dennis (j.dennis@cablelabs.com)
+*/
+
+#ifndef MRM_STATS_H_INCLUDED
+#define MRM_STATS_H_INCLUDED
+
+#include "./mrm_private.h"
+#include "./macremapper_ioctl.h"
+
+#include <linux/version.h>
+#include <linux/u64_stats_sync.h>
+
+/*
+  the data plane counters... each cpu bumps its own with no locking at all, and they
+  only get added up when somebody asks (MRM_GETSTATS, MRM_GETREMAPSTATS)
+
+  the module wide ones live here, the ones of a remap's rules and replacements live
+  with its classifier and replacement set
+*/
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(3,13,0)
+  #define u64_stats_init(SYNCP) do { } while (0)
+#endif
+
+/* the counters get bumped in softirq context... */
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6,3,0)
+  #define mrm_stats_fetch_begin(SYNCP)        u64_stats_fetch_begin_bh(SYNCP)
+  #define mrm_stats_fetch_retry(SYNCP, START) u64_stats_fetch_retry_bh(SYNCP, START)
+#else
+  #define mrm_stats_fetch_begin(SYNCP)        u64_stats_fetch_begin(SYNCP)
+  #define mrm_stats_fetch_retry(SYNCP, START) u64_stats_fetch_retry(SYNCP, START)
+#endif
+
+enum {
+  MRM_STAT_HOOK = 0,
+  MRM_STAT_REMAP_HIT,
+  MRM_STAT_REMAP_MISS,
+  MRM_STAT_UNCLASSIFIED,
+  MRM_STAT_COUNT,
+};
+
+struct mrm_stats_pcpu {
+  struct mrm_counter_pcpu counter[MRM_STAT_COUNT];
+};
+extern struct mrm_stats_pcpu __percpu *mrm_stats_pcpu;
+
+static inline void
+mrm_counter_add(struct mrm_counter_pcpu * const c, const unsigned len) {
+  u64_stats_update_begin(&c->syncp);
+  c->frames++;
+  c->bytes += len;
+  u64_stats_update_end(&c->syncp);
+}
+
+static inline void
+mrm_stats_count(const unsigned stat, const unsigned len) {
+  mrm_counter_add(&this_cpu_ptr(mrm_stats_pcpu)->counter[stat], len);
+}
+
+/* the raw counter, resets or not... */
+static inline void
+mrm_counter_fetch(const struct mrm_counter_pcpu * const c, u64 * const frames, u64 * const bytes) {
+  unsigned start;
+
+  do {
+    start   = mrm_stats_fetch_begin(&c->syncp);
+    *frames = c->frames;
+    *bytes  = c->bytes;
+  } while (mrm_stats_fetch_retry(&c->syncp, start));
+}
+
+/* each cpu's copy of a counter gets initialized before use... */
+void mrm_counter_init( struct mrm_counter_pcpu * const /* c */ );
+/* adds (one cpu's copy of) a counter since its last reset to sum... */
+void mrm_counter_read( const struct mrm_counter_pcpu * const /* c */, struct mrm_counter * const /* sum */ );
+void mrm_counter_reset( struct mrm_counter_pcpu * const /* c */ );
+
+int mrm_stats_init( void );
+void mrm_stats_destroy( void );
+void mrm_stats_get( struct mrm_stats * const /* output */ );
+void mrm_stats_reset( void );
+
+#endif /* #ifndef MRM_STATS_H_INCLUDED */
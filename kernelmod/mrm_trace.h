@@ -0,0 +1,151 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+* Copyright (c) 2018 Cable Television Laboratories, Inc. ("CableLabs")
+*                    and others.  All rights reserved.
+*
+* Created by Jon Dennis (j.dennis@cablelabs.com)
+*/
+
+/*
+  tracepoints of the remap decisions made by the bridge hook...
+
+  free while off... switch them on with ftrace or perf, e.g.:
+    echo 1 > /sys/kernel/debug/tracing/events/macremapper/enable
+    perf record -e 'macremapper:*' -a
+  and narrow them down with the usual event filters (match=..., rule_idx=...)
+*/
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM macremapper
+
+#if !defined(MRM_TRACE_H_INCLUDED) || defined(TRACE_HEADER_MULTI_READ)
+#define MRM_TRACE_H_INCLUDED
+
+#include <linux/tracepoint.h>
+#include <linux/skbuff.h>
+#include <linux/netdevice.h>
+#include <linux/string.h>
+#include <net/ipv6.h>
+
+#include "./mrm_private.h"
+#include "./mrm_flowtable.h"
+
+/* the flow tuple carried by the events... ipv4 addresses get stored v4-mapped,
+   no flow (key == NULL) leaves it all zeros */
+#define TUPLE_ENTRY                                                        \
+  __array(u8,  saddr, 16)                                                  \
+  __array(u8,  daddr, 16)                                                  \
+  __field(u16, sport)                                                      \
+  __field(u16, dport)                                                      \
+  __field(u8,  proto)
+#define TUPLE_ASSIGN(KEY)                                                  \
+  do {                                                                     \
+    memset(__entry->saddr, 0, 16);                                         \
+    memset(__entry->daddr, 0, 16);                                         \
+    __entry->sport = __entry->dport = __entry->proto = 0;                  \
+    if ((KEY) == NULL) break;                                              \
+    if ((KEY)->family == AF_INET) {                                        \
+      ipv6_addr_set_v4mapped((KEY)->saddr.ip4, (struct in6_addr *)__entry->saddr); \
+      ipv6_addr_set_v4mapped((KEY)->daddr.ip4, (struct in6_addr *)__entry->daddr); \
+    } else {                                                               \
+      memcpy(__entry->saddr, &(KEY)->saddr.ip6, 16);                       \
+      memcpy(__entry->daddr, &(KEY)->daddr.ip6, 16);                       \
+    }                                                                      \
+    __entry->sport = (KEY)->sport;                                         \
+    __entry->dport = (KEY)->dport;                                         \
+    __entry->proto = (KEY)->proto;                                         \
+  } while (0)
+#define TUPLE_PR_FMT "proto=%u src=[%pI6c]:%u dst=[%pI6c]:%u"
+#define TUPLE_PR_ARG __entry->proto, __entry->saddr, __entry->sport, __entry->daddr, __entry->dport
+
+
+/* the destination is none of the remaps... */
+TRACE_EVENT(mrm_lookup_miss,
+  TP_PROTO(const unsigned char *dst, const struct sk_buff *skb),
+  TP_ARGS(dst, skb),
+  TP_STRUCT__entry(
+    __array(unsigned char, dst, 6)
+    __field(u16,           ethertype)
+    __field(unsigned,      len)
+  ),
+  TP_fast_assign(
+    memcpy(__entry->dst, dst, 6);
+    __entry->ethertype = ntohs(skb->protocol);
+    __entry->len       = skb->len;
+  ),
+  TP_printk("dst=%pM ethertype=0x%04x len=%u", __entry->dst, __entry->ethertype, __entry->len)
+);
+
+/* one of the remap's filter rules matched the frame (rule_idx being its index in the class's filter)... */
+TRACE_EVENT(mrm_filter_match,
+  TP_PROTO(const struct mrm_runconf_remap_entry *remap, const struct mrm_classifier_ruleref *ref,
+           const struct mrm_flow_key *key, unsigned len),
+  TP_ARGS(remap, ref, key, len),
+  TP_STRUCT__entry(
+    __array(unsigned char, match, 6)
+    __field(unsigned,      class_idx)
+    __field(unsigned,      rule_idx)
+    __field(unsigned,      len)
+    TUPLE_ENTRY
+  ),
+  TP_fast_assign(
+    memcpy(__entry->match, remap->match_macaddr, 6);
+    __entry->class_idx = ref->class_idx;
+    __entry->rule_idx  = ref->rule - rcu_dereference(remap->classes[ref->class_idx].filter->rules)->rules;
+    __entry->len       = len;
+    TUPLE_ASSIGN(key);
+  ),
+  TP_printk("match=%pM class=%u rule_idx=%u len=%u " TUPLE_PR_FMT,
+    __entry->match, __entry->class_idx, __entry->rule_idx, __entry->len, TUPLE_PR_ARG)
+);
+
+/* ...or none of them did */
+TRACE_EVENT(mrm_filter_miss,
+  TP_PROTO(const struct mrm_runconf_remap_entry *remap, const struct mrm_flow_key *key, unsigned len),
+  TP_ARGS(remap, key, len),
+  TP_STRUCT__entry(
+    __array(unsigned char, match, 6)
+    __field(unsigned,      len)
+    TUPLE_ENTRY
+  ),
+  TP_fast_assign(
+    memcpy(__entry->match, remap->match_macaddr, 6);
+    __entry->len = len;
+    TUPLE_ASSIGN(key);
+  ),
+  TP_printk("match=%pM len=%u " TUPLE_PR_FMT, __entry->match, __entry->len, TUPLE_PR_ARG)
+);
+
+/* the frame is about to go to this replacement (after any rate limit spill)... */
+TRACE_EVENT(mrm_replace_chosen,
+  TP_PROTO(const unsigned char *match, unsigned replace_idx, const unsigned char *replace,
+           const struct net_device *dev, const struct mrm_flow_key *key, unsigned len),
+  TP_ARGS(match, replace_idx, replace, dev, key, len),
+  TP_STRUCT__entry(
+    __array(unsigned char, match, 6)
+    __array(unsigned char, replace, 6)
+    __field(unsigned,      replace_idx)
+    __field(int,           ifindex)
+    __field(unsigned,      len)
+    TUPLE_ENTRY
+  ),
+  TP_fast_assign(
+    memcpy(__entry->match, match, 6);
+    memcpy(__entry->replace, replace, 6);
+    __entry->replace_idx = replace_idx;
+    __entry->ifindex     = (dev != NULL) ? dev->ifindex : 0;
+    __entry->len         = len;
+    TUPLE_ASSIGN(key);
+  ),
+  TP_printk("match=%pM replace=%pM replace_idx=%u ifindex=%d len=%u " TUPLE_PR_FMT,
+    __entry->match, __entry->replace, __entry->replace_idx, __entry->ifindex, __entry->len, TUPLE_PR_ARG)
+);
+
+#endif /* #if !defined(MRM_TRACE_H_INCLUDED) || defined(TRACE_HEADER_MULTI_READ) */
+
+/* this part must be outside the include guard... */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE mrm_trace
+#include <trace/define_trace.h>
@@ -0,0 +1 @@
+../macremapper_checkpoint.h
\ No newline at end of file
@@ -0,0 +1 @@
+../macremapper_netlink.h
\ No newline at end of file
@@ -0,0 +1 @@
+../libmrm/libmrm.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../kernelmod/user_include/macremapper_checkpoint.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../kernelmod/user_include/macremapper_netlink.h
\ No newline at end of file
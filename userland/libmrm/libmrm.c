@@ -0,0 +1,945 @@
+/*
+* Copyright (c) 2018 Cable Television Laboratories, Inc. ("CableLabs")
+*                    and others.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at:
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* Created by Jon Dennis (j.dennis@cablelabs.com)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include <macremapper_ioctl.h>
+#include <macremapper_filter_config.h>
+
+#include <mrm_filter_conf_parser.h>
+#include "./libmrm.h"
+
+#define MRM_CTLFILE "/proc/macremapctl"
+
+struct mrm_handle {
+  int              fd;
+  pthread_mutex_t  lock; /* one call at a time... staging belongs to the descriptor, not the thread */
+};
+
+
+
+int
+mrm_open(struct mrm_handle ** const output) {
+  struct mrm_handle *h;
+  int rv;
+
+  h = calloc(1, sizeof(*h));
+  if (h == NULL) return -ENOMEM;
+
+  h->fd = open(MRM_CTLFILE, O_RDWR | O_CLOEXEC);
+  if (h->fd == -1) {
+    rv = -errno;
+    free(h);
+    return rv;
+  }
+  pthread_mutex_init(&h->lock, NULL);
+
+  *output = h;
+  return 0; /* success */
+}
+
+void
+mrm_close(struct mrm_handle * const h) {
+  if (h == NULL) return;
+  close(h->fd); /* the driver throws away anything left staged */
+  pthread_mutex_destroy(&h->lock);
+  free(h);
+}
+
+const char *
+mrm_strerror(const int rv) {
+  return strerror((rv < 0) ? -rv : rv);
+}
+
+/* the caller holds the lock... */
+static int
+mrm_ioctl(struct mrm_handle * const h, const unsigned long request, void * const arg) {
+  return (ioctl(h->fd, request, arg) == -1) ? -errno : 0;
+}
+
+static int
+mrm_call(struct mrm_handle * const h, const unsigned long request, void * const arg) {
+  int rv;
+
+  pthread_mutex_lock(&h->lock);
+  rv = mrm_ioctl(h, request, arg);
+  pthread_mutex_unlock(&h->lock);
+  return rv;
+}
+
+static int
+parse_error(char * const err, const size_t err_size, const char * const fmt, ...) {
+  va_list ap;
+
+  if ((err != NULL) && (err_size > 0)) {
+    va_start(ap, fmt);
+    vsnprintf(err, err_size, fmt, ap);
+    va_end(ap);
+  }
+  return -EINVAL;
+}
+
+
+
+int
+mrm_wipe(struct mrm_handle * const h) {
+  return mrm_call(h, MRM_WIPERUNCONF, NULL);
+}
+
+int
+mrm_set_filter(struct mrm_handle * const h, const struct mrm_filter_config_v2 * const filt) {
+  return mrm_call(h, MRM_SETFILTER2, (void *)filt);
+}
+
+int
+mrm_delete_filter(struct mrm_handle * const h, const char * const name) {
+  struct mrm_filter_config filterconf;
+
+  if ((name[0] == '\0') || (strlen(name) > sizeof(filterconf.name))) return -EINVAL;
+  memset(&filterconf, 0, sizeof(filterconf));
+  strncpy(filterconf.name, name, sizeof(filterconf.name));
+  return mrm_call(h, MRM_DELETEFILTER, &filterconf);
+}
+
+int
+mrm_set_remap(struct mrm_handle * const h, const struct mrm_remap_entry * const remap) {
+  return mrm_call(h, MRM_SETREMAP2, (void *)remap);
+}
+
+int
+mrm_delete_remap(struct mrm_handle * const h, const unsigned char * const match_macaddr) {
+  struct mrm_remap_entry_v1 re;
+
+  memset(&re, 0, sizeof(re));
+  memcpy(re.match_macaddr, match_macaddr, sizeof(re.match_macaddr));
+  return mrm_call(h, MRM_DELETEREMAP, &re);
+}
+
+int
+mrm_set_group(struct mrm_handle * const h, const struct mrm_replace_group * const group) {
+  return mrm_call(h, MRM_SETGROUP, (void *)group);
+}
+
+int
+mrm_delete_group(struct mrm_handle * const h, const char * const name) {
+  struct mrm_replace_group g;
+
+  if ((name[0] == '\0') || (strlen(name) > sizeof(g.name))) return -EINVAL;
+  memset(&g, 0, sizeof(g));
+  strncpy(g.name, name, sizeof(g.name));
+  return mrm_call(h, MRM_DELETEGROUP, &g);
+}
+
+int
+mrm_set_mcast(struct mrm_handle * const h, const struct mrm_mcast_group * const group) {
+  return mrm_call(h, MRM_SETMCAST, (void *)group);
+}
+
+int
+mrm_delete_mcast(struct mrm_handle * const h, const unsigned char * const group_macaddr) {
+  struct mrm_mcast_group g;
+
+  memset(&g, 0, sizeof(g));
+  memcpy(g.group_macaddr, group_macaddr, sizeof(g.group_macaddr));
+  return mrm_call(h, MRM_DELETEMCAST, &g);
+}
+
+int
+mrm_set_remaps(struct mrm_handle * const h, const struct mrm_remap_entry * const remaps, const unsigned count, unsigned * const done) {
+  unsigned i;
+  int rv;
+
+  rv = 0;
+  pthread_mutex_lock(&h->lock);
+  for (i = 0; i < count; ++i) {
+    rv = mrm_ioctl(h, MRM_SETREMAP2, (void *)&remaps[i]);
+    if (rv != 0) break;
+  }
+  pthread_mutex_unlock(&h->lock);
+
+  if (done != NULL) *done = i;
+  return rv;
+}
+
+int
+mrm_delete_remaps(struct mrm_handle * const h, const unsigned char (* const match_macaddrs)[6], const unsigned count, unsigned * const done) {
+  struct mrm_remap_entry_v1 re;
+  unsigned i;
+  int rv;
+
+  rv = 0;
+  memset(&re, 0, sizeof(re));
+  pthread_mutex_lock(&h->lock);
+  for (i = 0; i < count; ++i) {
+    memcpy(re.match_macaddr, match_macaddrs[i], sizeof(re.match_macaddr));
+    rv = mrm_ioctl(h, MRM_DELETEREMAP, &re);
+    if (rv != 0) break;
+  }
+  pthread_mutex_unlock(&h->lock);
+
+  if (done != NULL) *done = i;
+  return rv;
+}
+
+int
+mrm_apply(struct mrm_handle * const h, const struct mrm_config * const conf, struct mrm_apply_failure * const failed) {
+  struct mrm_apply_failure f;
+  struct mrm_stage_vector vec;
+  unsigned i;
+  int rv;
+
+  memset(&f, 0, sizeof(f));
+  pthread_mutex_lock(&h->lock);
+
+  /* the replacement groups are not staged, they are set first so the staged remaps can use them */
+  for (i = 0; i < conf->group_count; ++i) {
+    rv = mrm_ioctl(h, MRM_SETGROUP, conf->groups[i]);
+    if (rv != 0) {
+      f.what  = MRM_APPLY_GROUP;
+      f.index = i;
+      goto done;
+    }
+  }
+
+  rv = mrm_ioctl(h, MRM_STAGEBEGIN, NULL);
+  if (rv != 0) {
+    f.what = MRM_APPLY_STAGE;
+    goto done;
+  }
+
+  /* filters are each sized to fit their rules, so they go over one at a time */
+  for (i = 0; i < conf->filter_count; ++i) {
+    rv = mrm_ioctl(h, MRM_STAGEFILTER2, conf->filters[i]);
+    if (rv != 0) {
+      f.what  = MRM_APPLY_FILTER;
+      f.index = i;
+      goto abort;
+    }
+  }
+
+  memset(&vec, 0, sizeof(vec));
+  vec.count   = conf->remap_count;
+  vec.entries = (uintptr_t)conf->remaps;
+  rv = mrm_ioctl(h, MRM_STAGEREMAPS, &vec);
+  if (rv != 0) {
+    f.what  = MRM_APPLY_REMAP;
+    f.index = vec.staged;
+    goto abort;
+  }
+
+  rv = mrm_ioctl(h, MRM_STAGECOMMIT, NULL);
+  if (rv != 0) {
+    f.what = MRM_APPLY_COMMIT;
+    goto abort;
+  }
+  goto done;
+
+abort:
+  /* the handle lives on... so the staged configuration has to go now, not when it gets closed */
+  mrm_ioctl(h, MRM_STAGEABORT, NULL);
+done:
+  pthread_mutex_unlock(&h->lock);
+  if ((rv != 0) && (failed != NULL)) *failed = f;
+  return rv;
+}
+
+
+
+/* splits a line into whitespace separated arguments... "" is an empty argument, # starts a comment */
+static int
+split_line(char *p, char ** const args, const int max_args) {
+  int argc;
+
+  argc = 0;
+  for (;;) {
+    while ((*p == ' ') || (*p == '\t') || (*p == '\r') || (*p == '\n')) ++p;
+    if ((*p == '\0') || (*p == '#')) break;
+    if (argc >= max_args) return -1;
+
+    if ((p[0] == '"') && (p[1] == '"')) {
+      p[1] = '\0';
+      args[argc++] = &p[1];
+      p += 2;
+      continue;
+    }
+
+    args[argc++] = p;
+    while ((*p != '\0') && (*p != ' ') && (*p != '\t') && (*p != '\r') && (*p != '\n')) ++p;
+    if (*p != '\0') *p++ = '\0';
+  }
+  return argc;
+}
+
+int
+mrm_load_config(struct mrm_config * const conf, const char * const filename, char * const err, const size_t err_size) {
+  FILE *fp;
+  char line[1024];
+  char *args[64];
+  char why[128];
+  int argc;
+  unsigned lineno;
+  void *p;
+  int rv;
+
+  memset(conf, 0, sizeof(*conf));
+  fp = fopen(filename, "r");
+  if (fp == NULL) {
+    rv = -errno;
+    snprintf(why, sizeof(why), "%s", strerror(errno));
+    parse_error(err, err_size, "%s: %s", filename, why);
+    return rv;
+  }
+
+  rv = 0;
+  lineno = 0;
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    ++lineno;
+    argc = split_line(line, args, sizeof(args) / sizeof(args[0]));
+    if (argc == 0) continue;
+
+    if ((argc == 3) && (strcmp(args[0], "loadfilter") == 0)) {
+      p = realloc(conf->filters, (conf->filter_count + 1) * sizeof(*conf->filters));
+      if (p == NULL) {
+        rv = -ENOMEM;
+        break;
+      }
+      conf->filters = p;
+      if (mrm_load_filter(&conf->filters[conf->filter_count], args[1], args[2]) != 0) {
+        rv = parse_error(err, err_size, "%s:%u: Invalid filter", filename, lineno);
+        break;
+      }
+      ++conf->filter_count;
+    }
+    else if ((argc >= 3) && (strcmp(args[0], "group") == 0)) {
+      p = realloc(conf->groups, (conf->group_count + 1) * sizeof(*conf->groups));
+      if (p == NULL) {
+        rv = -ENOMEM;
+        break;
+      }
+      conf->groups = p;
+      rv = mrm_parse_group(&conf->groups[conf->group_count], argc - 1, args + 1, why, sizeof(why));
+      if (rv != 0) {
+        parse_error(err, err_size, "%s:%u: Invalid group: %s", filename, lineno, why);
+        break;
+      }
+      ++conf->group_count;
+    }
+    else if ((argc >= 4) && (strcmp(args[0], "remap") == 0)) {
+      p = realloc(conf->remaps, (conf->remap_count + 1) * sizeof(*conf->remaps));
+      if (p == NULL) {
+        rv = -ENOMEM;
+        break;
+      }
+      conf->remaps = p;
+      rv = mrm_parse_remap(&conf->remaps[conf->remap_count], argc - 1, args + 1, why, sizeof(why));
+      if (rv != 0) {
+        parse_error(err, err_size, "%s:%u: Invalid remap: %s", filename, lineno, why);
+        break;
+      }
+      ++conf->remap_count;
+    }
+    else {
+      rv = parse_error(err, err_size, "%s:%u: Expected a loadfilter, group or remap command", filename, lineno);
+      break;
+    }
+  }
+  fclose(fp);
+
+  if (rv == -ENOMEM) parse_error(err, err_size, "%s:%u: Out of memory", filename, lineno);
+  if (rv != 0) mrm_free_config(conf);
+  return rv;
+}
+
+void
+mrm_free_config(struct mrm_config * const conf) {
+  unsigned i;
+
+  for (i = 0; i < conf->filter_count; ++i) {
+    free(conf->filters[i]);
+  }
+  free(conf->filters);
+  for (i = 0; i < conf->group_count; ++i) {
+    free(conf->groups[i]);
+  }
+  free(conf->groups);
+  free(conf->remaps);
+  memset(conf, 0, sizeof(*conf));
+}
+
+
+
+int
+mrm_show(struct mrm_handle * const h, const int fd) {
+  char buf[1024];
+  ssize_t rv;
+  int cfd;
+
+  /* on a descriptor of its own... the read position is that of the descriptor, and the
+     running configuration is only ever read from the start */
+  (void)h;
+  cfd = open(MRM_CTLFILE, O_RDONLY | O_CLOEXEC);
+  if (cfd == -1) return -errno;
+
+  while ((rv = read(cfd, buf, sizeof(buf))) > 0) {
+    if (write(fd, buf, rv) != rv) {
+      rv = -1;
+      break;
+    }
+  }
+  rv = (rv < 0) ? -errno : 0;
+  close(cfd);
+  return rv;
+}
+
+
+
+int
+mrm_get_stats(struct mrm_handle * const h, struct mrm_stats * const output) {
+  return mrm_call(h, MRM_GETSTATS, output);
+}
+
+int
+mrm_get_remap_stats(struct mrm_handle * const h, const unsigned char * const match_macaddr, struct mrm_remap_stats ** const output) {
+  struct mrm_remap_stats *rs;
+  unsigned room;
+  void *p;
+  int rv;
+
+  /* the driver says how many counters there are when there is not room for them all...
+     and the remap may get more of them in between */
+  rs = NULL;
+  room = 0;
+  pthread_mutex_lock(&h->lock);
+  for (;;) {
+    p = realloc(rs, MRM_REMAP_STATS_SIZE(room));
+    if (p == NULL) {
+      rv = -ENOMEM;
+      break;
+    }
+    rs = p;
+    memset(rs, 0, sizeof(*rs));
+    memcpy(rs->match_macaddr, match_macaddr, sizeof(rs->match_macaddr));
+    rs->counter_count = room;
+    rv = mrm_ioctl(h, MRM_GETREMAPSTATS, rs);
+    if (rv != -ENOSPC) break;
+    room = rs->counter_count;
+  }
+  pthread_mutex_unlock(&h->lock);
+
+  if (rv != 0) {
+    free(rs);
+    return rv;
+  }
+  *output = rs;
+  return 0; /* success */
+}
+
+int
+mrm_get_mcast_stats(struct mrm_handle * const h, const unsigned char * const group_macaddr, struct mrm_mcast_stats * const output) {
+  memset(output, 0, sizeof(*output));
+  memcpy(output->group_macaddr, group_macaddr, sizeof(output->group_macaddr));
+  return mrm_call(h, MRM_GETMCASTSTATS, output);
+}
+
+int
+mrm_reset_stats(struct mrm_handle * const h) {
+  return mrm_call(h, MRM_RESETSTATS, NULL);
+}
+
+
+
+int
+mrm_get_checkpoint(struct mrm_handle * const h, void ** const output, size_t * const size) {
+  struct mrm_checkpoint_buffer cb;
+  void *buf, *p;
+  int rv;
+
+  /* ask with a guess at the size... the driver tells how big it really is when that was not enough */
+  buf = NULL;
+  memset(&cb, 0, sizeof(cb));
+  cb.size = 64 * 1024;
+  pthread_mutex_lock(&h->lock);
+  for (;;) {
+    p = realloc(buf, cb.size);
+    if (p == NULL) {
+      rv = -ENOMEM;
+      break;
+    }
+    buf = p;
+    cb.data = (uintptr_t)buf;
+    rv = mrm_ioctl(h, MRM_GETCHECKPOINT, &cb);
+    if (rv != -ENOSPC) break;
+  }
+  pthread_mutex_unlock(&h->lock);
+
+  if (rv != 0) {
+    free(buf);
+    return rv;
+  }
+  *output = buf;
+  *size = cb.size;
+  return 0; /* success */
+}
+
+int
+mrm_restore_checkpoint(struct mrm_handle * const h, const void * const checkpoint, const size_t size) {
+  struct mrm_checkpoint_buffer cb;
+
+  if ((size < sizeof(struct mrm_checkpoint_header)) || (size > MRM_CHECKPOINT_SIZE_LIMIT)) return -EINVAL;
+
+  /* the whole thing goes over at once... */
+  memset(&cb, 0, sizeof(cb));
+  cb.size = size;
+  cb.data = (uintptr_t)checkpoint;
+  return mrm_call(h, MRM_RESTORECHECKPOINT, &cb);
+}
+
+
+
+int
+mrm_set_decision_sample(struct mrm_handle * const h, const unsigned every) {
+  unsigned e = every;
+  return mrm_call(h, MRM_SETDECISIONSAMPLE, &e);
+}
+
+int
+mrm_map_decision_rings(struct mrm_handle * const h, struct mrm_decision_rings * const output) {
+  void *rings;
+  int rv;
+
+  memset(output, 0, sizeof(*output));
+  pthread_mutex_lock(&h->lock);
+  rv = mrm_ioctl(h, MRM_GETDECISIONRING, &output->info);
+  if ((rv == 0) && (output->info.ring_count == 0)) {
+    rv = -ENODEV; /* the decisions were never sampled */
+  }
+  if (rv == 0) {
+    rings = mmap(NULL, (size_t)output->info.ring_count * output->info.ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, h->fd, 0);
+    if (rings == MAP_FAILED) rv = -errno;
+    else output->rings = rings;
+  }
+  pthread_mutex_unlock(&h->lock);
+  return rv;
+}
+
+void
+mrm_unmap_decision_rings(struct mrm_decision_rings * const dr) {
+  if (dr->rings == NULL) return;
+  munmap(dr->rings, (size_t)dr->info.ring_count * dr->info.ring_size);
+  dr->rings = NULL;
+}
+
+int
+mrm_drain_decisions(struct mrm_decision_rings * const dr, void (*fn)(const struct mrm_decision * const, const unsigned, void * const), void * const ctx) {
+  struct mrm_decision_ring *ring;
+  const struct mrm_decision *d;
+  uint32_t head, tail;
+  unsigned found;
+  unsigned i;
+
+  found = 0;
+  for (i = 0; i < dr->info.ring_count; ++i) {
+    ring = (struct mrm_decision_ring *)(dr->rings + ((size_t)i * dr->info.ring_size));
+    head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    for (tail = ring->tail; tail != head; ++tail, ++found) {
+      d = (const struct mrm_decision *)(((unsigned char *)ring) + ring->record_offset + ((tail & (ring->record_count - 1)) * ring->record_size));
+      fn(d, i, ctx);
+    }
+    /* hands the records back to the driver */
+    __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+  }
+  return (int)found;
+}
+
+unsigned long long
+mrm_decisions_lost(const struct mrm_decision_rings * const dr) {
+  unsigned long long lost;
+  unsigned i;
+
+  lost = 0;
+  for (i = 0; i < dr->info.ring_count; ++i) {
+    lost += ((const struct mrm_decision_ring *)(dr->rings + ((size_t)i * dr->info.ring_size)))->lost;
+  }
+  return lost;
+}
+
+
+
+int
+mrm_parse_macaddr(unsigned char * const output, const char * const str) {
+  unsigned octets[6];
+  int i;
+  if (sscanf(str, "%x:%x:%x:%x:%x:%x",
+                  &octets[0],
+                  &octets[1],
+                  &octets[2],
+                  &octets[3],
+                  &octets[4],
+                  &octets[5]
+  ) != 6) return -EINVAL;
+  for (i=0; i < 6; i++) output[i] = octets[i];
+  return 0; /* success */
+}
+
+int
+mrm_parse_replacement(struct mrm_replacement * const re, const char * const str, char * const err, const size_t err_size) {
+  char buf[128];
+  char *opt, *next;
+  unsigned long value;
+  char *endptr;
+
+  /* format: <macaddr>[,weight=<n>][,rate=<bytes_per_sec>][,burst=<bytes>] */
+  if (strlen(str) >= sizeof(buf)) return parse_error(err, err_size, "Invalid Replacement: %s", str);
+  strcpy(buf, str);
+
+  next = strchr(buf, ',');
+  if (next != NULL) *next++ = '\0';
+  if (mrm_parse_macaddr(re->macaddr, buf) != 0) return parse_error(err, err_size, "Invalid Replacement: %s", str);
+
+  while ((opt = next) != NULL) {
+    next = strchr(opt, ',');
+    if (next != NULL) *next++ = '\0';
+
+    if (strncmp(opt, "weight=", 7) == 0) {
+      value = strtoul(opt + 7, &endptr, 10);
+      if ((opt[7] == '\0') || (*endptr != '\0') || (value < 1) || (value > MRM_MAX_REPLACE_WEIGHT)) {
+        return parse_error(err, err_size, "Invalid replacement weight: %s", opt + 7);
+      }
+      re->weight = (unsigned)value;
+    }
+    else if ((strncmp(opt, "rate=", 5) == 0) || (strncmp(opt, "burst=", 6) == 0)) {
+      value = strtoul(strchr(opt, '=') + 1, &endptr, 10);
+      if ((endptr == strchr(opt, '=') + 1) || (*endptr != '\0') || (value > 0xFFFFFFFFUL)) {
+        return parse_error(err, err_size, "Invalid replacement %s", opt);
+      }
+      if (opt[0] == 'r') {
+        re->rate = (unsigned)value;
+      }
+      else {
+        re->burst = (unsigned)value;
+      }
+    }
+    else {
+      return parse_error(err, err_size, "Unknown replacement option: %s", opt);
+    }
+  }
+
+  return 0; /* success */
+}
+
+static int
+parse_class(struct mrm_remap_class * const cls, int * const pargc, char *** const pargv, const int with_match_macaddr, unsigned char * const match_macaddr, char * const err, const size_t err_size) {
+  int argc = *pargc;
+  char **argv = *pargv;
+  const char *filter_name;
+  const char *remap_macaddr;
+  const char *replace_ifname;
+  unsigned long value;
+  char *endptr;
+  int rv;
+
+  /* parse the options */
+  while ((argc > 0) && (argv[0][0] == '-')) {
+    if (argc < 2) return parse_error(err, err_size, "Missing the value of %s", argv[0]);
+    if (strcmp(argv[0], "-p") == 0) {
+      if (strcmp(argv[1], "roundrobin") == 0) {
+        cls->policy = MRMREPLPOL_ROUNDROBIN;
+      }
+      else if (strcmp(argv[1], "flowhash") == 0) {
+        cls->policy = MRMREPLPOL_FLOWHASH;
+      }
+      else if (strcmp(argv[1], "leastload") == 0) {
+        cls->policy = MRMREPLPOL_LEASTLOAD;
+      }
+      else if (strcmp(argv[1], "replicate") == 0) {
+        cls->policy = MRMREPLPOL_REPLICATE;
+      }
+      else {
+        return parse_error(err, err_size, "Invalid Replacement Policy: %s", argv[1]);
+      }
+    }
+    else if (strcmp(argv[0], "-s") == 0) {
+      if (strcmp(argv[1], "next") == 0) {
+        cls->spill = MRMSPILL_NEXT;
+      }
+      else if (strcmp(argv[1], "unmodified") == 0) {
+        cls->spill = MRMSPILL_UNMODIFIED;
+      }
+      else {
+        return parse_error(err, err_size, "Invalid Spill Action: %s", argv[1]);
+      }
+    }
+    else if (strcmp(argv[0], "-g") == 0) {
+      if ((argv[1][0] == '\0') || (strlen(argv[1]) > sizeof(cls->group_name))) {
+        return parse_error(err, err_size, "Invalid Replacement Group Name: %s", argv[1]);
+      }
+      strncpy(cls->group_name, argv[1], sizeof(cls->group_name));
+    }
+    else if (strcmp(argv[0], "-e") == 0) {
+      /* format: <bytes>[/<window_ms>] */
+      value = strtoul(argv[1], &endptr, 10);
+      if ((endptr == argv[1]) || (value < 1) || (value > 0xFFFFFFFFUL)) {
+        return parse_error(err, err_size, "Invalid Elephant Threshold: %s", argv[1]);
+      }
+      cls->elephant_bytes = (unsigned)value;
+      if (*endptr == '/') {
+        value = strtoul(endptr + 1, &endptr, 10);
+        if ((*endptr != '\0') || (value < 1) || (value > 0xFFFFFFFFUL)) {
+          return parse_error(err, err_size, "Invalid Elephant Window: %s", argv[1]);
+        }
+        cls->elephant_window = (unsigned)value;
+      }
+      else if (*endptr != '\0') {
+        return parse_error(err, err_size, "Invalid Elephant Threshold: %s", argv[1]);
+      }
+    }
+    else {
+      return parse_error(err, err_size, "Unknown option: %s", argv[0]);
+    }
+    argc -= 2;
+    argv += 2;
+  }
+  if (argc < ((with_match_macaddr ? 2 : 1) + ((cls->group_name[0] == '\0') ? 1 : 0))) {
+    return parse_error(err, err_size, "Missing arguments");
+  }
+
+  /* put things into human-readable variable names */
+  filter_name = argv[0];
+  --argc; ++argv;
+
+  /* validate + parse "statically-positioned" parameters */
+  if (filter_name[0] == '\0') {
+    return parse_error(err, err_size, "Invalid Filter Name");
+  }
+  strncpy(cls->filter_name, filter_name, sizeof(cls->filter_name));
+
+  if (with_match_macaddr) {
+    if (mrm_parse_macaddr(match_macaddr, argv[0]) != 0) {
+      return parse_error(err, err_size, "Invalid Match MAC Address: %s", argv[0]);
+    }
+    --argc; ++argv;
+  }
+
+  /* parse + validate the remap mac address list one-by-one... up to the next "class"
+     (a class using a replacement group has none) */
+  while ((argc > 0) && (strcmp(argv[0], "class") != 0)) {
+    if (cls->group_name[0] != '\0') {
+      return parse_error(err, err_size, "Replacements given along with a replacement group");
+    }
+    /* first put things into human-readable variable names */
+    remap_macaddr = *argv;
+    --argc; ++argv;
+    replace_ifname = NULL;
+    if ((argc > 0) && (strcmp(argv[0], "class") != 0)) {
+      replace_ifname = *argv;
+      if (replace_ifname[0] == '\0') {
+        replace_ifname = NULL;
+      }
+      --argc; ++argv;
+    }
+
+    /* then add the replacement to the list... */
+    if (cls->replace_count >= MRM_MAX_REPLACE) {
+      return parse_error(err, err_size, "Too many replacements");
+    }
+    rv = mrm_parse_replacement(&cls->replace[cls->replace_count], remap_macaddr, err, err_size);
+    if (rv != 0) return rv;
+    if (replace_ifname != NULL) {
+      strncpy(cls->replace[cls->replace_count].ifname, replace_ifname, sizeof(cls->replace[cls->replace_count].ifname));
+    }
+    ++cls->replace_count;
+  }
+  if ((cls->replace_count < 1) && (cls->group_name[0] == '\0')) {
+    return parse_error(err, err_size, "Missing replacements");
+  }
+
+  *pargc = argc;
+  *pargv = argv;
+  return 0; /* success */
+}
+
+int
+mrm_parse_remap(struct mrm_remap_entry * const re, int argc, char **argv, char * const err, const size_t err_size) {
+  unsigned long value;
+  char *endptr;
+  int rv;
+
+  /* initialize variables... */
+  memset(re, 0, sizeof(*re));
+
+  /* the options of the remap as a whole... */
+  while ((argc > 0) && (strncmp(argv[0], "--", 2) == 0)) {
+    if (strcmp(argv[0], "--shadow") == 0) {
+      re->shadow = 1;
+      --argc; ++argv;
+    }
+    else if ((strcmp(argv[0], "--idle") == 0) && (argc > 1)) {
+      value = strtoul(argv[1], &endptr, 10);
+      if ((endptr == argv[1]) || (*endptr != '\0') || (value > MRM_MAX_IDLE_TIMEOUT)) {
+        return parse_error(err, err_size, "Invalid Idle Timeout: %s", argv[1]);
+      }
+      re->idle_timeout = (unsigned)value;
+      argc -= 2; argv += 2;
+    }
+    else {
+      return parse_error(err, err_size, "Unknown option: %s", argv[0]);
+    }
+  }
+
+  /* the first class comes with the match MAC address... */
+  rv = parse_class(&re->classes[0], &argc, &argv, 1, re->match_macaddr, err, err_size);
+  if (rv != 0) return rv;
+  re->class_count = 1;
+
+  /* ...any further ones are introduced with "class" */
+  while (argc > 0) {
+    --argc; ++argv; /* skip "class" */
+    if (re->class_count >= MRM_MAX_CLASSES) {
+      return parse_error(err, err_size, "Too many classes");
+    }
+    rv = parse_class(&re->classes[re->class_count], &argc, &argv, 0, NULL, err, err_size);
+    if (rv != 0) return rv;
+    ++re->class_count;
+  }
+
+  return 0; /* success */
+}
+
+int
+mrm_parse_group(struct mrm_replace_group ** const output, int argc, char **argv, char * const err, const size_t err_size) {
+  struct mrm_replace_group *g;
+  const char *remap_macaddr;
+  const char *replace_ifname;
+  int rv;
+
+  if (argc < 2) return parse_error(err, err_size, "Missing arguments");
+  if ((argv[0][0] == '\0') || (strlen(argv[0]) > sizeof(g->name))) {
+    return parse_error(err, err_size, "Invalid Replacement Group Name: %s", argv[0]);
+  }
+
+  /* never more replacements than there are arguments left... */
+  g = calloc(1, MRM_REPLACE_GROUP_SIZE(argc - 1));
+  if (g == NULL) return -ENOMEM;
+  strncpy(g->name, argv[0], sizeof(g->name));
+  --argc; ++argv;
+
+  /* same as the replacements of a remap... */
+  while (argc > 0) {
+    remap_macaddr = *argv;
+    --argc; ++argv;
+    replace_ifname = NULL;
+    if (argc > 0) {
+      replace_ifname = *argv;
+      --argc; ++argv;
+    }
+
+    if (g->replace_count >= MRM_REPLACE_GROUP_LIMIT) {
+      free(g);
+      return parse_error(err, err_size, "Too many replacements");
+    }
+    rv = mrm_parse_replacement(&g->replace[g->replace_count], remap_macaddr, err, err_size);
+    if (rv != 0) {
+      free(g);
+      return rv;
+    }
+    if ((replace_ifname != NULL) && (replace_ifname[0] != '\0')) {
+      strncpy(g->replace[g->replace_count].ifname, replace_ifname, sizeof(g->replace[g->replace_count].ifname));
+    }
+    ++g->replace_count;
+  }
+
+  *output = g;
+  return 0; /* success */
+}
+
+int
+mrm_parse_mcast(struct mrm_mcast_group * const g, int argc, char **argv, char * const err, const size_t err_size) {
+  const char *member_macaddr;
+  const char *member_ifname;
+
+  /* initialize variables... */
+  memset(g, 0, sizeof(*g));
+
+  /* parse the options */
+  while ((argc > 0) && (argv[0][0] == '-')) {
+    if (strcmp(argv[0], "-k") == 0) {
+      g->original = MRMMCAST_KEEP_ORIGINAL;
+    }
+    else {
+      return parse_error(err, err_size, "Unknown option: %s", argv[0]);
+    }
+    --argc; ++argv;
+  }
+  if (argc < 2) return parse_error(err, err_size, "Missing arguments");
+
+  if (mrm_parse_macaddr(g->group_macaddr, argv[0]) != 0) {
+    return parse_error(err, err_size, "Invalid Group MAC Address: %s", argv[0]);
+  }
+  --argc; ++argv;
+
+  /* parse + validate the member list one-by-one */
+  while ( argc > 0 ) {
+    /* first put things into human-readable variable names */
+    member_macaddr = *argv;
+    --argc; ++argv;
+    if (argc == 0) {
+      return parse_error(err, err_size, "Missing bridge port of member: %s", member_macaddr);
+    }
+    member_ifname = *argv;
+    --argc; ++argv;
+
+    /* then add the member to the list... */
+    if (g->member_count >= MRM_MAX_MCAST_MEMBERS) {
+      return parse_error(err, err_size, "Too many members");
+    }
+    if (mrm_parse_macaddr(g->members[g->member_count].macaddr, member_macaddr) != 0) {
+      return parse_error(err, err_size, "Invalid Member MAC Address: %s", member_macaddr);
+    }
+    if ((member_ifname[0] == '\0') || (strlen(member_ifname) >= sizeof(g->members[g->member_count].ifname))) {
+      return parse_error(err, err_size, "Invalid Member Bridge Port: %s", member_ifname);
+    }
+    strncpy(g->members[g->member_count].ifname, member_ifname, sizeof(g->members[g->member_count].ifname));
+    ++g->member_count;
+  }
+
+  return 0; /* success */
+}
+
+int
+mrm_load_filter(struct mrm_filter_config_v2 ** const output, const char * const name, const char * const filename) {
+  struct mrm_filter_config_v2 *filt;
+
+  if ((name[0] == '\0') || (strlen(name) > sizeof(filt->name))) return -EINVAL;
+  if (filter_file_load(&filt, filename) != 0) return -EINVAL;
+  strncpy(filt->name, name, sizeof(filt->name));
+
+  *output = filt;
+  return 0; /* success */
+}
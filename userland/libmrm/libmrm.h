@@ -0,0 +1,148 @@
+/*
+* Copyright (c) 2018 Cable Television Laboratories, Inc. ("CableLabs")
+*                    and others.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at:
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* Created by Jon Dennis (j.dennis@cablelabs.com)
+*/
+
+#ifndef LIBMRM_H_INCLUDED
+#define LIBMRM_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <macremapper_ioctl.h>
+#include <macremapper_filter_config.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+
+  libmrm... the driver's control interface, for programs that talk to it
+  over and over again (a controller reconciling the configuration) and
+  would rather not run mrmctl for every change
+
+  . a handle keeps the control file open for as long as it is around, and
+    may be shared by any number of threads (calls on it take turns)
+  . everything returns 0 on success or a negative errno value, nothing
+    exits and nothing but the filter file parser prints anything
+    (mrm_strerror() says what the value means)...
+    the driver's own reasons are in the kernel log
+  . the parsers are the ones mrmctl uses for its command line arguments,
+    given the arguments after the command... when err is not NULL, what
+    was wrong with them gets written there
+
+*/
+
+struct mrm_handle;
+
+int  mrm_open(struct mrm_handle ** const /* output */);
+void mrm_close(struct mrm_handle * const /* h */);
+const char *mrm_strerror(const int /* rv */);
+
+
+/* the running configuration, one change at a time... */
+int mrm_wipe(struct mrm_handle * const /* h */);
+int mrm_set_filter(struct mrm_handle * const /* h */, const struct mrm_filter_config_v2 * const /* filt */);
+int mrm_delete_filter(struct mrm_handle * const /* h */, const char * const /* name */);
+int mrm_set_remap(struct mrm_handle * const /* h */, const struct mrm_remap_entry * const /* remap */);
+int mrm_delete_remap(struct mrm_handle * const /* h */, const unsigned char * const /* match_macaddr */);
+int mrm_set_group(struct mrm_handle * const /* h */, const struct mrm_replace_group * const /* group */);
+int mrm_delete_group(struct mrm_handle * const /* h */, const char * const /* name */);
+int mrm_set_mcast(struct mrm_handle * const /* h */, const struct mrm_mcast_group * const /* group */);
+int mrm_delete_mcast(struct mrm_handle * const /* h */, const unsigned char * const /* group_macaddr */);
+
+/* ...a batch of them (no other thread's calls in between), stopping at the first failure...
+   *done (when not NULL) says how many of them went through */
+int mrm_set_remaps(struct mrm_handle * const /* h */, const struct mrm_remap_entry * const /* remaps */, const unsigned /* count */, unsigned * const /* done */);
+int mrm_delete_remaps(struct mrm_handle * const /* h */, const unsigned char (* const /* match_macaddrs */)[6], const unsigned /* count */, unsigned * const /* done */);
+
+/* ...or all of the filters and remaps replaced at once (see "apply" in mrmctl): the replacement groups
+   get set first, then the filters and remaps get staged and swapped in for the running ones in one go...
+   nothing but the groups changes on failure, and *failed (when not NULL) tells which part it was */
+struct mrm_config {
+  struct mrm_filter_config_v2  **filters;   /* each allocated to fit its rules */
+  unsigned                       filter_count;
+  struct mrm_replace_group     **groups;    /* each allocated to fit its replacements */
+  unsigned                       group_count;
+  struct mrm_remap_entry        *remaps;
+  unsigned                       remap_count;
+};
+struct mrm_apply_failure {
+  enum {
+    MRM_APPLY_GROUP = 0,
+    MRM_APPLY_STAGE,      /* somebody else is staging (EBUSY) */
+    MRM_APPLY_FILTER,
+    MRM_APPLY_REMAP,
+    MRM_APPLY_COMMIT,
+  } what;
+  unsigned index;         /* of the group, filter or remap */
+};
+int mrm_apply(struct mrm_handle * const /* h */, const struct mrm_config * const /* conf */, struct mrm_apply_failure * const /* failed */);
+
+/* reads an "apply" configuration file (loadfilter, group and remap lines) into conf...
+   err gets "<file>:<line>: <what>" when it is not good */
+int mrm_load_config(struct mrm_config * const /* conf */, const char * const /* filename */, char * const /* err */, const size_t /* err_size */);
+void mrm_free_config(struct mrm_config * const /* conf */);
+
+
+/* the running configuration as text (what reading the control file gives), written out to fd */
+int mrm_show(struct mrm_handle * const /* h */, const int /* fd */);
+
+
+/* the data plane counters... mrm_get_remap_stats() allocates *output to fit (the caller free()s it) */
+int mrm_get_stats(struct mrm_handle * const /* h */, struct mrm_stats * const /* output */);
+int mrm_get_remap_stats(struct mrm_handle * const /* h */, const unsigned char * const /* match_macaddr */, struct mrm_remap_stats ** const /* output */);
+int mrm_get_mcast_stats(struct mrm_handle * const /* h */, const unsigned char * const /* group_macaddr */, struct mrm_mcast_stats * const /* output */);
+int mrm_reset_stats(struct mrm_handle * const /* h */);
+
+
+/* checkpoints... mrm_get_checkpoint() allocates *output to fit (the caller free()s it) */
+int mrm_get_checkpoint(struct mrm_handle * const /* h */, void ** const /* output */, size_t * const /* size */);
+int mrm_restore_checkpoint(struct mrm_handle * const /* h */, const void * const /* checkpoint */, const size_t /* size */);
+
+
+/* the sampled remap decisions... the rings stay mapped until mrm_unmap_decision_rings(), and
+   mrm_drain_decisions() hands every record that came in since the last time to fn (cpu by cpu),
+   returning how many there were... only one thread should be draining the rings at a time */
+struct mrm_decision_rings {
+  struct mrm_decision_ring_info  info;
+  unsigned char                 *rings;
+};
+int mrm_set_decision_sample(struct mrm_handle * const /* h */, const unsigned /* every */);
+int mrm_map_decision_rings(struct mrm_handle * const /* h */, struct mrm_decision_rings * const /* output */);
+void mrm_unmap_decision_rings(struct mrm_decision_rings * const /* dr */);
+int mrm_drain_decisions(struct mrm_decision_rings * const /* dr */, void (*)(const struct mrm_decision * const, const unsigned /* cpu */, void * const) /* fn */, void * const /* ctx */);
+unsigned long long mrm_decisions_lost(const struct mrm_decision_rings * const /* dr */);
+
+
+/* the parsers... */
+int mrm_parse_macaddr(unsigned char * const /* output */, const char * const /* str */);
+int mrm_parse_replacement(struct mrm_replacement * const /* output */, const char * const /* str */, char * const /* err */, const size_t /* err_size */);
+int mrm_parse_remap(struct mrm_remap_entry * const /* output */, int /* argc */, char ** /* argv */, char * const /* err */, const size_t /* err_size */);
+int mrm_parse_group(struct mrm_replace_group ** const /* output (allocated to fit) */, int /* argc */, char ** /* argv */, char * const /* err */, const size_t /* err_size */);
+int mrm_parse_mcast(struct mrm_mcast_group * const /* output */, int /* argc */, char ** /* argv */, char * const /* err */, const size_t /* err_size */);
+
+/* the filter configuration files are read with filter_file_load() (see mrm_filter_conf_parser.h)...
+   this does the same and names the filter (what was wrong with a bad file still goes to stderr) */
+int mrm_load_filter(struct mrm_filter_config_v2 ** const /* output */, const char * const /* name */, const char * const /* filename */);
+
+#ifdef __cplusplus
+}; //extern "C" {
+#endif
+
+#endif /* #ifndef LIBMRM_H_INCLUDED */
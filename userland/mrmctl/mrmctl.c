@@ -18,202 +18,493 @@
 */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
+#include <errno.h>
 #include <unistd.h>
-#include <fcntl.h>
+#include <signal.h>
 #include <sys/types.h>
 #include <sys/stat.h>
-#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
 
-#include <macremapper_ioctl.h>
-#include <macremapper_filter_config.h>
+#include <libmrm.h>
 
-#include <mrm_filter_conf_parser.h>
+static void usage( void );
 
-static int
-open_driver() {
-  int fd;
-  fd = open("/proc/macremapctl", O_RDWR);
-  if (fd == -1) {
-    perror("Failed to open driver");
+static struct mrm_handle *
+open_driver( void ) {
+  struct mrm_handle *h;
+  int rv;
+
+  rv = mrm_open(&h);
+  if (rv != 0) {
+    fprintf(stderr, "Failed to open driver: %s\n", mrm_strerror(rv));
     _exit(1);
   }
-  return fd;
+  return h;
 }
 
+/* reports how the call to the driver went... and what the command exits with */
 static int
-show( void ) {
-  int fd;
-  char buf[1024];
-  ssize_t rv;
+finish(struct mrm_handle * const h, const char * const what, const int rv) {
+  if (rv != 0) {
+    fprintf(stderr, "%s failed: %s\n", what, mrm_strerror(rv));
+  }
+  mrm_close(h);
+  return (rv != 0) ? 1 : 0;
+}
 
-  fd = open_driver();
-  while ((rv = read(fd, buf, sizeof(buf))) > 0) {
-    if (write(STDOUT_FILENO, buf, rv) != rv) break;
+static void
+parse_failed(const char * const err, const int rv) {
+  fprintf(stderr, "%s\n", (err[0] != '\0') ? err : mrm_strerror(rv));
+}
+
+static int
+valid_filter_name(const char * const filter_name) {
+  if ((filter_name[0] == '\0') || (strlen(filter_name) > MRM_FILTER_NAME_MAX)) {
+    fprintf(stderr, "Invalid Filter Name\n");
+    return 0;
   }
-  close(fd);
+  return 1;
+}
 
-  return 0;
+static int
+show( void ) {
+  struct mrm_handle *h;
+
+  h = open_driver();
+  return finish(h, "Reading the running configuration", mrm_show(h, STDOUT_FILENO));
 }
 
 static int
 wipe( void ) {
-  int fd;
-  fd = open_driver();
-  if (ioctl(fd, MRM_WIPERUNCONF) == -1) {
-    perror("ioctl(MRM_WIPERUNCONF) failed");
+  struct mrm_handle *h;
+
+  h = open_driver();
+  return finish(h, "ioctl(MRM_WIPERUNCONF)", mrm_wipe(h));
+}
+
+static int
+loadfilter(const char * const filter_name, const char * const filename) {
+  struct mrm_filter_config_v2 *filterconf;
+  struct mrm_handle *h;
+  int rv;
+
+  if (!valid_filter_name(filter_name)) return 1;
+  if (mrm_load_filter(&filterconf, filter_name, filename) != 0) {
     return 1;
   }
-  close(fd);
-  return 0;
+
+  h = open_driver();
+  rv = mrm_set_filter(h, filterconf);
+  free(filterconf);
+  return finish(h, "ioctl(MRM_SETFILTER2)", rv);
 }
 
 static int
-loadfilter(const char * const filter_name, const char * const filename) {
-  struct mrm_filter_config filterconf;
-  int fd;
+rmfilter(const char * const filter_name) {
+  struct mrm_handle *h;
 
-  if (filter_name[0] == '\0') {
-    fprintf(stderr, "Invalid Filter Name\n");
+  if (!valid_filter_name(filter_name)) return 1;
+
+  h = open_driver();
+  return finish(h, "ioctl(MRM_DELETEFILTER)", mrm_delete_filter(h, filter_name));
+};
+
+static int
+remap(int argc, char **argv) {
+  struct mrm_remap_entry re;
+  struct mrm_handle *h;
+  char err[256];
+  int rv;
+
+  err[0] = '\0';
+  rv = mrm_parse_remap(&re, argc - 2, argv + 2, err, sizeof(err));
+  if (rv != 0) {
+    parse_failed(err, rv);
     return 1;
   }
-  if (filter_file_load(&filterconf, filename) != 0) {
+
+  /* write the configuration to the driver... */
+  h = open_driver();
+  return finish(h, "ioctl(MRM_SETREMAP2)", mrm_set_remap(h, &re));
+}
+
+static int
+rmremap(const char * const match_macaddr) {
+  unsigned char macaddr[6];
+  struct mrm_handle *h;
+
+  if (mrm_parse_macaddr(macaddr, match_macaddr) != 0) {
+    fprintf(stderr, "Invalid Match MAC Address: %s\n", match_macaddr);
     return 1;
   }
-  strncpy(filterconf.name, filter_name, sizeof(filterconf.name));
 
-  fd = open_driver();
-  if (ioctl(fd, MRM_SETFILTER, &filterconf) == -1) {
-    perror("ioctl(MRM_SETFILTER) failed");
+  h = open_driver();
+  return finish(h, "ioctl(MRM_DELETEREMAP)", mrm_delete_remap(h, macaddr));
+};
+
+static int
+group(int argc, char **argv) {
+  struct mrm_replace_group *g;
+  struct mrm_handle *h;
+  char err[256];
+  int rv;
+
+  err[0] = '\0';
+  rv = mrm_parse_group(&g, argc - 2, argv + 2, err, sizeof(err));
+  if (rv != 0) {
+    parse_failed(err, rv);
     return 1;
   }
-  close(fd);
-  return 0;
+
+  /* write the configuration to the driver... every remap using the group switches over at once */
+  h = open_driver();
+  rv = mrm_set_group(h, g);
+  free(g);
+  return finish(h, "ioctl(MRM_SETGROUP)", rv);
 }
 
 static int
-rmfilter(const char * const filter_name) {
-  struct mrm_filter_config filterconf;
-  int fd;
+rmgroup(const char * const group_name) {
+  struct mrm_handle *h;
 
-  if (filter_name[0] == '\0') {
-    fprintf(stderr, "Invalid Filter Name\n");
+  if ((group_name[0] == '\0') || (strlen(group_name) > MRM_FILTER_NAME_MAX)) {
+    fprintf(stderr, "Invalid Replacement Group Name\n");
     return 1;
   }
-  strncpy(filterconf.name, filter_name, sizeof(filterconf.name));
 
-  fd = open_driver();
-  if (ioctl(fd, MRM_DELETEFILTER, &filterconf) == -1) {
-    perror("ioctl(MRM_DELETEFILTER) failed");
+  h = open_driver();
+  return finish(h, "ioctl(MRM_DELETEGROUP)", mrm_delete_group(h, group_name));
+}
+
+static int
+mcast(int argc, char **argv) {
+  struct mrm_mcast_group g;
+  struct mrm_handle *h;
+  char err[256];
+  int rv;
+
+  err[0] = '\0';
+  rv = mrm_parse_mcast(&g, argc - 2, argv + 2, err, sizeof(err));
+  if (rv != 0) {
+    parse_failed(err, rv);
     return 1;
   }
-  close(fd);
-  return 0;
-};
 
-static int
-parse_macaddr(unsigned char * const output, const char * const str) {
-  unsigned octets[6];
-  int i;
-  if (sscanf(str, "%x:%x:%x:%x:%x:%x",
-                  &octets[0],
-                  &octets[1],
-                  &octets[2],
-                  &octets[3],
-                  &octets[4],
-                  &octets[5]
-  ) != 6) return 0;
-  for (i=0; i < 6; i++) output[i] = octets[i];
-  return 1;
+  /* write the configuration to the driver... */
+  h = open_driver();
+  return finish(h, "ioctl(MRM_SETMCAST)", mrm_set_mcast(h, &g));
 }
 
 static int
-remap(int argc, char **argv) {
-  const char *filter_name;
-  const char *match_macaddr;
-  const char *remap_macaddr;
-  const char *replace_ifname;
-  int fd;
-  struct mrm_remap_entry re;
+rmmcast(const char * const group_macaddr) {
+  unsigned char macaddr[6];
+  struct mrm_handle *h;
 
-  if (argc < 5) return 1; /* defensive */
+  if (mrm_parse_macaddr(macaddr, group_macaddr) != 0) {
+    fprintf(stderr, "Invalid Group MAC Address: %s\n", group_macaddr);
+    return 1;
+  }
 
-  /* initialize variables and put things into human-readable variable names */
-  memset(&re, 0, sizeof(re));
-  filter_name   = argv[2];
-  match_macaddr = argv[3];
+  h = open_driver();
+  return finish(h, "ioctl(MRM_DELETEMCAST)", mrm_delete_mcast(h, macaddr));
+}
 
-  /* validate + parse "statically-positioned" parameters */
-  if (filter_name[0] == '\0') {
-    fprintf(stderr, "Invalid Filter Name\n");
+static int
+apply(const char * const filename) {
+  static const char * const parts[] = {
+    [MRM_APPLY_GROUP]  = "ioctl(MRM_SETGROUP)",
+    [MRM_APPLY_STAGE]  = "ioctl(MRM_STAGEBEGIN)",
+    [MRM_APPLY_FILTER] = "ioctl(MRM_STAGEFILTER2)",
+    [MRM_APPLY_REMAP]  = "ioctl(MRM_STAGEREMAPS)",
+    [MRM_APPLY_COMMIT] = "ioctl(MRM_STAGECOMMIT)",
+  };
+  static const char * const items[] = {
+    [MRM_APPLY_GROUP]  = "group",
+    [MRM_APPLY_FILTER] = "filter",
+    [MRM_APPLY_REMAP]  = "remap",
+  };
+  struct mrm_config conf;
+  struct mrm_apply_failure failed;
+  struct mrm_handle *h;
+  char err[512];
+  int rv;
+
+  /* read in the whole configuration first... */
+  err[0] = '\0';
+  rv = mrm_load_config(&conf, filename, err, sizeof(err));
+  if (rv != 0) {
+    parse_failed(err, rv);
     return 1;
   }
-  strncpy(re.filter_name, filter_name, sizeof(re.filter_name));
 
-  if (!parse_macaddr(re.match_macaddr, match_macaddr)) {
-    fprintf(stderr, "Invalid Match MAC Address: %s\n", match_macaddr);
-    return 1;
+  /* ...then hand it to the driver to swap in all at once */
+  h = open_driver();
+  rv = mrm_apply(h, &conf, &failed);
+  mrm_free_config(&conf);
+  if (rv != 0) {
+    if (items[failed.what] != NULL) {
+      fprintf(stderr, "%s failed on %s %u: %s\n", parts[failed.what], items[failed.what], failed.index + 1, mrm_strerror(rv));
+    }
+    else {
+      fprintf(stderr, "%s failed: %s\n", parts[failed.what], mrm_strerror(rv));
+    }
   }
+  mrm_close(h);
+  return (rv != 0) ? 1 : 0;
+}
+
+static void
+print_counter(const char * const what, const struct mrm_counter * const c) {
+  printf("%s: %llu frames, %llu bytes\n", what, (unsigned long long)c->frames, (unsigned long long)c->bytes);
+}
 
-  /* parse + validate the remap mac address list one-by-one */
-  argc -= 4;
-  argv += 4;
-  while ( argc > 0 ) {
-    /* first put things into human-readable variable names */
-    remap_macaddr = *argv;
-    --argc; ++argv;
-    replace_ifname = NULL;
-    if (argc > 0) {
-      replace_ifname = *argv;
-      if (replace_ifname[0] == '\0') {
-        replace_ifname = NULL;
-      }
-      --argc; ++argv;
+static int
+stats(const char * const match_macaddr) {
+  struct mrm_stats st;
+  struct mrm_remap_stats *rs;
+  const struct mrm_counter *counter;
+  struct mrm_handle *h;
+  unsigned char macaddr[6];
+  char what[64];
+  unsigned i, j;
+  int rv;
+
+  if (match_macaddr == NULL) {
+    h = open_driver();
+    rv = mrm_get_stats(h, &st);
+    if (rv == 0) {
+      print_counter("Bridge Hook", &st.hook);
+      print_counter("Remap Hits", &st.remap_hit);
+      print_counter("Remap Misses", &st.remap_miss);
+      print_counter("Unclassified", &st.unclassified);
     }
+    return finish(h, "ioctl(MRM_GETSTATS)", rv);
+  }
+
+  if (mrm_parse_macaddr(macaddr, match_macaddr) != 0) {
+    fprintf(stderr, "Invalid Match MAC Address: %s\n", match_macaddr);
+    return 1;
+  }
+  h = open_driver();
+  rv = mrm_get_remap_stats(h, macaddr, &rs);
+  if (rv != 0) {
+    return finish(h, "ioctl(MRM_GETREMAPSTATS)", rv);
+  }
+  mrm_close(h);
 
-    /* then add the replacement to the list... */
-    if (re.replace_count >= MRM_MAX_REPLACE) {
-      fprintf(stderr, "Too many replacements\n");
-      return 1;
+  counter = rs->counters;
+  for (i = 0; i < rs->class_count; ++i) {
+    for (j = 0; j < rs->classes[i].rule_count; ++j) {
+      snprintf(what, sizeof(what), "Class %u Rule %u Matches", i + 1, j + 1);
+      print_counter(what, counter++);
     }
-    if (!parse_macaddr(re.replace[re.replace_count].macaddr, remap_macaddr)) {
-      fprintf(stderr, "Invalid Match MAC Address: %s\n", match_macaddr);
-      return 1;
+    for (j = 0; j < rs->classes[i].replace_count; ++j) {
+      snprintf(what, sizeof(what), "Class %u Replacement %u %s", i + 1, j + 1, rs->shadow ? "Would Send" : "Sent");
+      print_counter(what, counter++);
     }
-    if (replace_ifname != NULL) {
-      strncpy(re.replace[re.replace_count].ifname, replace_ifname, sizeof(re.replace[re.replace_count].ifname));
+  }
+  for (i = 0; i < rs->class_count; ++i) {
+    for (j = 0; j < rs->classes[i].replace_count; ++j) {
+      snprintf(what, sizeof(what), "Class %u Replacement %u Spilled", i + 1, j + 1);
+      print_counter(what, counter++);
+      snprintf(what, sizeof(what), "Class %u Replacement %u Duplicated", i + 1, j + 1);
+      print_counter(what, counter++);
     }
-    ++re.replace_count;
   }
+  free(rs);
+  return 0;
+}
 
-  /* write the configuration to the driver... */
-  fd = open_driver();
-  if (ioctl(fd, MRM_SETREMAP, &re) == -1) {
-    perror("ioctl(MRM_SETREMAP) failed");
+static int
+mcaststats(const char * const group_macaddr) {
+  struct mrm_mcast_stats ms;
+  struct mrm_handle *h;
+  unsigned char macaddr[6];
+  int rv;
+
+  if (mrm_parse_macaddr(macaddr, group_macaddr) != 0) {
+    fprintf(stderr, "Invalid Group MAC Address: %s\n", group_macaddr);
     return 1;
   }
-  close(fd);
-  return 0;
+  h = open_driver();
+  rv = mrm_get_mcast_stats(h, macaddr, &ms);
+  if (rv == 0) {
+    print_counter("Converted", &ms.converted);
+    print_counter("Unicast Copies", &ms.copies);
+  }
+  return finish(h, "ioctl(MRM_GETMCASTSTATS)", rv);
 }
 
 static int
-rmremap(const char * const match_macaddr) {
-  struct mrm_remap_entry re;
-  int fd;
+resetstats( void ) {
+  struct mrm_handle *h;
 
-  if (!parse_macaddr(re.match_macaddr, match_macaddr)) {
-    fprintf(stderr, "Invalid Match MAC Address: %s\n", match_macaddr);
+  h = open_driver();
+  return finish(h, "ioctl(MRM_RESETSTATS)", mrm_reset_stats(h));
+}
+
+static int
+checkpoint(const char * const filename) {
+  struct mrm_handle *h;
+  size_t size;
+  void *buf;
+  FILE *fp;
+  int rv;
+
+  h = open_driver();
+  rv = mrm_get_checkpoint(h, &buf, &size);
+  if (rv != 0) {
+    return finish(h, "ioctl(MRM_GETCHECKPOINT)", rv);
+  }
+  mrm_close(h);
+
+  fp = fopen(filename, "wb");
+  if (fp == NULL) {
+    perror(filename);
+    return 1;
+  }
+  if ((fwrite(buf, 1, size, fp) != size) || (fclose(fp) != 0)) {
+    perror(filename);
+    return 1;
+  }
+  free(buf);
+  return 0;
+}
+
+static int
+restore(const char * const filename) {
+  struct mrm_handle *h;
+  struct stat st;
+  void *buf;
+  FILE *fp;
+  int rv;
+
+  fp = fopen(filename, "rb");
+  if ((fp == NULL) || (fstat(fileno(fp), &st) != 0)) {
+    perror(filename);
+    return 1;
+  }
+  if ((st.st_size < (off_t)sizeof(struct mrm_checkpoint_header)) || (st.st_size > MRM_CHECKPOINT_SIZE_LIMIT)) {
+    fprintf(stderr, "%s: Not a checkpoint\n", filename);
+    return 1;
+  }
+  buf = malloc(st.st_size);
+  if (buf == NULL) {
+    perror("malloc");
     return 1;
   }
+  if (fread(buf, 1, st.st_size, fp) != (size_t)st.st_size) {
+    perror(filename);
+    return 1;
+  }
+  fclose(fp);
+
+  h = open_driver();
+  rv = mrm_restore_checkpoint(h, buf, st.st_size);
+  free(buf);
+  return finish(h, "ioctl(MRM_RESTORECHECKPOINT)", rv);
+}
+
+static int
+decisionsample(const char * const every_str) {
+  struct mrm_handle *h;
+  unsigned every;
+  char *end;
+
+  every = strtoul(every_str, &end, 0);
+  if ((*every_str == '\0') || (*end != '\0')) usage();
+
+  h = open_driver();
+  return finish(h, "ioctl(MRM_SETDECISIONSAMPLE)", mrm_set_decision_sample(h, every));
+}
+
+static volatile sig_atomic_t _drain_stop;
+
+static void
+drain_stop(int sig) {
+  (void)sig;
+  _drain_stop = 1;
+}
+
+static void
+print_decision_addr(const struct mrm_decision * const d, const uint8_t * const addr) {
+  char str[INET6_ADDRSTRLEN];
+
+  str[0] = '\0';
+  if (d->family == AF_INET) inet_ntop(AF_INET, addr + 12, str, sizeof(str)); /* v4-mapped */
+  else if (d->family == AF_INET6) inet_ntop(AF_INET6, addr, str, sizeof(str));
+  printf("%s", str);
+}
+
+static void
+print_decision(const struct mrm_decision * const d, const unsigned cpu, void * const ctx) {
+  const unsigned char * const m = d->match_macaddr;
+  const unsigned char * const r = d->replace_macaddr;
+
+  (void)ctx;
+  printf("%llu.%09llu,%u,%02x:%02x:%02x:%02x:%02x:%02x,%02x:%02x:%02x:%02x:%02x:%02x,%u,%u,",
+    (unsigned long long)(d->timestamp / 1000000000), (unsigned long long)(d->timestamp % 1000000000), cpu,
+    m[0], m[1], m[2], m[3], m[4], m[5], r[0], r[1], r[2], r[3], r[4], r[5], d->replace_idx, d->proto);
+  print_decision_addr(d, d->saddr);
+  printf(",%u,", d->sport);
+  print_decision_addr(d, d->daddr);
+  printf(",%u,%u\n", d->dport, d->len);
+}
 
-  fd = open_driver();
-  if (ioctl(fd, MRM_DELETEREMAP, &re) == -1) {
-    perror("ioctl(MRM_DELETEREMAP) failed");
+static void
+write_decision(const struct mrm_decision * const d, const unsigned cpu, void * const ctx) {
+  (void)cpu;
+  (void)ctx;
+  fwrite(d, sizeof(*d), 1, stdout);
+}
+
+static int
+drain(const char * const format) {
+  void (*fn)(const struct mrm_decision * const, const unsigned, void * const);
+  struct mrm_decision_rings dr;
+  struct mrm_handle *h;
+  unsigned long long lost;
+  int rv;
+
+  if (strcmp(format, "csv") == 0) fn = &print_decision;
+  else if (strcmp(format, "binary") == 0) fn = &write_decision;
+  else usage();
+
+  h = open_driver();
+  rv = mrm_map_decision_rings(h, &dr);
+  if (rv == -ENODEV) {
+    fprintf(stderr, "Remap decisions were never sampled (see 'decisionsample')\n");
+    mrm_close(h);
     return 1;
   }
-  close(fd);
+  if (rv != 0) {
+    return finish(h, "Mapping the decision rings", rv);
+  }
+  mrm_close(h); /* the rings stay mapped */
+
+  signal(SIGINT, &drain_stop);
+  signal(SIGTERM, &drain_stop);
+  signal(SIGPIPE, &drain_stop);
+
+  if (fn == &print_decision) printf("timestamp,cpu,match_macaddr,replace_macaddr,replace_idx,proto,saddr,sport,daddr,dport,len\n");
+  while (!_drain_stop) {
+    if (mrm_drain_decisions(&dr, fn, NULL) == 0) {
+      fflush(stdout);
+      usleep(100000); /* nothing new... check back in a bit */
+    }
+  }
+  fflush(stdout);
+
+  lost = mrm_decisions_lost(&dr);
+  if (lost > 0) fprintf(stderr, "%llu remap decisions were dropped for full rings\n", lost);
+
+  mrm_unmap_decision_rings(&dr);
   return 0;
-};
+}
 
 static void
 usage( void ) {
@@ -225,9 +516,24 @@ usage( void ) {
   fprintf(stderr, "    . wipe -- Completely Blow Away The Running Configuration\n");
   fprintf(stderr, "    . loadfilter <filter_name> <file_name> -- Load in a filter from filter configuration file\n");
   fprintf(stderr, "    . rmfilter <filter_name> -- Delete a filter name\n");
-  fprintf(stderr, "    . remap <filter_name> <match_macaddr> <dest_macaddr> [dest_ifname] -- Add a remap\n");
-  fprintf(stderr, "    . remap <filter_name> <match_macaddr> <dest_macaddr_1> <dest_ifname_1> <dest_macaddr_N> <dest_ifname_N> -- Add a remap with multiple replacements\n");
+  fprintf(stderr, "    . remap [options] <filter_name> <match_macaddr> <dest_macaddr> [dest_ifname] -- Add a remap\n");
+  fprintf(stderr, "    . remap [options] <filter_name> <match_macaddr> <dest_macaddr_1> <dest_ifname_1> <dest_macaddr_N> <dest_ifname_N> -- Add a remap with multiple replacements\n");
+  fprintf(stderr, "    . remap [options] <filter_name> <match_macaddr> <dest...> class [options] <filter_name> <dest...> -- Add a remap with multiple traffic classes\n");
+  fprintf(stderr, "    . remap --shadow [options] <filter_name> <match_macaddr> <dest...> -- Add a remap in shadow mode (any of the above)\n");
+  fprintf(stderr, "    . remap --idle <seconds> [options] <filter_name> <match_macaddr> <dest...> -- Add a remap that goes away once idle (any of the above)\n");
   fprintf(stderr, "    . rmremap <match_macaddr> -- Delete a remap\n");
+  fprintf(stderr, "    . group <group_name> <dest_macaddr_1> <dest_ifname_1> <dest_macaddr_N> <dest_ifname_N> -- Set the replacements of a replacement group\n");
+  fprintf(stderr, "    . rmgroup <group_name> -- Delete a replacement group no remap uses anymore\n");
+  fprintf(stderr, "    . mcast [-k] <group_macaddr> <member_macaddr_1> <port_ifname_1> <member_macaddr_N> <port_ifname_N> -- Convert a multicast group to unicast\n");
+  fprintf(stderr, "    . rmmcast <group_macaddr> -- Stop converting a multicast group\n");
+  fprintf(stderr, "    . apply <file_name> -- Replace all of the filters and remaps at once with the ones in a file\n");
+  fprintf(stderr, "    . stats [match_macaddr] -- Show the data plane counters, or those of a remap's filter rules and replacements\n");
+  fprintf(stderr, "    . mcaststats <group_macaddr> -- Show how many frames of a multicast group were converted, and into how many copies\n");
+  fprintf(stderr, "    . resetstats -- Start all of the data plane counters over from zero\n");
+  fprintf(stderr, "    . checkpoint <file_name> -- Save the whole running configuration to a binary checkpoint file\n");
+  fprintf(stderr, "    . restore <file_name> -- Restore the running configuration from a checkpoint file in one go\n");
+  fprintf(stderr, "    . decisionsample <every> -- Sample every Nth remap decision on each cpu (0 stops the sampling)\n");
+  fprintf(stderr, "    . drain <csv|binary> -- Stream the sampled remap decisions to stdout until interrupted\n");
   fprintf(stderr, "\n");
   fprintf(stderr, "\n");
   fprintf(stderr, "  Multiple remaps:\n");
@@ -235,6 +541,84 @@ usage( void ) {
                       "parameter must be provided with reach remap replacement. This can be an empty string "
                       "if it is not intended to perform an interface move with the MAC address replacement. "
                       "\n");
+  fprintf(stderr, "\n");
+  fprintf(stderr, "  Traffic classes:\n");
+  fprintf(stderr, "    Up to %u classes may be given, each with its own filter, options and replacements. "
+                      "Traffic goes to the first class whose filter it matches, and traffic that matches no "
+                      "class is left unmodified. "
+                      "\n", MRM_MAX_CLASSES);
+  fprintf(stderr, "\n");
+  fprintf(stderr, "  Remap options (per class):\n");
+  fprintf(stderr, "    -p <roundrobin|flowhash|leastload|replicate> -- How a replacement is picked: frame by frame (default), per flow, "
+                      "whichever replacement has carried the least (weight adjusted) traffic recently, "
+                      "or all of them at once (a copy of every frame to each replacement, the receiver de-duplicates)\n");
+  fprintf(stderr, "    -s <next|unmodified> -- What happens to traffic over a replacement's rate limit (default next)\n");
+  fprintf(stderr, "    -g <group_name> -- Send the traffic to the replacements of a replacement group (no 'dest...' is given then)\n");
+  fprintf(stderr, "    -e <bytes>[/<window_ms>] -- Only remap elephant flows: flows whose filter matching traffic reaches "
+                      "<bytes> within <window_ms> (default 1000). Once remapped, all of the flow's traffic stays remapped\n");
+  fprintf(stderr, "\n");
+  fprintf(stderr, "  Shadow mode:\n");
+  fprintf(stderr, "    A remap given '--shadow' classifies its traffic and picks replacements for it as usual, but leaves "
+                      "every frame unmodified. What each replacement would have been sent is counted instead (see 'stats "
+                      "<match_macaddr>' and 'show'), to see how much traffic a filter would move before putting it live. "
+                      "Setting the remap again without '--shadow' puts it live. "
+                      "\n");
+  fprintf(stderr, "\n");
+  fprintf(stderr, "  Idle remaps:\n");
+  fprintf(stderr, "    A remap given '--idle <seconds>' (at most %u) is deleted once no traffic has been sent to its match "
+                      "MAC address for that long, give or take a couple of seconds. 0 (the default) keeps it until it is "
+                      "deleted. '--idle' and '--shadow' may be given together. "
+                      "\n", MRM_MAX_IDLE_TIMEOUT);
+  fprintf(stderr, "\n");
+  fprintf(stderr, "  Weighted replacements:\n");
+  fprintf(stderr, "    Any 'dest_macaddr' may be suffixed with ',weight=<n>' (1-%u, default 1) to give that replacement "
+                      "a proportional share of the traffic. For example, to move 5%% of the traffic, give the "
+                      "original MAC address (with an empty 'dest_ifname') a weight of 95 and the new one a weight of 5. "
+                      "\n", MRM_MAX_REPLACE_WEIGHT);
+  fprintf(stderr, "\n");
+  fprintf(stderr, "  Rate limited replacements:\n");
+  fprintf(stderr, "    Any 'dest_macaddr' may also be suffixed with ',rate=<bytes_per_sec>' and optionally ',burst=<bytes>' "
+                      "(default a tenth of a second worth) to cap the traffic sent to that replacement. "
+                      "Excess traffic goes to the next replacement, or is left unmodified when there is no room "
+                      "anywhere or when '-s unmodified' is given. "
+                      "\n");
+  fprintf(stderr, "\n");
+  fprintf(stderr, "  Replacement groups:\n");
+  fprintf(stderr, "    A group is a named set of up to %u replacements (given the same way as those of a remap) that any "
+                      "number of remaps can send their traffic to with '-g'. Setting the group again moves all of "
+                      "those remaps over to the new replacements at once. "
+                      "\n", MRM_REPLACE_GROUP_LIMIT);
+  fprintf(stderr, "\n");
+  fprintf(stderr, "  Applying a configuration file:\n");
+  fprintf(stderr, "    Each line of the file is a 'loadfilter', 'group' or 'remap' command with the same arguments as above "
+                      "(write an empty 'dest_ifname' as \"\", lines starting with # are ignored). Traffic keeps flowing through the running configuration "
+                      "until the whole file has been loaded, and then switches over in one go. Replacement groups "
+                      "are set before that (remaps already using them switch over right away), and multicast "
+                      "conversions are left as they are. "
+                      "\n");
+  fprintf(stderr, "\n");
+  fprintf(stderr, "  Checkpoints:\n");
+  fprintf(stderr, "    A checkpoint holds the replacement groups, filters, remaps and multicast conversions in the "
+                      "driver's own binary form, so restoring it takes no parsing. The filters and remaps are swapped "
+                      "in all at once, the same as with 'apply'. A checkpoint copied to /lib/firmware can also be "
+                      "restored when the module gets loaded, with the module parameter 'checkpoint=<file_name>'. "
+                      "Checkpoints are only good for the driver version that made them. "
+                      "\n");
+  fprintf(stderr, "\n");
+  fprintf(stderr, "  Multicast to unicast:\n");
+  fprintf(stderr, "    Frames sent to 'group_macaddr' are copied to each member station as unicast frames, which are "
+                      "then remapped like any other traffic headed for the station. A member only gets copies "
+                      "of the frames going out of the bridge port 'port_ifname', the port the station sits behind. "
+                      "On ports with members the multicast frame itself is dropped, unless '-k' is given. "
+                      "\n");
+  fprintf(stderr, "\n");
+  fprintf(stderr, "  Sampled remap decisions:\n");
+  fprintf(stderr, "    Once started with 'decisionsample', every Nth frame moved to a replacement on each cpu is "
+                      "recorded (when, its flow, the remap, the replacement chosen and the frame length) in a ring "
+                      "of that cpu that 'drain' reads straight out of the driver's memory. Decisions sampled while "
+                      "nobody drains them are dropped once the rings are full (see the module parameter "
+                      "'decision_ring_records'). The binary format is the driver's struct mrm_decision, back to back. "
+                      "\n");
   _exit(1);
 }
 
@@ -265,6 +649,53 @@ main( int argc, char *argv[] ) {
     if (argc != 3) usage();
     return rmremap(argv[2]);
   }
+  if (strcmp(argv[1], "group") == 0) {
+    if (argc < 4) usage();
+    return group(argc, argv);
+  }
+  if (strcmp(argv[1], "rmgroup") == 0) {
+    if (argc != 3) usage();
+    return rmgroup(argv[2]);
+  }
+  if (strcmp(argv[1], "mcast") == 0) {
+    if (argc < 4) usage();
+    return mcast(argc, argv);
+  }
+  if (strcmp(argv[1], "rmmcast") == 0) {
+    if (argc != 3) usage();
+    return rmmcast(argv[2]);
+  }
+  if (strcmp(argv[1], "apply") == 0) {
+    if (argc != 3) usage();
+    return apply(argv[2]);
+  }
+  if (strcmp(argv[1], "stats") == 0) {
+    if ((argc != 2) && (argc != 3)) usage();
+    return stats((argc == 3) ? argv[2] : NULL);
+  }
+  if (strcmp(argv[1], "mcaststats") == 0) {
+    if (argc != 3) usage();
+    return mcaststats(argv[2]);
+  }
+  if (strcmp(argv[1], "resetstats") == 0) {
+    return resetstats();
+  }
+  if (strcmp(argv[1], "checkpoint") == 0) {
+    if (argc != 3) usage();
+    return checkpoint(argv[2]);
+  }
+  if (strcmp(argv[1], "restore") == 0) {
+    if (argc != 3) usage();
+    return restore(argv[2]);
+  }
+  if (strcmp(argv[1], "decisionsample") == 0) {
+    if (argc != 3) usage();
+    return decisionsample(argv[2]);
+  }
+  if (strcmp(argv[1], "drain") == 0) {
+    if (argc != 3) usage();
+    return drain(argv[2]);
+  }
 
   usage();
 
@@ -60,6 +60,20 @@ parse_ip_field(struct mrm_ipaddr_filter * output, char * const field, int * cons
     return 1; /* success */
   }
 
+  /* is this a reference to an existing ipset ("@<set_name>")? */
+  if (field[0] == '@') {
+    if ((field[1] == '\0') || (strlen(field + 1) >= sizeof(output->ipset_name))) {
+      fprintf(stderr, "Invalid ipset name: '%s'\n", field + 1);
+      return 0; /* parse failed */
+    }
+    output->match_type = MRMIPFILT_MATCHIPSET;
+    strncpy(output->ipset_name, field + 1, sizeof(output->ipset_name));
+
+    /* the set holds addresses of the rule's family... IPv4 unless the protocol says otherwise */
+    if ((*enforce_family) == AF_UNSPEC) (*enforce_family) = AF_INET;
+    return 1; /* success */
+  }
+
   /* do we have a delimiter indicating a range or subnet ?  */
   if ((delim = strchr(field, '-')) != NULL) {
     delim_type = *delim;
@@ -292,7 +306,7 @@ filter_file_parse_line(struct mrm_filter_rule * const output, char * line) {
 
 
 int
-filter_file_load(struct mrm_filter_config * const output, const char *fname) {
+filter_file_load(struct mrm_filter_config_v2 ** const output, const char *fname) {
   FILE *f = NULL;
   int rv;
 
@@ -311,15 +325,23 @@ filter_file_load(struct mrm_filter_config * const output, const char *fname) {
 }
 
 int
-filter_file_loadf(struct mrm_filter_config * const output, FILE * const f) {
+filter_file_loadf(struct mrm_filter_config_v2 ** const output, FILE * const f) {
   int linenum;
   char buf[4096], *pos;
+  struct mrm_filter_config_v2 *filt, *p;
+  unsigned room;
 
   if (f == NULL)
     return -1;
 
-  output->rules_active = 0;
-  memset(output->rules, 0, sizeof(output->rules)); /* defensive */
+  /* the rules follow the header... room for more gets made as they come */
+  room = 16;
+  filt = calloc(1, MRM_FILTER_CONFIG_V2_SIZE(room));
+  if (filt == NULL) {
+    perror("calloc");
+    return -1;
+  }
+  filt->version = MRM_FILTER_CONFIG_V2;
 
   for (linenum = 1; fgets(buf, sizeof(buf), f) != NULL; linenum++) {
 
@@ -332,23 +354,31 @@ filter_file_loadf(struct mrm_filter_config * const output, FILE * const f) {
     if (buf[0] == '\0')
       continue;
 
-    if (output->rules_active >= (sizeof(output->rules) / sizeof(output->rules[0]))) {
-       /* XXX cleanup !! */
-      /* fprintf(stderr, "Rule count exceeds maximum in file: '%s'\n", fname); */
-      fprintf(stderr, "Rule count exceeds maximum\n");
+    if (filt->rule_count >= MRM_FILTER_RULES_LIMIT) {
+      fprintf(stderr, "Rule count exceeds maximum of %u\n", MRM_FILTER_RULES_LIMIT);
+      free(filt);
       return -1;
     }
-    if (!filter_file_parse_line(&output->rules[output->rules_active], buf)) {
-       /* XXX cleanup !! */
-      /* fprintf(stderr, "Failed to parse line %d in filter configuration file: '%s'\n", linenum, fname); */
+    if (filt->rule_count >= room) {
+      room *= 2;
+      p = realloc(filt, MRM_FILTER_CONFIG_V2_SIZE(room));
+      if (p == NULL) {
+        perror("realloc");
+        free(filt);
+        return -1;
+      }
+      filt = p;
+    }
+    memset(&filt->rules[filt->rule_count], 0, sizeof(filt->rules[0])); /* defensive */
+    if (!filter_file_parse_line(&filt->rules[filt->rule_count], buf)) {
       fprintf(stderr, "Failed to parse line %d in filter configuration file\n", linenum);
+      free(filt);
       return -1;
     }
 
-    output->rules_active++;
+    filt->rule_count++;
   }
 
+  *output = filt;
   return 0; /* success */
 }
-
-
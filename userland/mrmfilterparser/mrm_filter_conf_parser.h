@@ -27,9 +27,11 @@ extern "C" {
 #endif
 
 
-struct mrm_filter_config;
-int filter_file_load(struct mrm_filter_config * const /* output */, const char * /* fname */);
-int filter_file_loadf(struct mrm_filter_config * const /* output */, FILE * const /* f */);
+/* the filter gets allocated to fit the rules in the file (and the caller free()s it)...
+   the name is left empty */
+struct mrm_filter_config_v2;
+int filter_file_load(struct mrm_filter_config_v2 ** const /* output */, const char * /* fname */);
+int filter_file_loadf(struct mrm_filter_config_v2 ** const /* output */, FILE * const /* f */);
 
 #ifdef __cplusplus
 }; //extern "C" {